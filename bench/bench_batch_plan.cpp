@@ -0,0 +1,122 @@
+///////////////////////////////////////////////////////////////////////////////
+// bench_batch_plan.cpp - Multi vehicle planning throughput - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+// Plans a batch of vehicles with random starts and goals over one random map,
+// with 1 to N threads, and reports plans per second. The first batch of each
+// thread count also makes the searches, later ones reuse them.
+//
+// Usage: bench_batch_plan [vehicles] [map_size] [max_threads] [file.mprim]
+
+#include "batch_planner.hpp"
+#include "bench_common.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#define BENCH_REPS 3
+#define BENCH_PLANNING_TIME 2.0
+
+int main(int argc, char *argv[])
+{
+    int vehicles = (argc > 1) ? std::atoi(argv[1]) : 64;
+    int size = (argc > 2) ? std::atoi(argv[2]) : 500;
+    unsigned int max_threads = (argc > 3) ? std::atoi(argv[3]) : std::thread::hardware_concurrency();
+    max_threads = std::max(1u, max_threads);
+    communicator my_communicator;
+    if(!import_bench_config(my_communicator)) {
+        return 1;
+    }
+    env_constants_t env_const = my_communicator.get_const_data();
+    const char* mprim_file = (argc > 4) ? argv[4] : env_const.motion_prim_file;
+    env_const.motion_prim_file = mprim_file;
+
+    inflation_params_t inf_param = {6, 0.6, INFLATION_STAMP};
+    inflation_stamp_cache cache;
+    std::vector<unsigned char> cells;
+    int obstacles = random_obstacle_map(size, 0, cache, inf_param, cells);
+    std::shared_ptr<tiled_grid> grid = std::make_shared<tiled_grid>();
+    grid->assign(cells.data(), size, size);
+
+    //Starts and goals on free cells
+    std::mt19937 rng(vehicles);
+    std::uniform_int_distribution<int> coord(0, size - 1);
+    std::vector<batch_query_t> queries;
+    std::uniform_int_distribution<int> heading(0, 7);
+    while((int)queries.size() < vehicles) {
+        batch_query_t query = {coord(rng), coord(rng), heading(rng) * 45, coord(rng), coord(rng), heading(rng) * 45};
+        if(grid->cost(query.start_x, query.start_y) == 0 && grid->cost(query.goal_x, query.goal_y) == 0) {
+            queries.push_back(query);
+        }
+    }
+
+    std::shared_ptr<env_snapshot_t> snapshot = std::make_shared<env_snapshot_t>();
+    snapshot->grid = grid;
+    snapshot->grid_generation = 1;
+    snapshot->data = {size, size, queries[0].start_x, queries[0].start_y, queries[0].start_theta,
+                      queries[0].goal_x, queries[0].goal_y, queries[0].goal_theta, grid.get()
+                     };
+
+    std::printf("%d vehicles, %dx%d map, %d obstacles, %s\n", vehicles, size, size, obstacles, mprim_file);
+    std::printf("map %.1f MB shared, %.1f MB as a copy per vehicle\n", (double)size * size / 1e6,
+                (double)size * size * vehicles / 1e6);
+    std::printf("%8s %9s %12s %12s %9s %8s %10s\n", "threads", "searches", "first(ms)", "batch(ms)", "plans/s",
+                "paths", "avg cost");
+
+    std::vector<unsigned int> thread_counts;
+    for(unsigned int threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    for(unsigned int threads : thread_counts) {
+        batch_planner planner(DEFAULT_BATCH_CONFIG, threads);
+        planner.set_planning_time(BENCH_PLANNING_TIME);
+        if(planner.initialize(snapshot, env_const) != 0) {
+            std::printf("Failed to initialize the environment from %s\n", mprim_file);
+            return 1;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<batch_result_t> results = planner.plan(queries);
+        double first_ms = ms_since(start);
+
+        start = std::chrono::steady_clock::now();
+        for(int rep = 0; rep < BENCH_REPS; rep++) {
+            results = planner.plan(queries);
+        }
+        double batch_ms = ms_since(start) / BENCH_REPS;
+
+        int paths = 0;
+        long long cost = 0;
+        for(const batch_result_t &result : results) {
+            if(result.status == BATCH_PATH_FOUND) {
+                paths++;
+                cost += result.cost;
+            }
+        }
+        std::printf("%8u %9zu %12.1f %12.1f %9.1f %8d %10lld\n", threads, planner.searches(), first_ms, batch_ms,
+                    vehicles * 1000.0 / batch_ms, paths, paths == 0 ? 0 : cost / paths);
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// bench_common.hpp - Shared benchmark fixtures - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include "communication.hpp"
+#include "inflation.hpp"
+#include "raster.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// The config the benchmarks plan with, the same drops reads
+#define BENCH_CONFIG_FILENAME "./src/communicator_config.txt"
+// Stationary obstacles per million cells of random_obstacle_map()
+#define BENCH_OBSTACLES_PER_MCELL 200
+
+// Milliseconds from start to now
+inline double ms_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Reads BENCH_CONFIG_FILENAME into my_communicator, false if it could not. The constants
+// from get_const_data() point into my_communicator, so it has to outlive them.
+inline bool import_bench_config(communicator& my_communicator)
+{
+    if(my_communicator.import_config(BENCH_CONFIG_FILENAME) != 0) {
+        std::printf("Error with config %s\n", BENCH_CONFIG_FILENAME);
+        return false;
+    }
+    return true;
+}
+
+// A size x size map of random stationary obstacles, inflated the way the communicator does it,
+// the same for every benchmark given the same size. None is centered within 3 * corner cells of
+// the top left and bottom right corners. Returns the number of obstacles on it.
+inline int random_obstacle_map(int size, int corner, inflation_stamp_cache& cache,
+                               const inflation_params_t& inf_param, std::vector<unsigned char>& cells)
+{
+    std::mt19937 rng(size);
+    std::uniform_int_distribution<int> coord(0, size - 1);
+    std::uniform_int_distribution<int> radius(2, 12);
+    cells.assign((size_t)size * size, 0);
+    int obstacles = std::max(1, (int)((long long)size * size * BENCH_OBSTACLES_PER_MCELL / 1000000));
+    int stamped = 0;
+    for(int i = 0; i < obstacles; i++) {
+        int x = coord(rng);
+        int y = coord(rng);
+        int r = radius(rng);
+        if((x < 3 * corner && y < 3 * corner) || (x >= size - 3 * corner && y >= size - 3 * corner)) {
+            continue;
+        }
+        stamp_max(cells.data(), size, size, *cache.get(r, inf_param), x, y);
+        stamped++;
+    }
+    return stamped;
+}
+
+#endif /* BENCH_COMMON_H */
@@ -0,0 +1,125 @@
+///////////////////////////////////////////////////////////////////////////////
+// bench_corridor_plan.cpp - Corridor against flat planning - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+// Plans corner to corner across random maps of 1000, 4000 and 10000 cells a
+// side, once over the whole grid and once inside a coarse corridor, and prints
+// setup and planning time, expansions, memory and path cost of both.
+//
+// Usage: bench_corridor_plan [file.mprim] [scale] [buffer] [size ...]
+
+#include "bench_common.hpp"
+#include "plan.hpp"
+#include "metrics.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <unistd.h>
+#include <vector>
+
+#define BENCH_PLANNING_TIME 60.0
+#define BENCH_CORNER 20
+
+// Resident memory of the process in MB, from /proc
+double resident_mb()
+{
+    long pages = 0;
+    FILE* statm = std::fopen("/proc/self/statm", "r");
+    if(statm != NULL) {
+        if(std::fscanf(statm, "%*s %ld", &pages) != 1) {
+            pages = 0;
+        }
+        std::fclose(statm);
+    }
+    return (double)pages * sysconf(_SC_PAGESIZE) / 1e6;
+}
+
+void bench(env_snapshot_ptr snapshot, env_constants_t& env_const, const char* name, corridor_params_t params)
+{
+    double base_mb = resident_mb();
+    auto start = std::chrono::steady_clock::now();
+    Planner planner;
+    planner.set_corridor(params);
+    planner.set_planning_time(BENCH_PLANNING_TIME);
+    planner.set_first_solution(true);
+    if(planner.initialize(snapshot, env_const) != 0) {
+        std::printf("%10s failed to initialize\n", name);
+        return;
+    }
+    double init_ms = ms_since(start);
+    bool corridor = planner.in_corridor();
+
+    start = std::chrono::steady_clock::now();
+    int has_path = planner.plan();
+    double plan_ms = ms_since(start);
+    plan_solution_ptr solution = planner.latest_solution();
+    std::printf("%10s %10.1f %10.1f %12llu %10.1f %10d %s\n", name, init_ms, plan_ms,
+                (unsigned long long)metrics().last_expansions, resident_mb() - base_mb,
+                has_path ? solution->cost : -1,
+                params.scale == 0 ? "" : (corridor ? (planner.in_corridor() ? "corridor" : "fell back") : "no corridor"));
+}
+
+int main(int argc, char *argv[])
+{
+    communicator my_communicator;
+    if(!import_bench_config(my_communicator)) {
+        return 1;
+    }
+    env_constants_t env_const = my_communicator.get_const_data();
+    const char* mprim_file = (argc > 1) ? argv[1] : env_const.motion_prim_file;
+    env_const.motion_prim_file = mprim_file;
+    corridor_params_t params = {CORRIDOR_DEFAULT_SCALE, CORRIDOR_DEFAULT_BUFFER};
+    params.scale = (argc > 2) ? std::atoi(argv[2]) : params.scale;
+    params.buffer = (argc > 3) ? std::atoi(argv[3]) : params.buffer;
+    std::vector<int> sizes;
+    for(int i = 4; i < argc; i++) {
+        sizes.push_back(std::atoi(argv[i]));
+    }
+    if(sizes.empty()) {
+        sizes = {1000, 4000, 10000};
+    }
+
+    inflation_params_t inf_param = {6, 0.6, INFLATION_STAMP};
+    inflation_stamp_cache cache;
+
+    std::printf("%s, corridor scale %d buffer %d, first solution, %.0f s limit\n", mprim_file, params.scale,
+                params.buffer, BENCH_PLANNING_TIME);
+    for(int size : sizes) {
+        //The corners are kept clear for the start and goal
+        std::vector<unsigned char> cells;
+        int obstacles = random_obstacle_map(size, BENCH_CORNER, cache, inf_param, cells);
+        std::shared_ptr<tiled_grid> grid = std::make_shared<tiled_grid>();
+        grid->assign(cells.data(), size, size);
+
+        std::shared_ptr<env_snapshot_t> snapshot = std::make_shared<env_snapshot_t>();
+        snapshot->grid = grid;
+        snapshot->grid_generation = 1;
+        snapshot->data = {size, size, BENCH_CORNER, BENCH_CORNER, 45,
+                          size - BENCH_CORNER, size - BENCH_CORNER, 45, grid.get()
+                         };
+
+        std::printf("\n%dx%d map, %d obstacles\n", size, size, obstacles);
+        std::printf("%10s %10s %10s %12s %10s %10s %s\n", "planner", "init(ms)", "plan(ms)", "expansions", "mem(MB)",
+                    "cost", "searched");
+        bench(snapshot, env_const, "flat", {0, 0});
+        bench(snapshot, env_const, "corridor", params);
+    }
+    return 0;
+}
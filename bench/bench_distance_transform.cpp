@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// bench_distance_transform.cpp - Inflation mode benchmark - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+// Rasterizes the same random obstacles with stamps and with the distance
+// transform, checks both grids match and prints how long each took.
+// Usage: bench_distance_transform [grid_size] [threads]
+
+#include "distance_transform.hpp"
+#include "inflation.hpp"
+#include "raster.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#define DEFAULT_INFLATION_RADIUS 6
+#define DEFAULT_WEIGHT 0.6
+
+int main(int argc, char *argv[])
+{
+    int size = (argc > 1) ? std::atoi(argv[1]) : 2000;
+    thread_pool pool((argc > 2) ? std::atoi(argv[2]) : 0);
+    const int counts[] = {10, 100, 1000, 5000};
+    //A handful of radii, like the no fly zones we get from the server
+    const int radii[] = {5, 10, 20, 40, 80};
+    inflation_params_t inf_param = {DEFAULT_INFLATION_RADIUS, DEFAULT_WEIGHT, INFLATION_STAMP};
+    inflation_stamp_cache cache;
+
+    std::printf("grid %dx%d, %u threads\n", size, size, pool.size());
+    std::printf("%10s %14s %14s\n", "obstacles", "stamp(ms)", "edt(ms)");
+    for(int count : counts) {
+        std::mt19937 rng(count);
+        std::uniform_int_distribution<int> coord(-50, size + 50);
+        std::uniform_int_distribution<int> pick(0, sizeof(radii) / sizeof(radii[0]) - 1);
+        std::vector<obstacle_t> obstacles;
+        for(int i = 0; i < count; i++) {
+            obstacles.push_back({coord(rng), coord(rng), radii[pick(rng)], 0, 0});
+        }
+
+        std::vector<unsigned char> stamp_grid((size_t)size * size, 0);
+        std::vector<unsigned char> edt_grid((size_t)size * size, 0);
+
+        auto start = std::chrono::steady_clock::now();
+        for(const obstacle_t& obs : obstacles) {
+            stamp_max(stamp_grid.data(), size, size, *cache.get(obs.radius, inf_param), obs.x, obs.y);
+        }
+        auto stamp_time = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        inflate_distance_transform(edt_grid.data(), size, size, obstacles, inf_param, pool);
+        auto edt_time = std::chrono::steady_clock::now() - start;
+
+        if(stamp_grid != edt_grid) {
+            std::printf("Stamp and distance transform grids differ with %d obstacles\n", count);
+            return 1;
+        }
+
+        std::printf("%10d %14.2f %14.2f\n", count,
+                    std::chrono::duration<double, std::milli>(stamp_time).count(),
+                    std::chrono::duration<double, std::milli>(edt_time).count());
+    }
+    return 0;
+}
@@ -0,0 +1,139 @@
+///////////////////////////////////////////////////////////////////////////////
+// bench_grid_parser.cpp - /api/grid parser benchmark - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+// Parses the same /api/grid document with the cpprest json DOM (the way
+// get_grid() used to) and with the streaming grid_parser.
+
+#include "communication.hpp" //For GRID_CHUNK_SIZE
+#include "grid_parser.hpp"
+
+#include <cpprest/json.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+ * Builds a grid document with count stationary and count moving obstacles
+ */
+std::string make_grid_json(int count)
+{
+    std::mt19937 rng(count);
+    std::uniform_int_distribution<int> coord(0, 5000);
+    std::uniform_int_distribution<int> radius(5, 80);
+    std::ostringstream json;
+    json << "{\"is_changed\": true, \"grid_width\": 5000, \"grid_height\": 5000, "
+         << "\"location\": {\"x\": 10, \"y\": 10, \"theta\": 0}, "
+         << "\"goal\": {\"x\": 4900, \"y\": 4900, \"theta\": 90}, "
+         << "\"obstacles\": {\"stationary_obstacles\": [";
+    for(int i = 0; i < count; i++) {
+        json << (i ? ", " : "") << "{\"x\": " << coord(rng) << ", \"y\": " << coord(rng)
+             << ", \"radius\": " << radius(rng) << "}";
+    }
+    json << "], \"moving_obstacles\": [";
+    for(int i = 0; i < count; i++) {
+        json << (i ? ", " : "") << "{\"x\": " << coord(rng) << ", \"y\": " << coord(rng)
+             << ", \"radius\": " << radius(rng) << ", \"heading\": " << coord(rng) % 360
+             << ", \"velocity\": " << coord(rng) % 40 << "}";
+    }
+    json << "]}}";
+    return json.str();
+}
+
+/*
+ * The DOM walk get_grid() did before the streaming parser
+ */
+size_t parse_dom(const std::string& doc)
+{
+    web::json::value grid_json = web::json::value::parse(utility::conversions::to_string_t(doc));
+    auto obstacles_json = grid_json.at(U("obstacles"));
+    std::vector<obstacle_t> stationary;
+    std::vector<obstacle_t> moving;
+    std::for_each(obstacles_json.at(U("stationary_obstacles")).as_array().begin(),
+                  obstacles_json.at(U("stationary_obstacles")).as_array().end(),
+    [&stationary](web::json::value & obstacle_json) {
+        stationary.push_back({obstacle_json.at(U("x")).as_integer(), obstacle_json.at(U("y")).as_integer(),
+                              obstacle_json.at(U("radius")).as_integer(), 0, 0
+                             });
+    });
+    std::for_each(obstacles_json.at(U("moving_obstacles")).as_array().begin(),
+                  obstacles_json.at(U("moving_obstacles")).as_array().end(),
+    [&moving](web::json::value & obstacle_json) {
+        moving.push_back({obstacle_json.at(U("x")).as_integer(), obstacle_json.at(U("y")).as_integer(),
+                          obstacle_json.at(U("radius")).as_integer(), obstacle_json.at(U("heading")).as_integer(),
+                          obstacle_json.at(U("velocity")).as_integer()
+                         });
+    });
+    return stationary.size() + moving.size();
+}
+
+/*
+ * The streaming parser, fed GRID_CHUNK_SIZE bytes at a time like read_grid_body()
+ */
+size_t parse_stream(const std::string& doc, grid_parser& parser, grid_update_t& update)
+{
+    parser.reset(&update);
+    for(size_t i = 0; i < doc.size(); i += GRID_CHUNK_SIZE) {
+        parser.feed(doc.data() + i, std::min((size_t)GRID_CHUNK_SIZE, doc.size() - i));
+    }
+    parser.finish();
+    check_grid_update(update.view(), true);
+    return update.stationary_obstacles.size() + update.moving_obstacles.size();
+}
+
+int main(int argc, char *argv[])
+{
+    const int counts[] = {10, 100, 1000, 10000};
+    grid_parser parser;
+    grid_update_t update; //Reused like communicator does, so the vectors stay allocated
+
+    std::printf("%10s %10s %12s %12s %8s\n", "obstacles", "bytes", "dom(us)", "stream(us)", "speedup");
+    for(int count : counts) {
+        std::string doc = make_grid_json(count);
+        int reps = std::max(3, 2000 / count);
+
+        size_t dom_total = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < reps; i++) {
+            dom_total += parse_dom(doc);
+        }
+        auto dom_time = std::chrono::steady_clock::now() - start;
+
+        size_t stream_total = 0;
+        start = std::chrono::steady_clock::now();
+        for(int i = 0; i < reps; i++) {
+            stream_total += parse_stream(doc, parser, update);
+        }
+        auto stream_time = std::chrono::steady_clock::now() - start;
+
+        if(dom_total != stream_total) {
+            std::printf("DOM and streaming parser disagree with %d obstacles\n", count);
+            return 1;
+        }
+
+        double dom_us = std::chrono::duration<double, std::micro>(dom_time).count() / reps;
+        double stream_us = std::chrono::duration<double, std::micro>(stream_time).count() / reps;
+        std::printf("%10d %10zu %12.1f %12.1f %7.1fx\n", 2 * count, doc.size(), dom_us, stream_us, dom_us / stream_us);
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+///////////////////////////////////////////////////////////////////////////////
+// bench_grid_wire.cpp - json against binary /api/grid throughput - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+// Fetches /api/grid over and over, once asking for json and once for the
+// binary grid, and decodes each response the way communicator does.
+// Meant to run against tools/mock_server on the same machine.
+//
+// Usage: bench_grid_wire [url] [requests]
+
+#include "communication.hpp" //For GRID_CHUNK_SIZE
+#include "grid_parser.hpp"
+#include "grid_wire.hpp"
+
+#include <cpprest/http_client.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace web::http;
+using namespace web::http::client;
+
+struct run_result_t {
+    double seconds;
+    double decode_us; //Average per response
+    size_t bytes; //Average per response
+    size_t obstacles;
+};
+
+/*
+ * Fetches the grid requests times with the given Accept header
+ */
+run_result_t run(http_client& client, const char* accept, int requests)
+{
+    grid_parser parser;
+    grid_update_t update;
+    std::vector<obstacle_t> scratch;
+    run_result_t result = {0, 0, 0, 0};
+    std::chrono::steady_clock::duration decode_time(0);
+
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < requests; i++) {
+        http_request request(methods::GET);
+        request.set_request_uri(U("/api/grid"));
+        request.headers().add(header_names::accept, U(accept));
+        http_response resp = client.request(request).get();
+        std::vector<unsigned char> body = resp.extract_vector().get();
+        result.bytes += body.size();
+
+        auto decode_start = std::chrono::steady_clock::now();
+        grid_view_t view;
+        if(is_grid_wire_content_type(utility::conversions::to_utf8string(resp.headers().content_type()))) {
+            view = decode_grid_wire(body.data(), body.size(), scratch);
+        } else {
+            parser.reset(&update);
+            for(size_t off = 0; off < body.size(); off += GRID_CHUNK_SIZE) {
+                parser.feed((const char*)body.data() + off, std::min((size_t)GRID_CHUNK_SIZE, body.size() - off));
+            }
+            parser.finish();
+            view = update.view();
+        }
+        check_grid_update(view, view.is_changed);
+        decode_time += std::chrono::steady_clock::now() - decode_start;
+        result.obstacles = view.stationary_obstacles.size() + view.moving_obstacles.size();
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.decode_us = std::chrono::duration<double, std::micro>(decode_time).count() / requests;
+    result.bytes /= requests;
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string url = argc > 1 ? argv[1] : "http://localhost:8080/";
+    int requests = argc > 2 ? std::max(1, std::atoi(argv[2])) : 200;
+
+    http_client client(utility::conversions::to_string_t(url));
+    const char* encodings[][2] = {
+        {"json", "application/json"},
+        {"binary", GRID_WIRE_CONTENT_TYPE}
+    };
+
+    std::printf("%8s %10s %10s %12s %12s\n", "encoding", "obstacles", "bytes", "decode(us)", "requests/s");
+    for(auto& encoding : encodings) {
+        try {
+            run_result_t result = run(client, encoding[1], requests);
+            std::printf("%8s %10zu %10zu %12.1f %12.1f\n", encoding[0], result.obstacles, result.bytes,
+                        result.decode_us, requests / result.seconds);
+        } catch(const std::exception& ex) {
+            std::printf("%8s failed: %s\n", encoding[0], ex.what());
+            return 1;
+        }
+    }
+    return 0;
+}
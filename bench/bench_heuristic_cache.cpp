@@ -0,0 +1,167 @@
+///////////////////////////////////////////////////////////////////////////////
+// bench_heuristic_cache.cpp - Repaired against rebuilt 2D heuristic - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+// Moves obstacles over a random map with a fixed goal and, every tick, brings
+// the 2D heuristic up to date three times: repaired from the dirty cells, and
+// built from scratch on one thread and on a pool. A fresh build is what every
+// tick costs when the field is rooted at the moving vehicle, as it is for
+// backward searches. Prints time and expansions, and checks all three agree
+// on every settled cell.
+//
+// Usage: bench_heuristic_cache [grid_size] [moving_obstacles] [ticks] [threads]
+
+#include "bench_common.hpp"
+#include "costmap.hpp"
+#include "heuristic_field.hpp"
+#include "thread_pool.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#define DEFAULT_INFLATION_RADIUS 6
+#define DEFAULT_WEIGHT 0.6
+#define BENCH_CORNER 20
+
+int main(int argc, char *argv[])
+{
+    int size = (argc > 1) ? std::atoi(argv[1]) : 2048;
+    int count = (argc > 2) ? std::atoi(argv[2]) : 50;
+    int ticks = (argc > 3) ? std::atoi(argv[3]) : 20;
+    thread_pool pool((argc > 4) ? std::atoi(argv[4]) : 0);
+    inflation_params_t inf_param = {DEFAULT_INFLATION_RADIUS, DEFAULT_WEIGHT, INFLATION_STAMP};
+    inflation_stamp_cache cache;
+    communicator my_communicator;
+    if(!import_bench_config(my_communicator)) {
+        return 1;
+    }
+    //The thresholds the planner's environment gives the heuristic
+    env_constants_t env_const = my_communicator.get_const_data();
+    unsigned char obs_thresh = env_const.cost_inscribed_thresh;
+
+    std::mt19937 rng(count);
+    std::uniform_int_distribution<int> coord(0, size - 1);
+    std::uniform_int_distribution<int> radius(2, 12);
+    std::uniform_int_distribution<int> heading(0, 359);
+    std::uniform_int_distribution<int> velocity(2, 8);
+    layered_costmap costmap;
+    costmap.reset(size, size);
+    std::vector<unsigned char> static_cells;
+    int stationary = random_obstacle_map(size, BENCH_CORNER, cache, inf_param, static_cells);
+    costmap.static_layer().assign(static_cells.data(), size, size);
+    std::vector<obstacle_t> moving;
+    for(int i = 0; i < count; i++) {
+        moving.push_back({coord(rng), coord(rng), radius(rng), heading(rng), velocity(rng)});
+    }
+
+    //The heuristic reads SBPL's x major layout
+    std::vector<unsigned char> cells((size_t)size * size);
+    std::vector<unsigned char*> columns(size);
+    for(int x = 0; x < size; x++) {
+        columns[x] = &cells[(size_t)x * size];
+        for(int y = 0; y < size; y++) {
+            cells[(size_t)x * size + y] = costmap.cost(x, y);
+        }
+    }
+    //Vehicle at one corner, goal at the other, both cleared
+    for(int x = 0; x < BENCH_CORNER; x++) {
+        for(int y = 0; y < BENCH_CORNER; y++) {
+            columns[x][y] = 0;
+            columns[size - 1 - x][size - 1 - y] = 0;
+        }
+    }
+    int goal = size - BENCH_CORNER / 2;
+    int start = BENCH_CORNER / 2;
+
+    heuristic_field kept;
+    kept.build(columns.data(), size, size, obs_thresh, env_const.cellsize_m, goal, goal);
+    kept.compute(start, start);
+
+    std::printf("grid %dx%d, %d stationary and %d moving obstacles, goal fixed, %u threads\n", size, size,
+                stationary, count, pool.size());
+    std::printf("%6s %9s %14s %12s %14s %12s %14s\n", "tick", "changed", "repair(ms)", "expansions", "rebuild(ms)",
+                "expansions", "pooled(ms)");
+    double repair_total = 0;
+    double rebuild_total = 0;
+    double pooled_total = 0;
+    for(int tick = 0; tick < ticks; tick++) {
+        costmap.begin_dynamic();
+        for(obstacle_t& obs : moving) {
+            obs.x += (int)std::lround(obs.velocity * std::cos(obs.heading * M_PI / 180.0));
+            obs.y += (int)std::lround(obs.velocity * std::sin(obs.heading * M_PI / 180.0));
+            costmap.stamp_dynamic(*cache.get(obs.radius, inf_param), obs.x, obs.y);
+        }
+        costmap.end_dynamic();
+        for(const cell_update_t& cell : costmap.dirty_cells()) {
+            columns[cell.x][cell.y] = cell.cost;
+            kept.mark_dirty(cell.x, cell.y);
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        kept.compute(start, start);
+        double repair_ms = ms_since(begin);
+
+        heuristic_field fresh;
+        begin = std::chrono::steady_clock::now();
+        fresh.build(columns.data(), size, size, obs_thresh, env_const.cellsize_m, goal, goal);
+        fresh.compute(start, start);
+        double rebuild_ms = ms_since(begin);
+
+        heuristic_field pooled;
+        pooled.set_pool(&pool);
+        begin = std::chrono::steady_clock::now();
+        pooled.build(columns.data(), size, size, obs_thresh, env_const.cellsize_m, goal, goal);
+        pooled.compute(start, start);
+        double pooled_ms = ms_since(begin);
+
+        //Both are exact below the lower of their frontiers
+        int settled = std::min(HEURISTIC_SEARCH_FACTOR * kept.distance(start, start),
+                               HEURISTIC_SEARCH_FACTOR * fresh.distance(start, start));
+        for(int x = 0; x < size; x++) {
+            for(int y = 0; y < size; y++) {
+                int a = kept.distance(x, y);
+                int b = fresh.distance(x, y);
+                if((a < settled || b < settled) && a != b) {
+                    std::printf("Repaired heuristic differs at %d, %d: %d against %d\n", x, y, a, b);
+                    return 1;
+                }
+                if(pooled.distance(x, y) != b) {
+                    std::printf("Pooled build differs at %d, %d: %d against %d\n", x, y, pooled.distance(x, y), b);
+                    return 1;
+                }
+            }
+        }
+
+        repair_total += repair_ms;
+        rebuild_total += rebuild_ms;
+        pooled_total += pooled_ms;
+        std::printf("%6d %9zu %14.2f %12llu %14.2f %12llu %14.2f\n", tick, costmap.dirty_cells().size(), repair_ms,
+                    (unsigned long long)kept.expansions(), rebuild_ms, (unsigned long long)fresh.expansions(),
+                    pooled_ms);
+    }
+    if(ticks > 0) {
+        std::printf("average repair %.2f ms, rebuild %.2f ms (%.1fx), pooled rebuild %.2f ms (%.1fx)\n",
+                    repair_total / ticks, rebuild_total / ticks, rebuild_total / repair_total,
+                    pooled_total / ticks, pooled_total / repair_total);
+    }
+    return 0;
+}
@@ -0,0 +1,101 @@
+///////////////////////////////////////////////////////////////////////////////
+// bench_inflation.cpp - Inflation stamp benchmark - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+// Compares rasterizing an obstacle by evaluating inflation_cost for every
+// cell (the old calculate_cost loop) against copying a cached stamp.
+
+#include "inflation.hpp"
+#include "raster.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#define DEFAULT_INFLATION_RADIUS 6
+#define DEFAULT_WEIGHT 0.6
+
+/*
+ * The per cell loop get_grid() used before stamps: one quadrant,
+ * mirrored four times, clipped to the grid.
+ */
+void rasterize_per_cell(unsigned char* grid, int width, int height,
+                        int obs_x, int obs_y, int obs_radius, inflation_params_t inf_param)
+{
+    for(int x = obs_x - obs_radius - inf_param.radius; x <= obs_x; x++) {
+        for(int y = obs_y - obs_radius - inf_param.radius; y <= obs_y; y++) {
+            unsigned char cost = inflation_cost(obs_radius, x - obs_x, y - obs_y, inf_param);
+            int xs[2] = {x, 2 * obs_x - x};
+            int ys[2] = {y, 2 * obs_y - y};
+            for(int i = 0; i < 2; i++) {
+                for(int j = 0; j < 2; j++) {
+                    if(xs[i] >= 0 && xs[i] < width && ys[j] >= 0 && ys[j] < height) {
+                        unsigned char& cell = grid[xs[i] + ys[j] * width];
+                        cell = std::max(cell, cost);
+                    }
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const int radii[] = {1, 2, 5, 10, 20, 50, 100, 150, 200};
+    inflation_params_t inf_param = {DEFAULT_INFLATION_RADIUS, DEFAULT_WEIGHT, INFLATION_STAMP};
+    inflation_stamp_cache cache;
+
+    std::printf("Span blending: %s\n", blend_max_isa());
+    std::printf("%8s %8s %14s %14s %8s\n", "radius", "reps", "per_cell(us)", "stamp(us)", "speedup");
+    for(int radius : radii) {
+        int size = 2 * (radius + inf_param.radius) + 1;
+        int width = size + 16;
+        int height = size + 16;
+        int center = width / 2;
+        //Keep the work per radius roughly constant
+        int reps = std::max(4, 20000000 / (size * size));
+
+        std::vector<unsigned char> per_cell_grid(width * height, 0);
+        std::vector<unsigned char> stamp_grid(width * height, 0);
+
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < reps; i++) {
+            rasterize_per_cell(per_cell_grid.data(), width, height, center, center, radius, inf_param);
+        }
+        auto per_cell_time = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        for(int i = 0; i < reps; i++) {
+            auto stamp = cache.get(radius, inf_param);
+            stamp_max(stamp_grid.data(), width, height, *stamp, center, center);
+        }
+        auto stamp_time = std::chrono::steady_clock::now() - start;
+
+        if(per_cell_grid != stamp_grid) {
+            std::printf("Mismatch between per cell and stamp rasterization at radius %d\n", radius);
+            return 1;
+        }
+
+        double per_cell_us = std::chrono::duration<double, std::micro>(per_cell_time).count() / reps;
+        double stamp_us = std::chrono::duration<double, std::micro>(stamp_time).count() / reps;
+        std::printf("%8d %8d %14.3f %14.3f %7.1fx\n", radius, reps, per_cell_us, stamp_us, per_cell_us / stamp_us);
+    }
+    return 0;
+}
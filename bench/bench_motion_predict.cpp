@@ -0,0 +1,195 @@
+///////////////////////////////////////////////////////////////////////////////
+// bench_motion_predict.cpp - Predicted obstacle track stamping - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+// Moves random obstacles in straight lines and rasterizes them each tick with
+// prediction off, swept and discounted. Reports the cells changed per tick,
+// the stamping time, and how much of every obstacle's real footprint a few
+// ticks later was already costed by the layer a path was planned on.
+//
+// Replans are counted the way -l plans: a Planner is given the changed cells
+// of every tick while a vehicle drives corner to corner along its path at
+// est_velocity, and it only plans again when path_current() says the kept path
+// went stale. Constants come from src/communicator_config.txt.
+//
+// Usage: bench_motion_predict [grid_size] [obstacles] [horizon_s] [tick_s] [plan_s]
+
+#include "bench_common.hpp"
+#include "costmap.hpp"
+#include "motion_predict.hpp"
+#include "plan.hpp"
+#include "tile_raster.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#define DEFAULT_INFLATION_RADIUS 6
+#define DEFAULT_WEIGHT 0.6
+#define BENCH_TICKS 40
+#define BENCH_CORNER 20
+
+// Where the obstacles are after t seconds
+std::vector<obstacle_t> moved_by(const std::vector<obstacle_t>& start, double t)
+{
+    std::vector<obstacle_t> moved(start);
+    for(obstacle_t& obs : moved) {
+        double heading = obs.heading * M_PI / 180.0;
+        obs.x += (int)std::lround(obs.velocity * t * std::cos(heading));
+        obs.y += (int)std::lround(obs.velocity * t * std::sin(heading));
+    }
+    return moved;
+}
+
+// Drives meters along the path from its first pose, the pose reached is the new start
+void drive(const std::vector<sbpl_xy_theta_pt_t>& path, double meters, int& x, int& y, int& theta)
+{
+    if(path.empty()) {
+        return;
+    }
+    size_t i = 0;
+    while(i + 1 < path.size() && meters > 0) {
+        meters -= std::hypot(path[i + 1].x - path[i].x, path[i + 1].y - path[i].y);
+        i++;
+    }
+    x = (int)path[i].x;
+    y = (int)path[i].y;
+    theta = ((int)std::lround(path[i].theta * 180.0 / M_PI) % 360 + 360) % 360;
+}
+
+int main(int argc, char *argv[])
+{
+    int size = (argc > 1) ? std::atoi(argv[1]) : 1024;
+    int count = (argc > 2) ? std::atoi(argv[2]) : 50;
+    double horizon = (argc > 3) ? std::atof(argv[3]) : 2.0;
+    double tick = (argc > 4) ? std::atof(argv[4]) : 0.5;
+    double plan_s = (argc > 5) ? std::atof(argv[5]) : 2.0;
+    int lookahead = std::max(1, (int)std::lround(horizon / tick));
+    inflation_params_t inf_param = {DEFAULT_INFLATION_RADIUS, DEFAULT_WEIGHT, INFLATION_STAMP};
+    communicator my_communicator;
+    if(!import_bench_config(my_communicator)) {
+        return 1;
+    }
+    env_constants_t env_const = my_communicator.get_const_data();
+    auto budget = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                      std::chrono::duration<double>(plan_s));
+
+    std::mt19937 rng(count);
+    std::uniform_int_distribution<int> coord(0, size - 1);
+    std::uniform_int_distribution<int> radius(3, 12);
+    std::uniform_int_distribution<int> heading(0, 359);
+    std::uniform_int_distribution<int> velocity(5, 20);
+    std::vector<obstacle_t> start;
+    for(int i = 0; i < count; i++) {
+        start.push_back({coord(rng), coord(rng), radius(rng), heading(rng), velocity(rng)});
+    }
+
+    std::printf("grid %dx%d, %d obstacles, horizon %.1f s, tick %.2f s, footprint checked %d ticks ahead, %.1f s to plan\n",
+                size, size, count, horizon, tick, lookahead, plan_s);
+    std::printf("%12s %14s %12s %10s %8s %8s %8s\n", "mode", "changed/tick", "stamp(ms)", "covered", "replans",
+                "kept", "no path");
+
+    const predict_mode_t modes[] = {PREDICT_OFF, PREDICT_SWEPT, PREDICT_DISCOUNTED};
+    const char* names[] = {"off", "swept", "discounted"};
+    thread_pool pool(1);
+    for(int m = 0; m < 3; m++) {
+        predict_params_t params = {modes[m], horizon, 0.5};
+        inflation_stamp_cache cache;
+        motion_predictor predictor;
+        layered_costmap costmap;
+        costmap.reset(size, size);
+        std::vector<obstacle_t> samples;
+        stamp_list stamps;
+
+        size_t changed = 0;
+        double stamp_ms = 0;
+        size_t footprint = 0;
+        size_t covered = 0;
+        int replans = 0;
+        int kept = 0;
+        int no_path = 0;
+
+        //The planner starts on the empty static layer, the moving obstacles come as changed cells
+        std::shared_ptr<env_snapshot_t> snapshot = std::make_shared<env_snapshot_t>();
+        snapshot->grid = costmap.shared_static_layer();
+        snapshot->grid_generation = 1;
+        snapshot->data = {size, size, BENCH_CORNER, BENCH_CORNER, 45,
+                          size - BENCH_CORNER, size - BENCH_CORNER, 45, snapshot->grid.get()
+                         };
+        Planner planner;
+        if(planner.initialize(snapshot, env_const) != 0) {
+            std::printf("%12s failed to initialize the planner\n", names[m]);
+            continue;
+        }
+        int x = BENCH_CORNER;
+        int y = BENCH_CORNER;
+        int theta = 45;
+        for(int t = 0; t < BENCH_TICKS; t++) {
+            std::vector<obstacle_t> now = moved_by(start, t * tick);
+            auto begin = std::chrono::steady_clock::now();
+            costmap.begin_dynamic();
+            predictor.predict(now, cache, inf_param, params, samples, stamps);
+            costmap.stamp_dynamic_tiled(samples, stamps, pool);
+            costmap.end_dynamic();
+            stamp_ms += ms_since(begin);
+            if(t > 0) {
+                changed += costmap.dirty_cells().size();
+            }
+
+            //Same as a tick of the replanning loop, with the vehicle where the last tick's path took it
+            if(t > 0) {
+                drive(planner.path(), env_const.est_velocity * tick, x, y, theta);
+                planner.set_start(x, y, theta);
+            }
+            planner.update_grid_points(costmap.dirty_cells());
+            if(t > 0 && planner.path_current()) {
+                kept++;
+            } else {
+                bool has_path = planner.plan_until(std::chrono::steady_clock::now() + budget) != 0;
+                replans += t > 0 ? 1 : 0;
+                no_path += has_path ? 0 : 1;
+            }
+
+            //Cells the obstacles will cover, which the layer planned on should already cost
+            std::vector<obstacle_t> later = moved_by(start, (t + lookahead) * tick);
+            for(const obstacle_t& obs : later) {
+                const inflation_stamp_t& stamp = *cache.get(obs.radius, inf_param);
+                for(int sy = 0; sy < stamp.size; sy++) {
+                    for(int sx = stamp.row_begin[sy]; sx < stamp.row_end[sy]; sx++) {
+                        int x = obs.x - stamp.half_size + sx;
+                        int y = obs.y - stamp.half_size + sy;
+                        if(x < 0 || y < 0 || x >= size || y >= size || stamp.cost[sy * stamp.size + sx] == 0) {
+                            continue;
+                        }
+                        footprint++;
+                        if(costmap.cost(x, y) != 0) {
+                            covered++;
+                        }
+                    }
+                }
+            }
+        }
+        std::printf("%12s %14.0f %12.3f %9.1f%% %8d %8d %8d\n", names[m], (double)changed / (BENCH_TICKS - 1),
+                    stamp_ms / BENCH_TICKS, footprint ? 100.0 * covered / footprint : 0.0, replans, kept, no_path);
+    }
+    return 0;
+}
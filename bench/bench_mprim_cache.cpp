@@ -0,0 +1,159 @@
+///////////////////////////////////////////////////////////////////////////////
+// bench_mprim_cache.cpp - Motion primitive loading benchmark - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+// Loads motion primitives with SBPL's text reader and from the compiled
+// cache, alone and as part of a whole InitializeEnv.
+//
+// Usage: bench_mprim_cache [file.mprim ...]
+// By default res/plane_simple.mprim (64 primitives) and motion_prim_file.mprim
+// (256 primitives), run from the root of the tree. Other sets can be made with
+// res/genprim_plane.m
+
+#include "mprim_cache.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#define BENCH_REPS 50
+#define BENCH_MAP_SIZE 200
+
+/*
+ * Gives the benchmark access to the primitive reader
+ */
+class bench_environment : public mprim_cache_environment {
+public:
+    // Reads the primitives of path the way InitializeEnv does, false on failure
+    bool load(const char* path, bool use_cache, double resolution, int angles) {
+        EnvNAVXYTHETALATCfg.cellsize_m = resolution;
+        EnvNAVXYTHETALATCfg.NumThetaDirs = angles;
+        EnvNAVXYTHETALATCfg.mprimV.clear();
+        set_mprim_cache_file(use_cache ? std::string(path) + MPRIM_CACHE_SUFFIX : "");
+        FILE* file = fopen(path, "r");
+        if(file == NULL) {
+            return false;
+        }
+        bool good = ReadMotionPrimitives(file);
+        fclose(file);
+        return good;
+    }
+
+    const std::vector<SBPL_xytheta_mprimitive>& prims() const {
+        return EnvNAVXYTHETALATCfg.mprimV;
+    }
+};
+
+bool same_prims(const std::vector<SBPL_xytheta_mprimitive>& a, const std::vector<SBPL_xytheta_mprimitive>& b)
+{
+    if(a.size() != b.size()) {
+        return false;
+    }
+    for(size_t i = 0; i < a.size(); i++) {
+        if(a[i].motprimID != b[i].motprimID || a[i].starttheta_c != b[i].starttheta_c ||
+                a[i].additionalactioncostmult != b[i].additionalactioncostmult ||
+                a[i].endcell.x != b[i].endcell.x || a[i].endcell.y != b[i].endcell.y ||
+                a[i].endcell.theta != b[i].endcell.theta || a[i].intermptV.size() != b[i].intermptV.size()) {
+            return false;
+        }
+        for(size_t p = 0; p < a[i].intermptV.size(); p++) {
+            if(a[i].intermptV[p].x != b[i].intermptV[p].x || a[i].intermptV[p].y != b[i].intermptV[p].y ||
+                    a[i].intermptV[p].theta != b[i].intermptV[p].theta) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*
+ * Microseconds for one InitializeEnv on an empty map
+ */
+double time_initialize(const char* path, bool use_cache, double resolution)
+{
+    std::vector<unsigned char> map(BENCH_MAP_SIZE * BENCH_MAP_SIZE, 0);
+    std::vector<sbpl_2Dpt_t> perimeter;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < BENCH_REPS; i++) {
+        mprim_cache_environment env;
+        env.set_mprim_cache_file(use_cache ? std::string(path) + MPRIM_CACHE_SUFFIX : "");
+        env.InitializeEnv(BENCH_MAP_SIZE, BENCH_MAP_SIZE, map.data(), 1, 1, 0, BENCH_MAP_SIZE - 2, BENCH_MAP_SIZE - 2, 0,
+                          0.0, 0.0, 0.0, perimeter, resolution, 20, 10, 254, path);
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / BENCH_REPS;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<const char*> files;
+    for(int i = 1; i < argc; i++) {
+        files.push_back(argv[i]);
+    }
+    if(files.empty()) {
+        files.push_back("./res/plane_simple.mprim");
+        files.push_back("./motion_prim_file.mprim");
+    }
+
+    std::printf("%-32s %6s %6s %10s %10s %8s %12s %12s\n", "file", "angles", "prims",
+                "text(us)", "cache(us)", "speedup", "init txt(us)", "init bin(us)");
+    for(const char* path : files) {
+        double resolution = 0;
+        int angles = 0;
+        FILE* file = fopen(path, "r");
+        if(file == NULL || fscanf(file, "resolution_m: %lf numberofangles: %d", &resolution, &angles) != 2) {
+            std::printf("%s: not a motion primitive file\n", path);
+            if(file != NULL) {
+                fclose(file);
+            }
+            return 1;
+        }
+        fclose(file);
+
+        bench_environment text_env;
+        bench_environment cache_env;
+        //The first cached load writes the cache
+        if(!text_env.load(path, false, resolution, angles) || !cache_env.load(path, true, resolution, angles)) {
+            std::printf("%s: failed to load\n", path);
+            return 1;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < BENCH_REPS; i++) {
+            text_env.load(path, false, resolution, angles);
+        }
+        double text_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / BENCH_REPS;
+
+        start = std::chrono::steady_clock::now();
+        for(int i = 0; i < BENCH_REPS; i++) {
+            cache_env.load(path, true, resolution, angles);
+        }
+        double cache_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / BENCH_REPS;
+
+        if(!cache_env.mprim_cache_hit() || !same_prims(text_env.prims(), cache_env.prims())) {
+            std::printf("%s: cached primitives differ from the text\n", path);
+            return 1;
+        }
+
+        double init_text_us = time_initialize(path, false, resolution);
+        double init_cache_us = time_initialize(path, true, resolution);
+        std::printf("%-32s %6d %6zu %10.1f %10.1f %7.1fx %12.1f %12.1f\n", path, angles, text_env.prims().size(),
+                    text_us, cache_us, text_us / cache_us, init_text_us, init_cache_us);
+    }
+    return 0;
+}
@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////
+// bench_path_json.cpp - Path serialization against the json DOM - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+// Serializes the same path with the cpprest json DOM and with write_path_json,
+// for 10 to 100000 points, and checks the DOM reads back what was written.
+
+#include "path_json.hpp"
+#include "util.hpp"
+
+#include <cpprest/json.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+/*
+ * A random walk of count points, in meters and radians like SBPL paths
+ */
+std::vector<sbpl_xy_theta_pt_t> make_path(int count)
+{
+    std::mt19937 rng(count);
+    std::uniform_real_distribution<double> step(-1.0, 1.0);
+    std::uniform_int_distribution<int> heading(0, 15);
+    std::vector<sbpl_xy_theta_pt_t> path;
+    double x = 2500;
+    double y = 2500;
+    for(int i = 0; i < count; i++) {
+        x += step(rng);
+        y += step(rng);
+        path.push_back(sbpl_xy_theta_pt_t(x, y, heading(rng) * 2 * M_PI / 16));
+    }
+    return path;
+}
+
+/*
+ * The same body built as a DOM
+ */
+std::string write_path_dom(const std::vector<sbpl_xy_theta_pt_t>& path)
+{
+    web::json::value points = web::json::value::array(path.size());
+    for(size_t i = 0; i < path.size(); i++) {
+        web::json::value point = web::json::value::object();
+        point[U("x")] = web::json::value(path[i].x);
+        point[U("y")] = web::json::value(path[i].y);
+        point[U("theta")] = web::json::value(RAD_TO_DEG(path[i].theta));
+        points[i] = point;
+    }
+    web::json::value body = web::json::value::object();
+    body[U("path")] = points;
+    return utility::conversions::to_utf8string(body.serialize());
+}
+
+/*
+ * Reads a written body back with the DOM, false if a value is off by more than the rounding
+ */
+bool same_path(const std::string& body, const std::vector<sbpl_xy_theta_pt_t>& path)
+{
+    web::json::value parsed = web::json::value::parse(utility::conversions::to_string_t(body));
+    const web::json::array& points = parsed.at(U("path")).as_array();
+    if(points.size() != path.size()) {
+        return false;
+    }
+    size_t i = 0;
+    for(const web::json::value& point : points) {
+        if(std::fabs(point.at(U("x")).as_double() - path[i].x) > 0.0005 ||
+                std::fabs(point.at(U("y")).as_double() - path[i].y) > 0.0005 ||
+                std::fabs(point.at(U("theta")).as_double() - RAD_TO_DEG(path[i].theta)) > 0.0005) {
+            return false;
+        }
+        i++;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    const int counts[] = {10, 100, 1000, 10000, 100000};
+    std::string body; //Reused like communicator does
+
+    std::printf("%10s %10s %10s %12s %12s %8s\n", "points", "dom bytes", "bytes", "dom(us)", "direct(us)", "speedup");
+    for(int count : counts) {
+        std::vector<sbpl_xy_theta_pt_t> path = make_path(count);
+        int reps = std::max(3, 200000 / count);
+
+        size_t dom_bytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < reps; i++) {
+            dom_bytes = write_path_dom(path).size();
+        }
+        auto dom_time = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        for(int i = 0; i < reps; i++) {
+            write_path_json(path, body);
+        }
+        auto direct_time = std::chrono::steady_clock::now() - start;
+
+        if(!same_path(body, path)) {
+            std::printf("Written path does not read back with %d points\n", count);
+            return 1;
+        }
+
+        double dom_us = std::chrono::duration<double, std::micro>(dom_time).count() / reps;
+        double direct_us = std::chrono::duration<double, std::micro>(direct_time).count() / reps;
+        std::printf("%10d %10zu %10zu %12.1f %12.1f %7.1fx\n", count, dom_bytes, body.size(), dom_us, direct_us,
+                    dom_us / direct_us);
+    }
+    return 0;
+}
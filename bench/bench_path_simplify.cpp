@@ -0,0 +1,201 @@
+///////////////////////////////////////////////////////////////////////////////
+// bench_path_simplify.cpp - Waypoints against route length - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+// Builds lattice style routes of 100 m to 10 km, 10 poses per motion primitive
+// like res/plane_simple.mprim, through a field of inflated obstacles that keep
+// clear of the route, and reduces them to waypoints. Prints poses, waypoints
+// and time, and checks every waypoint segment is clear and every pose is
+// within the tolerance of its segment.
+//
+// Usage: bench_path_simplify [tolerance_m] [max_route_m]
+
+#include "path_simplify.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// Poses per primitive, meters per primitive and heading change of a turn
+#define POSES_PER_PRIMITIVE 10
+#define PRIMITIVE_LENGTH_M 4.0
+#define TURN_RAD (M_PI / 8)
+// Obstacle radius, inflation and how far they keep from the route, in cells
+#define OBSTACLE_RADIUS 4
+#define OBSTACLE_INFLATION 6
+#define OBSTACLE_CLEARANCE 3
+#define GRID_MARGIN 40
+#define BENCH_REPS 5
+
+struct bench_map_t {
+    std::vector<sbpl_xy_theta_pt_t> path;
+    std::vector<unsigned char> cells; //Column major
+    std::vector<const unsigned char*> columns;
+    path_grid_t grid;
+};
+
+/*
+ * A route of straights and gentle turns, shifted onto a grid that holds it,
+ * and an obstacle every 10 m or so beside it
+ */
+void make_map(double route_m, bench_map_t& map)
+{
+    std::mt19937 rng((int)route_m);
+    std::uniform_int_distribution<int> pick(0, 5);
+    double x = 0;
+    double y = 0;
+    double theta = 0;
+    map.path.clear();
+    map.path.push_back(sbpl_xy_theta_pt_t(x, y, theta));
+    int primitives = (int)(route_m / PRIMITIVE_LENGTH_M);
+    for(int p = 0; p < primitives; p++) {
+        int kind = pick(rng);
+        double turn = kind == 0 ? TURN_RAD : (kind == 1 ? -TURN_RAD : 0);
+        for(int i = 1; i <= POSES_PER_PRIMITIVE; i++) {
+            double heading = theta + turn * (i - 0.5) / POSES_PER_PRIMITIVE;
+            x += PRIMITIVE_LENGTH_M / POSES_PER_PRIMITIVE * std::cos(heading);
+            y += PRIMITIVE_LENGTH_M / POSES_PER_PRIMITIVE * std::sin(heading);
+            map.path.push_back(sbpl_xy_theta_pt_t(x, y, std::fmod(theta + turn * i / POSES_PER_PRIMITIVE + 2 * M_PI, 2 * M_PI)));
+        }
+        theta += turn;
+    }
+
+    double min_x = x, min_y = y, max_x = x, max_y = y;
+    for(const sbpl_xy_theta_pt_t& pose : map.path) {
+        min_x = std::min(min_x, pose.x);
+        min_y = std::min(min_y, pose.y);
+        max_x = std::max(max_x, pose.x);
+        max_y = std::max(max_y, pose.y);
+    }
+    for(sbpl_xy_theta_pt_t& pose : map.path) {
+        pose.x += GRID_MARGIN - min_x;
+        pose.y += GRID_MARGIN - min_y;
+    }
+    int width = (int)(max_x - min_x) + 2 * GRID_MARGIN;
+    int height = (int)(max_y - min_y) + 2 * GRID_MARGIN;
+    map.cells.assign((size_t)width * height, 0);
+    map.columns.resize(width);
+    for(int i = 0; i < width; i++) {
+        map.columns[i] = map.cells.data() + (size_t)i * height;
+    }
+    map.grid = {map.columns.data(), width, height, 1.0};
+
+    //Obstacles beside the route, dropped if their inflation would reach it
+    std::uniform_real_distribution<double> offset(-25, 25);
+    int reach = OBSTACLE_RADIUS + OBSTACLE_INFLATION + OBSTACLE_CLEARANCE;
+    for(size_t i = 0; i < map.path.size(); i += 25) {
+        int ox = (int)(map.path[i].x + offset(rng));
+        int oy = (int)(map.path[i].y + offset(rng));
+        bool clear = true;
+        for(size_t j = i >= 200 ? i - 200 : 0; j < std::min(map.path.size(), i + 200) && clear; j++) {
+            clear = std::hypot(map.path[j].x - ox, map.path[j].y - oy) > reach;
+        }
+        if(!clear) {
+            continue;
+        }
+        int size = OBSTACLE_RADIUS + OBSTACLE_INFLATION;
+        for(int cx = std::max(0, ox - size); cx <= std::min(width - 1, ox + size); cx++) {
+            for(int cy = std::max(0, oy - size); cy <= std::min(height - 1, oy + size); cy++) {
+                double distance = std::hypot(cx - ox, cy - oy);
+                unsigned char cost = 0;
+                if(distance <= OBSTACLE_RADIUS) {
+                    cost = 254;
+                } else if(distance <= size) {
+                    cost = (unsigned char)(253 * (1.0 - (distance - OBSTACLE_RADIUS) / OBSTACLE_INFLATION));
+                }
+                unsigned char& cell = map.cells[(size_t)cx * height + cy];
+                cell = std::max(cell, cost);
+            }
+        }
+    }
+}
+
+/*
+ * Every waypoint is a pose of the path in order, every shortcut is clear and
+ * every pose in between is within tolerance of it
+ */
+bool check_waypoints(const bench_map_t& map, const std::vector<sbpl_xy_theta_pt_t>& waypoints, double tolerance_m)
+{
+    size_t pose = 0;
+    for(size_t w = 0; w + 1 < waypoints.size(); w++) {
+        while(pose < map.path.size() && (map.path[pose].x != waypoints[w].x || map.path[pose].y != waypoints[w].y)) {
+            pose++;
+        }
+        size_t first = pose;
+        size_t last = first + 1;
+        while(last < map.path.size() && (map.path[last].x != waypoints[w + 1].x ||
+                                         map.path[last].y != waypoints[w + 1].y)) {
+            last++;
+        }
+        if(last >= map.path.size()) {
+            return false;
+        }
+        const sbpl_xy_theta_pt_t& a = map.path[first];
+        const sbpl_xy_theta_pt_t& b = map.path[last];
+        unsigned char max_cost = 0;
+        for(size_t i = first; i <= last; i++) {
+            const sbpl_xy_theta_pt_t& p = map.path[i];
+            max_cost = std::max(max_cost, map.columns[(int)p.x][(int)p.y]);
+            double dx = b.x - a.x;
+            double dy = b.y - a.y;
+            double length2 = dx * dx + dy * dy;
+            double t = length2 > 0 ? std::max(0.0, std::min(1.0, ((p.x - a.x) * dx + (p.y - a.y) * dy) / length2)) : 0;
+            if(std::hypot(p.x - (a.x + t * dx), p.y - (a.y + t * dy)) > tolerance_m + 1e-9) {
+                return false;
+            }
+        }
+        //Neighbouring poses are the planner's own segment, only shortcuts are checked
+        if(last > first + 1 && !segment_clear(map.grid, a.x, a.y, b.x, b.y, max_cost)) {
+            return false;
+        }
+        pose = last;
+    }
+    return waypoints.front().x == map.path.front().x && waypoints.back().x == map.path.back().x;
+}
+
+int main(int argc, char *argv[])
+{
+    double tolerance_m = (argc > 1) ? std::atof(argv[1]) : PATH_SIMPLIFY_DEFAULT_TOLERANCE_M;
+    double max_route_m = (argc > 2) ? std::atof(argv[2]) : 10000;
+    bench_map_t map;
+    std::vector<sbpl_xy_theta_pt_t> waypoints;
+
+    std::printf("tolerance %.2f m, %d poses per %.0f m primitive\n", tolerance_m, POSES_PER_PRIMITIVE,
+                PRIMITIVE_LENGTH_M);
+    std::printf("%10s %10s %10s %10s %12s %14s\n", "route(m)", "poses", "waypoints", "reduction", "simplify(ms)",
+                "us per pose");
+    for(double route_m = 100; route_m <= max_route_m; route_m *= 10) {
+        make_map(route_m, map);
+        auto start = std::chrono::steady_clock::now();
+        for(int rep = 0; rep < BENCH_REPS; rep++) {
+            simplify_path(map.path, map.grid, tolerance_m, waypoints);
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / BENCH_REPS;
+        if(!check_waypoints(map, waypoints, tolerance_m)) {
+            std::printf("Waypoints of the %.0f m route leave the path or cut an obstacle\n", route_m);
+            return 1;
+        }
+        std::printf("%10.0f %10zu %10zu %9.1fx %12.3f %14.3f\n", route_m, map.path.size(), waypoints.size(),
+                    (double)map.path.size() / waypoints.size(), ms, ms * 1000 / map.path.size());
+    }
+    return 0;
+}
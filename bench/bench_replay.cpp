@@ -0,0 +1,158 @@
+///////////////////////////////////////////////////////////////////////////////
+// bench_replay.cpp - Replays captured grid responses - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+// Feeds a capture made with `drops -c` through the same stages as the
+// replanning loop, without the network: parse, rasterize, planner update and
+// plan. Reports the p50, p99 and worst latency of every stage. update includes
+// the planner rebuilds, which are also shown on their own. Like -l, a grid
+// whose changes leave the planner's path_current() is not planned again.
+//
+// Usage: bench_replay capture [recorded] [plan_seconds]
+// With recorded set to 1 the responses are fed at the pace they were captured
+// at, else as fast as they can be processed.
+
+#include "bench_common.hpp"
+#include "communication.hpp"
+#include "grid_capture.hpp"
+#include "plan.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define DEFAULT_PLAN_SECONDS 0.5
+
+/*
+ * Nearest rank percentile of sorted samples
+ */
+double percentile(const std::vector<double>& sorted, double p)
+{
+    if(sorted.empty()) {
+        return 0;
+    }
+    size_t rank = (size_t)(p / 100.0 * sorted.size() + 0.999999);
+    return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+void print_stage(const char* name, std::vector<double> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    std::printf("%-10s %6zu %10.2f %10.2f %10.2f\n", name, samples.size(), percentile(samples, 50),
+                percentile(samples, 99), samples.empty() ? 0.0 : samples.back());
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc < 2) {
+        std::printf("Usage: %s capture [recorded] [plan_seconds]\n", argv[0]);
+        return 1;
+    }
+    bool recorded = (argc > 2) && std::atoi(argv[2]) != 0;
+    double plan_seconds = (argc > 3) ? std::atof(argv[3]) : DEFAULT_PLAN_SECONDS;
+
+    grid_capture_reader reader;
+    if(!reader.open(argv[1])) {
+        std::printf("%s is not a capture file\n", argv[1]);
+        return 1;
+    }
+    communicator my_communicator;
+    if(!import_bench_config(my_communicator)) {
+        return 1;
+    }
+    env_constants_t my_env_const = my_communicator.get_const_data();
+
+    std::vector<double> parse_ms, raster_ms, rebuild_ms, update_ms, plan_ms, total_ms;
+    std::unique_ptr<Planner> my_planner;
+    grid_capture_record_t record;
+    int64_t first_us = 0;
+    auto replay_start = std::chrono::steady_clock::now();
+    int responses = 0;
+    int bad = 0;
+    int paths = 0;
+    int kept_paths = 0;
+    while(reader.next(record)) {
+        if(responses == 0) {
+            first_us = record.time_us;
+        }
+        responses++;
+        if(recorded) {
+            std::this_thread::sleep_until(replay_start + std::chrono::microseconds(record.time_us - first_us));
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        grid_stage_times_t times;
+        if(!my_communicator.apply_grid_body(record.body.data(), record.body.size(),
+                                            record.encoding == GRID_CAPTURE_WIRE, &times)) {
+            bad++;
+            continue;
+        }
+        parse_ms.push_back(times.parse_ms);
+        raster_ms.push_back(times.raster_ms);
+
+        //Same as a tick of the replanning loop
+        auto update_start = std::chrono::steady_clock::now();
+        cell_update_list cells;
+        env_snapshot_ptr my_env = my_communicator.take_update(cells);
+        bool rebuilt = false;
+        if(my_planner == NULL || my_planner->grid_generation() != my_env->grid_generation) {
+            my_planner.reset(new Planner());
+            if(my_planner->initialize(my_env, my_env_const) != 0) {
+                std::printf("Failed to initialize the planner\n");
+                return 1;
+            }
+            rebuild_ms.push_back(ms_since(update_start));
+            rebuilt = true;
+        } else {
+            my_planner->set_start(my_env->data.start_x, my_env->data.start_y, my_env->data.start_theta);
+            my_planner->set_goal(my_env->data.end_x, my_env->data.end_y, my_env->data.end_theta);
+        }
+        my_planner->update_grid_points(cells);
+        update_ms.push_back(ms_since(update_start));
+
+        //Nothing under the last optimal path changed, planning again would find it again
+        if(!rebuilt && my_planner->path_current()) {
+            kept_paths++;
+            paths++;
+            total_ms.push_back(ms_since(start));
+            continue;
+        }
+        auto plan_start = std::chrono::steady_clock::now();
+        auto budget = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                          std::chrono::duration<double>(plan_seconds));
+        paths += my_planner->plan_until(plan_start + budget) ? 1 : 0;
+        plan_ms.push_back(ms_since(plan_start));
+        total_ms.push_back(ms_since(start));
+    }
+
+    std::printf("%d responses, %d bad, %d with path, %d kept without replanning, %s pace, %.0f ms to replay\n",
+                responses, bad, paths, kept_paths, recorded ? "recorded" : "full", ms_since(replay_start));
+    std::printf("%-10s %6s %10s %10s %10s\n", "stage", "count", "p50(ms)", "p99(ms)", "max(ms)");
+    print_stage("parse", parse_ms);
+    print_stage("raster", raster_ms);
+    print_stage("rebuild", rebuild_ms);
+    print_stage("update", update_ms);
+    print_stage("plan", plan_ms);
+    print_stage("total", total_ms);
+    return 0;
+}
@@ -0,0 +1,156 @@
+///////////////////////////////////////////////////////////////////////////////
+// bench_stationary_diff.cpp - Diffed against full stationary obstacle updates - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+
+// Moves, adds and removes a few stationary obstacles every tick, with moving
+// obstacles around, and brings the static layer up to date by stamping only
+// the tiles that changed and by rebuilding it. A copy of the grid kept up to
+// date only from the changed cells is checked against the cost map every tick.
+//
+// Usage: bench_stationary_diff [grid_size] [stationary_obstacles] [changes_per_tick] [ticks]
+
+#include "bench_common.hpp"
+#include "costmap.hpp"
+#include "stationary_tracker.hpp"
+#include "tile_raster.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#define DEFAULT_INFLATION_RADIUS 6
+#define DEFAULT_WEIGHT 0.6
+#define BENCH_MOVING 50
+
+int main(int argc, char *argv[])
+{
+    int size = (argc > 1) ? std::atoi(argv[1]) : 4096;
+    int count = (argc > 2) ? std::atoi(argv[2]) : 2000;
+    int changes = (argc > 3) ? std::atoi(argv[3]) : 2;
+    int ticks = (argc > 4) ? std::atoi(argv[4]) : 10;
+    inflation_params_t inf_param = {DEFAULT_INFLATION_RADIUS, DEFAULT_WEIGHT, INFLATION_STAMP};
+    inflation_stamp_cache cache;
+    thread_pool pool(0);
+
+    std::mt19937 rng(count);
+    std::uniform_int_distribution<int> coord(0, size - 1);
+    std::uniform_int_distribution<int> radius(2, 40);
+    std::uniform_int_distribution<int> pick(0, 2);
+    std::vector<obstacle_t> stationary;
+    for(int i = 0; i < count; i++) {
+        stationary.push_back({coord(rng), coord(rng), radius(rng), 0, 0});
+    }
+    std::vector<obstacle_t> moving;
+    for(int i = 0; i < BENCH_MOVING; i++) {
+        moving.push_back({coord(rng), coord(rng), radius(rng), 0, 0});
+    }
+
+    stamp_list stamps;
+    stationary_tracker tracker;
+    layered_costmap costmap;
+    costmap.reset(size, size);
+    lookup_stamps(stationary, cache, inf_param, stamps);
+    stamp_obstacles_tiled(costmap.static_layer(), stationary, stamps, pool);
+    tracker.update(stationary);
+
+    //What the planner sees, only ever changed through the changed cells
+    std::vector<unsigned char> view((size_t)size * size);
+    for(int y = 0; y < size; y++) {
+        for(int x = 0; x < size; x++) {
+            view[(size_t)y * size + x] = costmap.cost(x, y);
+        }
+    }
+
+    std::printf("grid %dx%d, %d stationary obstacles, %d changed per tick, %u threads\n", size, size, count,
+                changes, pool.size());
+    std::printf("%6s %8s %12s %14s %12s\n", "tick", "tiles", "cells", "diff(ms)", "rebuild(ms)");
+    double diff_total = 0;
+    double rebuild_total = 0;
+    std::vector<int> tiles;
+    stamp_list moving_stamps;
+    for(int tick = 0; tick < ticks; tick++) {
+        for(int i = 0; i < changes; i++) {
+            int which = pick(rng);
+            if(which == 0 || stationary.empty()) {
+                stationary.push_back({coord(rng), coord(rng), radius(rng), 0, 0});
+            } else if(which == 1) {
+                stationary[rng() % stationary.size()] = stationary.back();
+                stationary.pop_back();
+            } else {
+                obstacle_t& obs = stationary[rng() % stationary.size()];
+                obs.x = coord(rng);
+                obs.y = coord(rng);
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        tracker.update(stationary);
+        tracker.dirty_tiles(size, size, cache, inf_param, tiles);
+        lookup_stamps(stationary, cache, inf_param, stamps);
+        costmap.restamp_static(tiles, stationary, stamps, pool);
+        double diff_ms = ms_since(start);
+        size_t cells = costmap.static_dirty_cells().size();
+        for(const cell_update_t& cell : costmap.static_dirty_cells()) {
+            view[(size_t)cell.y * size + cell.x] = cell.cost;
+        }
+
+        start = std::chrono::steady_clock::now();
+        tiled_grid rebuilt;
+        rebuilt.reset(size, size);
+        stamp_obstacles_tiled(rebuilt, stationary, stamps, pool);
+        double rebuild_ms = ms_since(start);
+
+        for(obstacle_t& obs : moving) {
+            obs.x = coord(rng);
+            obs.y = coord(rng);
+        }
+        costmap.begin_dynamic();
+        lookup_stamps(moving, cache, inf_param, moving_stamps);
+        costmap.stamp_dynamic_tiled(moving, moving_stamps, pool);
+        costmap.end_dynamic();
+        for(const cell_update_t& cell : costmap.dirty_cells()) {
+            view[(size_t)cell.y * size + cell.x] = cell.cost;
+        }
+
+        const tiled_grid& layer = costmap.static_layer();
+        for(int y = 0; y < size; y++) {
+            for(int x = 0; x < size; x++) {
+                if(layer.cost(x, y) != rebuilt.cost(x, y)) {
+                    std::printf("Static layer differs from a rebuild at (%d, %d) on tick %d\n", x, y, tick);
+                    return 1;
+                }
+                if(view[(size_t)y * size + x] != costmap.cost(x, y)) {
+                    std::printf("Changed cells missed (%d, %d) on tick %d\n", x, y, tick);
+                    return 1;
+                }
+            }
+        }
+
+        std::printf("%6d %8zu %12zu %14.2f %12.2f\n", tick, tiles.size(), cells, diff_ms, rebuild_ms);
+        diff_total += diff_ms;
+        rebuild_total += rebuild_ms;
+    }
+    if(ticks > 0) {
+        std::printf("average diff %.2f ms, rebuild %.2f ms, %.1fx\n", diff_total / ticks, rebuild_total / ticks,
+                    rebuild_total / diff_total);
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+///////////////////////////////////////////////////////////////////////////////
+// bench_tile_raster.cpp - Tile parallel rasterization scaling - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+// Rasterizes random obstacles one stamp at a time, then tile by tile with 1
+// to N threads, into a plain grid and into the dynamic layer of a
+// layered_costmap. Checks every result matches the serial grid.
+//
+// Usage: bench_tile_raster [grid_size] [obstacles] [max_threads]
+
+#include "bench_common.hpp"
+#include "costmap.hpp"
+#include "raster.hpp"
+#include "tile_raster.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#define DEFAULT_INFLATION_RADIUS 6
+#define DEFAULT_WEIGHT 0.6
+#define BENCH_REPS 5
+
+int main(int argc, char *argv[])
+{
+    int size = (argc > 1) ? std::atoi(argv[1]) : 4096;
+    int count = (argc > 2) ? std::atoi(argv[2]) : 1000;
+    const int radii[] = {5, 10, 20, 40, 80};
+    inflation_params_t inf_param = {DEFAULT_INFLATION_RADIUS, DEFAULT_WEIGHT, INFLATION_STAMP};
+    inflation_stamp_cache cache;
+
+    std::mt19937 rng(count);
+    std::uniform_int_distribution<int> coord(-50, size + 50);
+    std::uniform_int_distribution<int> pick(0, sizeof(radii) / sizeof(radii[0]) - 1);
+    std::vector<obstacle_t> obstacles;
+    for(int i = 0; i < count; i++) {
+        obstacles.push_back({coord(rng), coord(rng), radii[pick(rng)], 0, 0});
+    }
+    stamp_list stamps;
+    lookup_stamps(obstacles, cache, inf_param, stamps);
+
+    //Serial reference
+    std::vector<unsigned char> serial((size_t)size * size, 0);
+    auto start = std::chrono::steady_clock::now();
+    for(int rep = 0; rep < BENCH_REPS; rep++) {
+        std::fill(serial.begin(), serial.end(), 0);
+        for(size_t i = 0; i < obstacles.size(); i++) {
+            stamp_max(serial.data(), size, size, *stamps[i], obstacles[i].x, obstacles[i].y);
+        }
+    }
+    double serial_ms = ms_since(start) / BENCH_REPS;
+
+    //Serial dynamic layer, begin/end_dynamic included
+    layered_costmap costmap;
+    costmap.reset(size, size);
+    start = std::chrono::steady_clock::now();
+    for(int rep = 0; rep < BENCH_REPS; rep++) {
+        costmap.begin_dynamic();
+        for(size_t i = 0; i < obstacles.size(); i++) {
+            costmap.stamp_dynamic(*stamps[i], obstacles[i].x, obstacles[i].y);
+        }
+        costmap.end_dynamic();
+    }
+    double serial_dynamic_ms = ms_since(start) / BENCH_REPS;
+
+    std::printf("grid %dx%d, %d obstacles, %dx%d tiles\n", size, size, count, RASTER_TILE_SIZE, RASTER_TILE_SIZE);
+    std::printf("serial static %.2f ms, dynamic %.2f ms\n", serial_ms, serial_dynamic_ms);
+    std::printf("%8s %12s %9s %12s %9s\n", "threads", "static(ms)", "speedup", "dynamic(ms)", "speedup");
+
+    unsigned int max_threads = (argc > 3) ? std::atoi(argv[3]) : std::thread::hardware_concurrency();
+    max_threads = std::max(1u, max_threads);
+    std::vector<unsigned int> thread_counts;
+    for(unsigned int threads = 1; threads < max_threads; threads *= 2) {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    std::vector<unsigned char> tiled((size_t)size * size, 0);
+    for(unsigned int threads : thread_counts) {
+        thread_pool pool(threads);
+
+        start = std::chrono::steady_clock::now();
+        for(int rep = 0; rep < BENCH_REPS; rep++) {
+            std::fill(tiled.begin(), tiled.end(), 0);
+            stamp_obstacles_tiled(tiled.data(), size, size, obstacles, stamps, pool);
+        }
+        double static_ms = ms_since(start) / BENCH_REPS;
+        if(tiled != serial) {
+            std::printf("Tiled grid differs from the serial one with %u threads\n", threads);
+            return 1;
+        }
+
+        costmap.reset(size, size);
+        start = std::chrono::steady_clock::now();
+        for(int rep = 0; rep < BENCH_REPS; rep++) {
+            costmap.begin_dynamic();
+            costmap.stamp_dynamic_tiled(obstacles, stamps, pool);
+            costmap.end_dynamic();
+        }
+        double dynamic_ms = ms_since(start) / BENCH_REPS;
+        for(int y = 0; y < size; y++) {
+            for(int x = 0; x < size; x++) {
+                if(costmap.cost(x, y) != serial[(size_t)y * size + x]) {
+                    std::printf("Tiled dynamic layer differs from the serial grid with %u threads\n", threads);
+                    return 1;
+                }
+            }
+        }
+
+        std::printf("%8u %12.2f %8.1fx %12.2f %8.1fx\n", threads, static_ms, serial_ms / static_ms,
+                    dynamic_ms, serial_dynamic_ms / dynamic_ms);
+    }
+    return 0;
+}
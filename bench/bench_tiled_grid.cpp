@@ -0,0 +1,98 @@
+///////////////////////////////////////////////////////////////////////////////
+// bench_tiled_grid.cpp - Dense vs tiled static layer rebuilds - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+
+// Rebuilds the static layer of a large, mostly empty map the old way, a
+// zeroed dense grid, and as a tiled_grid, for a growing number of stationary
+// obstacles. Prints the time and memory of both and checks they match.
+//
+// Usage: bench_tiled_grid [grid_size] [threads]
+
+#include "bench_common.hpp"
+#include "raster.hpp"
+#include "tile_raster.hpp"
+#include "tiled_grid.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#define DEFAULT_INFLATION_RADIUS 6
+#define DEFAULT_WEIGHT 0.6
+#define BENCH_REPS 3
+
+int main(int argc, char *argv[])
+{
+    int size = (argc > 1) ? std::atoi(argv[1]) : 20000;
+    thread_pool pool((argc > 2) ? std::atoi(argv[2]) : 0);
+    const int counts[] = {10, 100, 1000, 10000};
+    inflation_params_t inf_param = {DEFAULT_INFLATION_RADIUS, DEFAULT_WEIGHT, INFLATION_STAMP};
+    inflation_stamp_cache cache;
+
+    std::printf("grid %dx%d, %.1f MB dense, %u threads\n", size, size, (double)size * size / 1e6, pool.size());
+    std::printf("%10s %12s %12s %12s %12s %10s\n", "obstacles", "dense(ms)", "tiled(ms)", "dense(MB)",
+                "tiled(MB)", "tiles");
+    for(int count : counts) {
+        std::mt19937 rng(count);
+        std::uniform_int_distribution<int> coord(0, size - 1);
+        std::uniform_int_distribution<int> radius(2, 40);
+        std::vector<obstacle_t> obstacles;
+        for(int i = 0; i < count; i++) {
+            obstacles.push_back({coord(rng), coord(rng), radius(rng), 0, 0});
+        }
+        stamp_list stamps;
+        lookup_stamps(obstacles, cache, inf_param, stamps);
+
+        //What every has_changed update used to do: a new zeroed grid, then the obstacles
+        double dense_ms = 0;
+        std::vector<unsigned char> dense;
+        for(int rep = 0; rep < BENCH_REPS; rep++) {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<unsigned char>((size_t)size * size, 0).swap(dense);
+            stamp_obstacles_tiled(dense.data(), size, size, obstacles, stamps, pool);
+            dense_ms += ms_since(start) / BENCH_REPS;
+        }
+
+        double tiled_ms = 0;
+        tiled_grid tiled;
+        for(int rep = 0; rep < BENCH_REPS; rep++) {
+            auto start = std::chrono::steady_clock::now();
+            tiled.reset(size, size);
+            stamp_obstacles_tiled(tiled, obstacles, stamps, pool);
+            tiled_ms += ms_since(start) / BENCH_REPS;
+        }
+
+        for(int y = 0; y < size; y++) {
+            const unsigned char* row = &dense[(size_t)y * size];
+            for(int x = 0; x < size; x++) {
+                if(tiled.cost(x, y) != row[x]) {
+                    std::printf("Tiled grid differs from the dense one at (%d, %d)\n", x, y);
+                    return 1;
+                }
+            }
+        }
+
+        std::printf("%10d %12.2f %12.2f %12.1f %12.1f %4zu/%zu\n", count, dense_ms, tiled_ms,
+                    (double)dense.size() / 1e6, (double)tiled.memory_bytes() / 1e6, tiled.allocated_tiles(),
+                    tiled.tile_count());
+    }
+    return 0;
+}
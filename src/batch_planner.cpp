@@ -0,0 +1,244 @@
+///////////////////////////////////////////////////////////////////////////////
+// batch_planner.cpp - Plans many vehicles over one shared map - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "batch_planner.hpp"
+
+#include <chrono>
+#include <string>
+
+shared_grid_environment::shared_grid_environment()
+{
+
+}
+
+/*
+ * SBPL deletes every column of the grid, the shared ones are not ours
+ */
+shared_grid_environment::~shared_grid_environment()
+{
+    if(m_grid != NULL) {
+        for(int x = 0; x < EnvNAVXYTHETALATCfg.EnvWidth_c; x++) {
+            EnvNAVXYTHETALATCfg.Grid2D[x] = NULL;
+        }
+    }
+}
+
+/*
+ * SBPL keeps the grid as one array per column, Grid2D[x][y]. Pointing the
+ * columns into the shared grid is all it takes to share it.
+ */
+bool shared_grid_environment::share_grid(std::shared_ptr<const shared_grid_t> grid)
+{
+    if(grid == NULL || grid->width != EnvNAVXYTHETALATCfg.EnvWidth_c ||
+            grid->height != EnvNAVXYTHETALATCfg.EnvHeight_c) {
+        return false;
+    }
+    for(int x = 0; x < grid->width; x++) {
+        if(m_grid == NULL) {
+            delete[] EnvNAVXYTHETALATCfg.Grid2D[x];
+        }
+        EnvNAVXYTHETALATCfg.Grid2D[x] = const_cast<unsigned char*>(&grid->cells[(size_t)x * grid->height]);
+    }
+    m_grid = grid;
+    return true;
+}
+
+batch_planner::batch_planner(const planner_config_t &config, unsigned int threads) :
+    m_config(config),
+    m_planning_time(1.0),
+    m_first_solution(true),
+    m_env_const(),
+    m_pool(threads)
+{
+
+}
+
+batch_planner::~batch_planner()
+{
+
+}
+
+/*
+ * Makes the shared grid and the first search. The first search is made here,
+ * on one thread, so it is the only one that may write the primitive cache.
+ * returns 0 on success, otherwise some error code
+ */
+int batch_planner::initialize(env_snapshot_ptr snapshot, env_constants_t &env_const)
+{
+    if(snapshot == NULL) {
+        return 1;
+    }
+    const env_data_t &env_data = snapshot->data;
+    std::shared_ptr<shared_grid_t> grid = std::make_shared<shared_grid_t>();
+    grid->width = env_data.width;
+    grid->height = env_data.height;
+    grid->cells.assign((size_t)env_data.width * env_data.height, 0);
+    std::vector<unsigned char*> columns(env_data.width);
+    for(int x = 0; x < env_data.width; x++) {
+        columns[x] = &grid->cells[(size_t)x * env_data.height];
+    }
+    env_data.grid_2d->copy_columns(columns.data());
+
+    {
+        std::lock_guard<std::mutex> lock(m_search_mutex);
+        m_idle_searches.clear();
+        m_searches.clear();
+    }
+    m_snapshot = snapshot;
+    m_env_const = env_const;
+    m_grid = grid;
+
+    std::unique_ptr<search_t> search = create_search();
+    if(search == NULL) {
+        return 2;
+    }
+    std::lock_guard<std::mutex> lock(m_search_mutex);
+    m_idle_searches.push_back(search.get());
+    m_searches.push_back(std::move(search));
+    return 0;
+}
+
+void batch_planner::set_planning_time(double seconds)
+{
+    m_planning_time = seconds;
+}
+
+void batch_planner::set_first_solution(bool first_solution)
+{
+    m_first_solution = first_solution;
+}
+
+/*
+ * Runs the queries on the pool, each thread on a search of its own
+ */
+std::vector<batch_result_t> batch_planner::plan(const std::vector<batch_query_t> &queries)
+{
+    std::vector<batch_result_t> results(queries.size());
+    if(m_grid == NULL) {
+        for(auto& result : results) {
+            result.status = BATCH_NO_PATH;
+        }
+        return results;
+    }
+    m_pool.parallel_for(queries.size(), [this, &queries, &results](size_t i) {
+        search_t* search = acquire_search();
+        if(search == NULL) {
+            results[i] = batch_result_t {BATCH_NO_PATH, 0, 0.0, 0.0, std::vector<sbpl_xy_theta_pt_t>()};
+            return;
+        }
+        plan_query(*search, queries[i], results[i]);
+        release_search(search);
+    });
+    return results;
+}
+
+unsigned int batch_planner::threads() const
+{
+    return m_pool.size();
+}
+
+size_t batch_planner::searches() const
+{
+    std::lock_guard<std::mutex> lock(m_search_mutex);
+    return m_searches.size();
+}
+
+/*
+ * Initializes an environment on an empty map and swaps the shared grid in.
+ * The start and goal given to InitializeEnv do not matter, every query sets its own.
+ * Returns NULL on failure
+ */
+std::unique_ptr<batch_planner::search_t> batch_planner::create_search()
+{
+    std::unique_ptr<search_t> search(new search_t());
+    const env_data_t &env_data = m_snapshot->data;
+    search->env.set_mprim_cache_file(std::string(m_env_const.motion_prim_file) + MPRIM_CACHE_SUFFIX);
+    bool ret = search->env.InitializeEnv(env_data.width, env_data.height, NULL,
+                                         env_data.start_x, env_data.start_y, DEG_TO_RAD(env_data.start_theta % 360),
+                                         env_data.end_x, env_data.end_y, DEG_TO_RAD(env_data.end_theta % 360),
+                                         0.0, 0.0, 0.0, //These params are unused
+                                         m_perimeter, m_env_const.cellsize_m,
+                                         m_env_const.est_velocity, m_env_const.timetoturn45degs,
+                                         m_env_const.obs_thresh, m_env_const.motion_prim_file);
+    if(!ret || !search->env.share_grid(m_grid)) {
+        return NULL;
+    }
+    if(m_config.type == PLANNER_AD) {
+        search->planner.reset(new ADPlanner(&search->env, m_config.search_forward));
+    } else {
+        search->planner.reset(new ARAPlanner(&search->env, m_config.search_forward));
+    }
+    search->planner->set_initialsolution_eps(m_config.initial_epsilon);
+    return search;
+}
+
+/*
+ * An idle search, or a new one. There are never more searches than threads.
+ * Returns NULL if a new one could not be made
+ */
+batch_planner::search_t* batch_planner::acquire_search()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_search_mutex);
+        if(!m_idle_searches.empty()) {
+            search_t* search = m_idle_searches.back();
+            m_idle_searches.pop_back();
+            return search;
+        }
+    }
+    //Made outside the lock, it copies the whole map once before sharing it
+    std::unique_ptr<search_t> search = create_search();
+    if(search == NULL) {
+        return NULL;
+    }
+    std::lock_guard<std::mutex> lock(m_search_mutex);
+    m_searches.push_back(std::move(search));
+    return m_searches.back().get();
+}
+
+void batch_planner::release_search(search_t* search)
+{
+    std::lock_guard<std::mutex> lock(m_search_mutex);
+    m_idle_searches.push_back(search);
+}
+
+void batch_planner::plan_query(search_t &search, const batch_query_t &query, batch_result_t &result)
+{
+    auto start = std::chrono::steady_clock::now();
+    result.status = BATCH_NO_PATH;
+    result.cost = 0;
+    result.epsilon = 0;
+    result.path.clear();
+
+    int start_id = search.env.SetStart(query.start_x, query.start_y, DEG_TO_RAD(query.start_theta % 360));
+    int goal_id = search.env.SetGoal(query.goal_x, query.goal_y, DEG_TO_RAD(query.goal_theta % 360));
+    if(start_id < 0 || goal_id < 0 ||
+            search.planner->set_start(start_id) == 0 || search.planner->set_goal(goal_id) == 0) {
+        result.status = BATCH_OFF_MAP;
+    } else {
+        search.planner->set_search_mode(m_first_solution);
+        std::vector<int> solution_IDs;
+        if(search.planner->replan(m_planning_time, &solution_IDs, &result.cost) == 1) {
+            result.status = BATCH_PATH_FOUND;
+            result.epsilon = search.planner->get_solution_eps();
+            search.env.ConvertStateIDPathintoXYThetaPath(&solution_IDs, &result.path);
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,136 @@
+///////////////////////////////////////////////////////////////////////////////
+// batch_planner.h - Plans many vehicles over one shared map - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef BATCH_PLANNER_H
+#define BATCH_PLANNER_H
+
+#include "plan.hpp"
+#include "thread_pool.hpp"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// One vehicle to plan for, in the units of env_data_t
+struct batch_query_t {
+    int start_x, start_y, start_theta;
+    int goal_x, goal_y, goal_theta;
+};
+
+// What batch_result_t::status can be
+#define BATCH_PATH_FOUND 0
+#define BATCH_OFF_MAP 1 //Start or goal is off the map
+#define BATCH_NO_PATH 2 //No path, or none found in time
+
+struct batch_result_t {
+    int status;
+    int cost;
+    double epsilon;
+    double seconds;
+    std::vector<sbpl_xy_theta_pt_t> path;
+};
+
+// ARA* forwards from epsilon 3. Every query has a new start and goal, so AD*'s repairs do not help.
+const planner_config_t DEFAULT_BATCH_CONFIG = {"ara_forward_3", PLANNER_ARA, true, 3.0};
+
+// Read only grid in SBPL's layout, cells[x * height + y]
+struct shared_grid_t {
+    int width;
+    int height;
+    std::vector<unsigned char> cells;
+};
+
+/*
+ * Environment whose grid is a shared_grid_t instead of its own copy. Only
+ * for searching, UpdateCost would write to every environment sharing it.
+ */
+class shared_grid_environment : public mprim_cache_environment {
+public:
+    shared_grid_environment();
+    virtual ~shared_grid_environment();
+
+    // Frees the grid InitializeEnv copied and reads grid instead. Sizes have to match.
+    bool share_grid(std::shared_ptr<const shared_grid_t> grid);
+
+private:
+    std::shared_ptr<const shared_grid_t> m_grid;
+};
+
+/*
+ * Plans paths for many vehicles at once over one map.
+ *
+ * The map is stored once and shared by the environments of all threads. Every
+ * thread gets its own environment and search, made the first time the thread
+ * needs one and reused for every query after that.
+ *
+ * SBPL times its searches with clock(), which counts the CPU time of every
+ * thread, so with N threads busy a search gets about 1/N of planning_time.
+ */
+class batch_planner {
+public:
+    // threads counts the caller, 0 means one per core
+    explicit batch_planner(const planner_config_t &config = DEFAULT_BATCH_CONFIG, unsigned int threads = 0);
+    virtual ~batch_planner();
+
+    // Shares the grid of snapshot with every search. Returns 0 on success.
+    int initialize(env_snapshot_ptr snapshot, env_constants_t &env_const);
+    // Longest each query searches for, in seconds
+    void set_planning_time(double seconds);
+    // Stop each query at its first path instead of improving it, on by default
+    void set_first_solution(bool first_solution);
+    // Plans every query, results are in the order of queries
+    std::vector<batch_result_t> plan(const std::vector<batch_query_t> &queries);
+
+    unsigned int threads() const;
+    // Environments made so far, at most one per thread
+    size_t searches() const;
+
+private:
+    batch_planner(const batch_planner&);
+    batch_planner& operator=(const batch_planner&);
+
+    // An environment and the planner searching it, used by one query at a time
+    struct search_t {
+        shared_grid_environment env;
+        std::unique_ptr<SBPLPlanner> planner;
+    };
+
+    std::unique_ptr<search_t> create_search();
+    search_t* acquire_search();
+    void release_search(search_t* search);
+    void plan_query(search_t &search, const batch_query_t &query, batch_result_t &result);
+
+    planner_config_t m_config;
+    double m_planning_time;
+    bool m_first_solution;
+
+    env_snapshot_ptr m_snapshot;
+    env_constants_t m_env_const;
+    std::shared_ptr<const shared_grid_t> m_grid;
+
+    std::vector<sbpl_2Dpt_t> m_perimeter;
+
+    mutable std::mutex m_search_mutex; //Guards the lists below
+    std::vector<std::unique_ptr<search_t> > m_searches;
+    std::vector<search_t*> m_idle_searches;
+
+    thread_pool m_pool;
+};
+
+#endif /* BATCH_PLANNER_H */
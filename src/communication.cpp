@@ -18,6 +18,9 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "communication.hpp"
+#include "distance_transform.hpp"
+#include "grid_wire.hpp"
+#include "tile_raster.hpp"
 
 #include <algorithm>
 #include <chrono>
@@ -29,22 +32,38 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/numeric/conversion/cast.hpp>
 
-
-#define BOUND_VALUE(val,min,max) (val<min)?min:(val>max)?max:val
-
 using namespace web::http;
 using namespace web::http::client;
+using namespace web::websockets::client;
 
 
 communicator::communicator():
+    grid_had_changed(true),
     m_updated(false),
     m_update_next_time(true),
     m_posted(false),
     m_env_data(),
     m_env_const(),
+    m_static_inf_params(),
+    m_grid_generation(0),
+    m_pending_updates(0),
+    m_update_counters(),
     m_task_update([]() {}),
+              m_update_running(false),
+              m_update_count(0),
+              m_subscribed(false),
+              m_long_polling(false),
+              m_poll_rate_hz(DEFAULT_POLL_RATE_HZ),
+              m_scheduler_stop(false),
+              m_post_running(false),
+              m_post_waiting(false),
+              m_task_post([]() {}),
+              m_accept_binary_grid(true),
+              m_capture_time_us(0),
               m_client(U(HOST)),
-              m_inflation_params({DEFAULT_INFLATION_RADIUS, DEFAULT_WEIGHT})
+              m_inflation_params({DEFAULT_INFLATION_RADIUS, DEFAULT_WEIGHT, INFLATION_STAMP}),
+              m_predict_params({PREDICT_OFF, DEFAULT_PREDICT_HORIZON_S, DEFAULT_PREDICT_DISCOUNT}),
+              m_raster_pool(new thread_pool())
 {
     m_client_config.set_nativehandle_options([](native_handle  handle) {
         // I think this code should set the socket to keep_alive, not sure though
@@ -54,17 +73,18 @@ communicator::communicator():
             socket->set_option(option);
         }
     });
-    m_client_config.set_timeout(utility::seconds(15));
+    m_client_config.set_timeout(utility::seconds(FETCH_TIMEOUT_S));
     m_client = http_client(U(HOST), m_client_config);
 
 }
 
 communicator::~communicator()
 {
-    if(m_env_data.grid_2d != NULL) {
-        delete[] m_env_data.grid_2d;
-        m_env_data.grid_2d = NULL;
-    }
+    stop_scheduler();
+    unsubscribe();
+    wait_for_post(std::chrono::seconds(FETCH_TIMEOUT_S));
+    // grid_2d is owned by m_costmap and the snapshots
+    m_env_data.grid_2d = NULL;
 }
 
 void communicator::update_data()
@@ -74,8 +94,22 @@ void communicator::update_data()
     }
 
     m_updated = false;
+    {
+        std::lock_guard<std::mutex> lock(m_update_mutex);
+        m_update_running = true;
+    }
 
-    m_task_update = get_grid();
+    m_task_update = get_grid().then([this]() {
+        std::lock_guard<std::mutex> lock(m_update_mutex);
+        m_update_running = false;
+        if(m_updated) {
+            m_update_count++;
+        }
+        m_update_cv.notify_all();
+        if(m_update_listener) {
+            m_update_listener();
+        }
+    });
 }
 
 bool communicator::is_updated()
@@ -85,13 +119,37 @@ bool communicator::is_updated()
 
 bool communicator::update_in_progress()
 {
-    return !m_task_update.is_done();
+    std::lock_guard<std::mutex> lock(m_update_mutex);
+    return m_update_running;
+}
+
+bool communicator::wait_for_update(std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(m_update_mutex);
+    m_update_cv.wait_for(lock, timeout, [this]() {
+        return !m_update_running;
+    });
+    return m_updated;
+}
+
+/*
+ * The listener runs with the update lock held, so once this returns the old
+ * listener is not running and will not be called again.
+ */
+void communicator::set_update_listener(std::function<void()> listener)
+{
+    std::lock_guard<std::mutex> lock(m_update_mutex);
+    m_update_listener = listener;
+}
+
+bool communicator::is_grid_changed()
+{
+    return grid_had_changed;
 }
 
-env_data_t communicator::get_env_data()
+env_snapshot_ptr communicator::get_env_snapshot()
 {
-    std::lock_guard<std::mutex> lock(m_env_data_mutex);
-    return m_env_data;
+    return m_env_snapshot.load();
 }
 
 env_constants_t communicator::get_const_data()
@@ -99,300 +157,694 @@ env_constants_t communicator::get_const_data()
     return m_env_const;
 }
 
-std::unique_lock<std::mutex> communicator::get_lock_env_grid_2d()
+/*
+ * The cells of every grid since the last call are merged, so none are lost
+ * when the planner skips grids.
+ */
+cell_update_list communicator::get_updated_points()
 {
-    return std::unique_lock<std::mutex>(m_env_data_mutex);
+    cell_update_list cells;
+    take_update(cells);
+    return cells;
 }
 
-point_char_map communicator::get_updated_points()
+/*
+ * The snapshot and the cells are published under the same lock, so the cells
+ * are always the changes since the previous take, up to this snapshot.
+ */
+env_snapshot_ptr communicator::take_update(cell_update_list& cells)
 {
     std::lock_guard<std::mutex> lock(m_moving_obstacles_pts_mutex);
-    return m_moving_obstacles_pts;
+    cells.clear();
+    cells.swap(m_moving_obstacles_pts);
+    m_pending_updates = 0;
+    m_pending_index.clear();
+    return m_env_snapshot.load();
 }
 
-pplx::task<void> communicator::get_grid()
+/*
+ * The first grid after a take is appended as it is. Once a second one comes
+ * before the take, the list is indexed by cell and later costs overwrite
+ * earlier ones, so it stays one entry per cell however far the planner is
+ * behind.
+ */
+void communicator::merge_points(const cell_update_list& cells)
 {
-    return m_client.request(methods::GET, U("/api/grid")).then([](http_response resp) {
-        std::cout << "Got response from server" << std::endl;
-        if(resp.status_code() != 200) {
-            throw http_exception(U("Bad request to /api/grid"));
+    if(m_pending_updates <= 1) {
+        m_moving_obstacles_pts.insert(m_moving_obstacles_pts.end(), cells.begin(), cells.end());
+        return;
+    }
+    size_t width = m_costmap.width();
+    if(m_pending_index.empty()) {
+        for(size_t i = 0; i < m_moving_obstacles_pts.size(); i++) {
+            const cell_update_t& cell = m_moving_obstacles_pts[i];
+            m_pending_index[(size_t)cell.y * width + cell.x] = i;
         }
-        return resp.extract_json();
-    }).then([this](web::json::value grid_json) {
-        auto obstacles_json = grid_json.at(U("obstacles"));
-        auto location_json = grid_json.at(U("location"));
-        auto goal_json = grid_json.at(U("goal"));
-
-        // Uncomment to print out the json object we recieved
-        //std::cout << grid_json.serialize() << std::endl;
-
-        //First check, has it changed
-        //If is_changed is set to true, we need to update height, width,
-        //and goal, and stationary obstacles.
-        bool has_changed = true;
-        if(grid_json.at(U("is_changed")).is_boolean()) {
-            has_changed = grid_json.at(U("is_changed")).as_bool();
+    }
+    for(const cell_update_t& cell : cells) {
+        auto found = m_pending_index.insert(std::make_pair((size_t)cell.y * width + cell.x,
+                                            m_moving_obstacles_pts.size()));
+        if(found.second) {
+            m_moving_obstacles_pts.push_back(cell);
         } else {
-            throw web::json::json_exception(U("value is_changed is messed up"));
+            m_moving_obstacles_pts[found.first->second].cost = cell.cost;
         }
+    }
+}
 
-        //If m_update_next_time is true, then we need to update everything,
-        //as if has_changed is true
-        has_changed = has_changed || (m_update_next_time);
-
-        // All the variables gotten from the json
-        int height = 0;
-        int width = 0;
-        std::vector<obstacle_t> obstacles;
-        int goal_x = 0;
-        int goal_y = 0;
-        int goal_theta = 0;
-        int location_x = 0;
-        int location_y = 0;
-        int location_theta = 0;
-
-        //Temporary inflation params (so we only lock it once)
-        inflation_params_t tmp_inf_params;
-        {
-            std::lock_guard<std::mutex> lock(m_inflation_params_mutex);
-            tmp_inf_params = m_inflation_params;
+bool communicator::start_scheduler()
+{
+    std::lock_guard<std::mutex> lock(m_scheduler_mutex);
+    if(m_poll_rate_hz <= 0) {
+        return false;
+    }
+    if(!m_scheduler_thread.joinable()) {
+        m_scheduler_stop = false;
+        m_scheduler_thread = std::thread(&communicator::scheduler_main, this);
+    }
+    return true;
+}
+
+void communicator::stop_scheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_scheduler_mutex);
+        if(!m_scheduler_thread.joinable()) {
+            return;
         }
+        m_scheduler_stop = true;
+    }
+    m_scheduler_cv.notify_all();
+    m_scheduler_thread.join();
+    wait_for_update(std::chrono::seconds(FETCH_TIMEOUT_S));
+}
 
-        // Probaby don't need to lock m_moving_obstacles_pts_mutex because there
-        // shouldn't be any writers while we are reading, because this thread is the writer.
-        point_char_map cp_moving_obstacles_pts(m_moving_obstacles_pts);
+bool communicator::is_scheduled()
+{
+    std::lock_guard<std::mutex> lock(m_scheduler_mutex);
+    return m_scheduler_thread.joinable();
+}
 
-        // location - Update every time
-        // TODO: Check that the location is within the grid
+update_counters_t communicator::get_update_counters()
+{
+    std::lock_guard<std::mutex> lock(m_moving_obstacles_pts_mutex);
+    return m_update_counters;
+}
 
-        if (location_json.at(U("x")).is_number()) {
-            location_x = location_json.at(U("x")).as_integer();
+/*
+ * Starts a fetch every period, on a fixed schedule that does not drift with the
+ * fetch time. A fetch still running when the next one is due is not queued
+ * behind it, the poll is dropped: the grid it would get is at most one period
+ * newer than the one on its way.
+ */
+void communicator::scheduler_main()
+{
+    const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                            std::chrono::duration<double>(1.0 / m_poll_rate_hz));
+    auto next_poll = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(m_scheduler_mutex);
+    while(!m_scheduler_stop) {
+        lock.unlock();
+        if(update_in_progress()) {
+            std::lock_guard<std::mutex> counters_lock(m_moving_obstacles_pts_mutex);
+            m_update_counters.dropped++;
+            metrics().polls_dropped.fetch_add(1, std::memory_order_relaxed);
         } else {
-            throw web::json::json_exception(U("value x not found in location"));
+            update_data();
         }
-        if (location_json.at(U("y")).is_number()) {
-            location_y = location_json.at(U("y")).as_integer();
-        } else {
-            throw web::json::json_exception(U("value y not found in location"));
+        lock.lock();
+
+        next_poll += period;
+        auto now = std::chrono::steady_clock::now();
+        if(next_poll < now) {
+            //Fell a whole period behind, the missed polls are gone
+            next_poll = now;
         }
-        if (location_json.at(U("theta")).is_number()) {
-            location_theta = location_json.at(U("theta")).as_integer();
-        } else {
-            throw web::json::json_exception(U("value theta not found in location"));
+        m_scheduler_cv.wait_until(lock, next_poll, [this]() {
+            return m_scheduler_stop;
+        });
+    }
+}
+
+void communicator::subscribe(subscribe_mode_t mode)
+{
+    std::lock_guard<std::mutex> lock(m_subscribe_mutex);
+    if(m_subscribed) {
+        return;
+    }
+    m_subscribed = true;
+    if(mode == SUBSCRIBE_WEBSOCKET && start_stream()) {
+        return;
+    }
+    start_long_poll();
+}
+
+/*
+ * The stream is closed outside the lock, its close handler takes it
+ */
+void communicator::unsubscribe()
+{
+    std::unique_ptr<websocket_callback_client> stream;
+    std::thread poll_thread;
+    {
+        std::lock_guard<std::mutex> lock(m_subscribe_mutex);
+        if(!m_subscribed) {
+            return;
         }
+        m_subscribed = false;
+        m_long_polling = false;
+        stream.swap(m_stream);
+        poll_thread.swap(m_poll_thread);
+        m_poll_cancel.cancel();
+    }
+    if(stream != NULL) {
+        try {
+            stream->close().wait();
+        } catch(const std::exception& ex) {
+            std::cout << "Caught Exception: " << ex.what() << std::endl;
+        }
+    }
+    if(poll_thread.joinable()) {
+        poll_thread.join();
+    }
+}
 
+bool communicator::is_subscribed()
+{
+    std::lock_guard<std::mutex> lock(m_subscribe_mutex);
+    return m_subscribed;
+}
 
+bool communicator::is_long_polling()
+{
+    std::lock_guard<std::mutex> lock(m_subscribe_mutex);
+    return m_long_polling;
+}
 
-        if(has_changed) {
-            // Grid Size
-            if (grid_json.at(U("grid_width")).is_number()) {
-                width = grid_json.at(U("grid_width")).as_integer();
-            } else {
-                throw web::json::json_exception(U("value grid_width is messed up"));
-            }
-            if (grid_json.at(U("grid_height")).is_number()) {
-                height = grid_json.at(U("grid_height")).as_integer();
-            } else {
-                throw web::json::json_exception(U("value grid_height is messed up"));
-            }
+unsigned long communicator::update_count()
+{
+    std::lock_guard<std::mutex> lock(m_update_mutex);
+    return m_update_count;
+}
 
-            // Stationary Obstacles - Only update when has_changed is true
-            // TODO: Add check that obstacles are within the grid, at least partially
-
-            if (obstacles_json.at(U("stationary_obstacles")).is_array()) {
-                std::for_each(obstacles_json.at(U("stationary_obstacles")).as_array().begin(),
-                              obstacles_json.at(U("stationary_obstacles")).as_array().end(),
-                [&obstacles](web::json::value & obstacle_json) {
-                    int x = obstacle_json.at(U("x")).as_integer();
-                    int y = obstacle_json.at(U("y")).as_integer();
-                    int rad = obstacle_json.at(U("radius")).as_integer();
-                    // Moving obstacle with heading and velocity 0
-                    obstacles.push_back({x, y, rad, 0, 0});
-                });
-            } else {
-                throw web::json::json_exception(U("value stationary_obstacles not found in grid"));
+bool communicator::wait_for_update_count(unsigned long count, std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(m_update_mutex);
+    return m_update_cv.wait_for(lock, timeout, [this, count]() {
+        return m_update_count > count;
+    });
+}
+
+/*
+ * Connects to the grid stream. Every message is a whole /api/grid body, binary
+ * messages in the grid wire format and text messages json. The server only
+ * sets is_changed when the size, goal or stationary obstacles change, the
+ * moving obstacles are diffed into changed cells here as they are for a GET.
+ * If the stream closes while subscribed we carry on by long poll.
+ */
+bool communicator::start_stream()
+{
+    utility::string_t stream_uri = m_stream_uri;
+    if(stream_uri.empty()) {
+        web::uri_builder builder((web::uri(U(HOST))));
+        builder.set_scheme(builder.scheme() == U("https") ? U("wss") : U("ws"));
+        builder.set_path(U(GRID_STREAM_PATH));
+        stream_uri = builder.to_string();
+    }
+
+    std::unique_ptr<websocket_callback_client> stream(new websocket_callback_client());
+    stream->set_message_handler([this](const websocket_incoming_message& msg) {
+        try {
+            if(msg.message_type() == websocket_message_type::binary_message) {
+                std::vector<uint8_t> body(msg.length());
+                msg.body().streambuf().getn(body.data(), body.size()).wait();
+                apply_pushed(body.data(), body.size(), true);
+            } else if(msg.message_type() == websocket_message_type::text_message) {
+                std::string body = msg.extract_string().get();
+                apply_pushed((const uint8_t*)body.data(), body.size(), false);
             }
+        } catch(const std::exception& ex) {
+            std::cout << "Caught Exception: " << ex.what() << std::endl;
+        }
+    });
+    stream->set_close_handler([this](websocket_close_status status, const utility::string_t& reason,
+                                     const std::error_code& error) {
+        std::lock_guard<std::mutex> lock(m_subscribe_mutex);
+        if(m_subscribed && m_stream != NULL) {
+            std::cout << "Grid stream closed, long polling /api/grid instead" << std::endl;
+            start_long_poll();
+        }
+    });
 
-            //goal
-            // TODO: Check that the goal is within the grid
+    try {
+        stream->connect(stream_uri).wait();
+    } catch(const std::exception& ex) {
+        std::cout << "Cannot connect to " << utility::conversions::to_utf8string(stream_uri) << ": " << ex.what()
+                  << ", long polling /api/grid instead" << std::endl;
+        return false;
+    }
+    m_stream.swap(stream);
+    return true;
+}
 
-            if (goal_json.at(U("x")).is_number()) {
-                goal_x = goal_json.at(U("x")).as_integer();
-            } else {
-                throw web::json::json_exception(U("value x not found in goal"));
+void communicator::start_long_poll()
+{
+    if(m_long_polling) {
+        return;
+    }
+    m_long_polling = true;
+    m_poll_cancel = pplx::cancellation_token_source();
+    if(m_poll_thread.joinable()) {
+        //Left over from an earlier subscription, it has stopped
+        m_poll_thread.join();
+    }
+    m_poll_thread = std::thread(&communicator::long_poll_main, this, m_poll_cancel.get_token());
+}
+
+/*
+ * Asks for /api/grid with the ETag of the last grid we got. The server holds
+ * the request until it has a newer grid, or answers 304 Not Modified when it
+ * gives up, and we ask again right away. Runs until the token is cancelled.
+ */
+void communicator::long_poll_main(pplx::cancellation_token token)
+{
+    http_client_config config;
+    config.set_timeout(utility::seconds(LONG_POLL_TIMEOUT_S));
+    http_client poll_client(U(HOST), config);
+    m_poll_etag.clear();
+
+    while(!token.is_canceled()) {
+        http_request request(methods::GET);
+        request.set_request_uri(U("/api/grid"));
+        if(m_accept_binary_grid) {
+            request.headers().add(header_names::accept, U(GRID_WIRE_CONTENT_TYPE ", application/json;q=0.5"));
+        }
+        if(!m_poll_etag.empty()) {
+            request.headers().add(header_names::if_none_match, m_poll_etag);
+        }
+
+        try {
+            http_response resp = poll_client.request(request, token).get();
+            if(resp.status_code() == status_codes::NotModified) {
+                continue;
             }
-            if (goal_json.at(U("y")).is_number()) {
-                goal_y = goal_json.at(U("y")).as_integer();
-            } else {
-                throw web::json::json_exception(U("value y not found in goal"));
+            if(resp.status_code() != status_codes::OK) {
+                throw http_exception(U("Bad request to /api/grid"));
             }
-            if (goal_json.at(U("theta")).is_number()) {
-                goal_theta = goal_json.at(U("theta")).as_integer();
-            } else {
-                throw web::json::json_exception(U("value theta not found in goal"));
+            if(resp.headers().has(header_names::etag)) {
+                m_poll_etag = resp.headers()[header_names::etag];
             }
-
-            cp_moving_obstacles_pts.clear();
-        }//if(has_changed)
-        else {
-            // if has_changed is false, we need to remove all the 0s from the copy of moving_obstacles_pts
-            for(auto it = cp_moving_obstacles_pts.begin(); it != cp_moving_obstacles_pts.end(); ) {
-                if(it->second == m_env_data.grid_2d[it->first.first + it->first.second * m_env_data.width]) {
-                    it = cp_moving_obstacles_pts.erase(it);
-                } else {
-                    it->second = m_env_data.grid_2d[it->first.first + it->first.second * m_env_data.width];
-                    ++it;
-                }
+            bool binary = is_grid_wire_content_type(utility::conversions::to_utf8string(resp.headers().content_type()));
+            std::vector<unsigned char> body = resp.extract_vector().get();
+            apply_pushed(body.data(), body.size(), binary);
+        } catch(const std::exception& ex) {
+            if(token.is_canceled()) {
+                break;
             }
+            std::cout << "Caught Exception: " << ex.what() << std::endl;
+            std::this_thread::sleep_for(std::chrono::milliseconds(LONG_POLL_RETRY_MS));
         }
+    }
+}
 
-        // Moving Obstacles - Update every time
-        // TODO: Add check that obstacles are within the grid, at least partially
-        point_char_map temp_moving_obs;
-
-        if (obstacles_json.at(U("moving_obstacles")).is_array()) {
-            std::for_each(obstacles_json.at(U("moving_obstacles")).as_array().begin(),
-                          obstacles_json.at(U("moving_obstacles")).as_array().end(),
-            [this, tmp_inf_params, &temp_moving_obs, width, height](web::json::value & obstacle_json) {
-                int x = obstacle_json.at(U("x")).as_integer();
-                int y = obstacle_json.at(U("y")).as_integer();
-                int rad = obstacle_json.at(U("radius")).as_integer();
-                int head = obstacle_json.at(U("heading")).as_integer();
-                int vel = obstacle_json.at(U("velocity")).as_integer();
-                obstacle_t obs({x, y, rad, head, vel});
-                for(int x = obs.x - obs.radius - tmp_inf_params.radius; x <= obs.x; x++) {
-                    for(int y = obs.y - obs.radius - tmp_inf_params.radius; y <= obs.y; y++) {
-                        unsigned char cost = calculate_cost(obs, x, y, tmp_inf_params);
-
-                        int sym_x = 2 * obs.x - x;
-                        int sym_y = 2 * obs.y - y;
-                        if(x >= 0 && x < width) {
-                            if(y >= 0 && y < height) {
-                                std::pair<int, int> pt(x, y);
-                                if(temp_moving_obs[pt] < cost) {
-                                    temp_moving_obs[pt] = cost;
-                                }
-                            }
-                            if(sym_y >= 0 && sym_y < height) {
-                                std::pair<int, int> pt(x, sym_y);
-                                if(temp_moving_obs[pt] < cost) {
-                                    temp_moving_obs[pt] = cost;
-                                }
-                            }
-                        }
-                        if(sym_x >= 0 && sym_x < width) {
-                            if(y >= 0 && y < height) {
-                                std::pair<int, int> pt(sym_x, y);
-                                if(temp_moving_obs[pt] < cost) {
-                                    temp_moving_obs[pt] = cost;
-                                }
-                            }
-                            if(sym_y >= 0 && sym_y < height) {
-                                std::pair<int, int> pt(sym_x, sym_y);
-                                if(temp_moving_obs[pt] < cost) {
-                                    temp_moving_obs[pt] = cost;
-                                }
-                            }
-                        }
-                    }
-                }
-            });
-        } else {
-            throw web::json::json_exception(U("value moving_obstacles not found in grid"));
-        }
+/*
+ * Pushed grids come one at a time, from the stream's message handler or the
+ * long poll thread, never both, so the update state needs no more locking
+ * than it does for update_data().
+ */
+void communicator::apply_pushed(const uint8_t* body, size_t size, bool binary)
+{
+    if(m_capture.is_open()) {
+        m_capture.write(grid_capture_now_us(), binary ? GRID_CAPTURE_WIRE : GRID_CAPTURE_JSON, body, size);
+    }
+    if(!apply_grid_body(body, size, binary)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_update_mutex);
+    m_update_count++;
+    m_update_cv.notify_all();
+    if(m_update_listener) {
+        m_update_listener();
+    }
+}
 
-        temp_moving_obs.insert(cp_moving_obstacles_pts.begin(), cp_moving_obstacles_pts.end());
+pplx::task<void> communicator::get_grid()
+{
+    http_request request(methods::GET);
+    request.set_request_uri(U("/api/grid"));
+    if(m_accept_binary_grid) {
+        //The server picks the encoding, json is still fine
+        request.headers().add(header_names::accept, U(GRID_WIRE_CONTENT_TYPE ", application/json;q=0.5"));
+    }
 
-        {
-            //Scope for lock_guard
-            //lock, then set m_moving_obstacles_pts
-            std::lock_guard<std::mutex> lock(m_moving_obstacles_pts_mutex);
-            swap(m_moving_obstacles_pts, temp_moving_obs);
+    m_stage_start = std::chrono::steady_clock::now();
+    return m_client.request(request).then([this](http_response resp) {
+        std::cout << "Got response from server" << std::endl;
+        auto headers_in = std::chrono::steady_clock::now();
+        metrics().stages[METRIC_FETCH].record(headers_in - m_stage_start);
+        m_stage_start = headers_in;
+        if(resp.status_code() != 200) {
+            throw http_exception(U("Bad request to /api/grid"));
         }
+        m_capture_time_us = grid_capture_now_us();
 
-        std::lock_guard<std::mutex> lock(m_env_data_mutex);
-        //Lock before editing the env data.
-
-        //Always update location
-        //location
-        m_env_data.start_x = location_x;
-        m_env_data.start_y = location_y;
-        m_env_data.start_theta = location_theta;
-
-        if(has_changed) {
-            //height and width
-            m_env_data.height = height;
-            m_env_data.width = width;
-
-            //goal
-            m_env_data.end_x = goal_x;
-            m_env_data.end_y = goal_y;
-            m_env_data.end_theta = goal_theta;
-
-            //free memory if not null
-            if(m_env_data.grid_2d != NULL) {
-                delete[] m_env_data.grid_2d;
-                m_env_data.grid_2d = NULL;
-            }
-
-            //make a new grid_2d array
-            //only when has_changed is true
-            m_env_data.grid_2d = new unsigned char[(m_env_data.height) * (m_env_data.width)];
-            // Make sure we zero the array
-            memset(m_env_data.grid_2d, 0, m_env_data.height * m_env_data.width * sizeof(unsigned char));
-
-            //Obstacles to grid
-            std::for_each(obstacles.begin(), obstacles.end(),
-            [this, tmp_inf_params, height, width](obstacle_t obs) {
-                //Look through all the points in one quadrant of the circlep
-                for(int x = obs.x - obs.radius - tmp_inf_params.radius; x <= obs.x; x++) {
-                    for(int y = obs.y - obs.radius - tmp_inf_params.radius; y <= obs.y; y++) {
-                        unsigned char cost = calculate_cost(obs, x, y, tmp_inf_params);
-
-                        int sym_x = BOUND_VALUE(2 * obs.x - x, 0, width - 1);
-                        int sym_y = BOUND_VALUE(2 * obs.y - y, 0, height - 1);
-                        int pt_x = BOUND_VALUE(x, 0, width - 1);
-                        int pt_y = BOUND_VALUE(y, 0, height - 1);
-
-                        m_env_data.grid_2d[pt_x  + pt_y  * width] = std::max(cost, m_env_data.grid_2d[pt_x  + pt_y  * width]);
-                        m_env_data.grid_2d[pt_x  + sym_y * width] = std::max(cost, m_env_data.grid_2d[pt_x  + sym_y * width]);
-                        m_env_data.grid_2d[sym_x + pt_y  * width] = std::max(cost, m_env_data.grid_2d[sym_x + pt_y  * width]);
-                        m_env_data.grid_2d[sym_x + sym_y * width] = std::max(cost, m_env_data.grid_2d[sym_x + sym_y * width]);
-                    }
+        if(is_grid_wire_content_type(utility::conversions::to_utf8string(resp.headers().content_type()))) {
+            //Binary grid, the obstacles are used in place in m_wire_buffer
+            return resp.extract_vector().then([this](std::vector<unsigned char> body) {
+                if(m_capture.is_open()) {
+                    m_capture.write(m_capture_time_us, GRID_CAPTURE_WIRE, body.data(), body.size());
                 }
+                m_wire_buffer.swap(body);
+                grid_view_t view = decode_grid_wire(m_wire_buffer.data(), m_wire_buffer.size(), m_wire_scratch);
+                metrics().stages[METRIC_PARSE].record(std::chrono::steady_clock::now() - m_stage_start);
+                apply_grid_update(view);
             });
-        } //if(has_changed)
-
-        m_updated = true;
-        m_update_next_time = false; //We completed a full update this time, so we don't need a full update next time.
+        }
 
-    }).then([](pplx::task<void> task) {
+        //Json, parse the body as it arrives, straight into m_grid_update
+        m_grid_parser.reset(&m_grid_update);
+        m_capture_body.clear();
+        std::shared_ptr<std::vector<uint8_t> > chunk(new std::vector<uint8_t>(GRID_CHUNK_SIZE));
+        return read_grid_body(resp.body().streambuf(), chunk).then([this]() {
+            if(m_capture.is_open()) {
+                m_capture.write(m_capture_time_us, GRID_CAPTURE_JSON, m_capture_body.data(), m_capture_body.size());
+            }
+            m_grid_parser.finish();
+            metrics().stages[METRIC_PARSE].record(std::chrono::steady_clock::now() - m_stage_start);
+            apply_grid_update(m_grid_update.view());
+        });
+    }).then([this](pplx::task<void> task) {
         //This step is just to catch exceptions
         try {
             task.get();
         } catch(const std::exception& ex) {
             // TODO: Do something about exceptions here
             std::cout << "Caught Exception: " << ex.what() << std::endl;
+            //The stationary tracker may be ahead of the static layer, start over
+            m_update_next_time = true;
         }
     });
 }
 
-unsigned char communicator::calculate_cost(obstacle_t obs, int x, int y, inflation_params_t inf_param)
+/*
+ * The path is written into m_post_next right away, over a path still waiting,
+ * so only the newest one is ever sent once the post in flight is done.
+ */
+void communicator::post_results(const std::vector<sbpl_xy_theta_pt_t>& path)
+{
+    std::lock_guard<std::mutex> lock(m_post_mutex);
+    if(m_post_waiting) {
+        metrics().posts_coalesced.fetch_add(1, std::memory_order_relaxed);
+    }
+    write_path_json(path, m_post_next);
+    m_post_waiting = true;
+    m_posted = false;
+    if(!m_post_running) {
+        start_post();
+    }
+}
+
+bool communicator::is_posted()
+{
+    return m_posted;
+}
+
+bool communicator::post_in_progress()
+{
+    std::lock_guard<std::mutex> lock(m_post_mutex);
+    return m_post_running;
+}
+
+bool communicator::wait_for_post(std::chrono::milliseconds timeout)
 {
-    int diff_x = x - obs.x; //Difference of the point from the orgin of obstacle
-    int diff_y = y - obs.y;
-    int dist_squared = (diff_x * diff_x) + (diff_y * diff_y);
-    if(dist_squared <= obs.radius * obs.radius) {
-        //point is within circle
-        return OBSTACLE_THRES;
-    } else if (dist_squared >  (obs.radius + inf_param.radius) * (obs.radius + inf_param.radius)) {
-        return 0;
+    std::unique_lock<std::mutex> lock(m_post_mutex);
+    m_post_cv.wait_for(lock, timeout, [this]() {
+        return !m_post_running;
+    });
+    return m_posted;
+}
+
+/*
+ * Goes out on m_client, so it shares its kept alive connections with the
+ * fetches. The time from the request to the response is the post stage.
+ */
+void communicator::start_post()
+{
+    m_post_running = true;
+    m_post_waiting = false;
+    http_request request(methods::POST);
+    request.set_request_uri(U("/api/path"));
+    request.set_body(std::move(m_post_next), PATH_JSON_CONTENT_TYPE);
+    m_post_next.clear();
+
+    auto start = std::chrono::steady_clock::now();
+    m_task_post = m_client.request(request).then([start](http_response resp) {
+        metrics().stages[METRIC_POST].record(std::chrono::steady_clock::now() - start);
+        if(resp.status_code() != status_codes::OK && resp.status_code() != status_codes::Created &&
+                resp.status_code() != status_codes::NoContent) {
+            throw http_exception(U("Bad request to /api/path"));
+        }
+    }).then([this](pplx::task<void> task) {
+        bool posted = true;
+        try {
+            task.get();
+        } catch(const std::exception& ex) {
+            std::cout << "Caught Exception: " << ex.what() << std::endl;
+            posted = false;
+        }
+        std::lock_guard<std::mutex> lock(m_post_mutex);
+        if(m_post_waiting) {
+            //A newer path came in meanwhile
+            start_post();
+            return;
+        }
+        m_posted = posted;
+        m_post_running = false;
+        m_post_cv.notify_all();
+    });
+}
+
+/*
+ * Reads the response body one chunk at a time, feeding m_grid_parser.
+ * The task completes once the body has been read to the end.
+ */
+pplx::task<void> communicator::read_grid_body(concurrency::streams::streambuf<uint8_t> body,
+        std::shared_ptr<std::vector<uint8_t> > chunk)
+{
+    return body.getn(chunk->data(), chunk->size()).then([this, body, chunk](size_t read) {
+        if(read == 0) {
+            return pplx::task_from_result();
+        }
+        if(m_capture.is_open()) {
+            m_capture_body.insert(m_capture_body.end(), chunk->data(), chunk->data() + read);
+        }
+        m_grid_parser.feed((const char*)chunk->data(), read);
+        return read_grid_body(body, chunk);
+    });
+}
+
+/*
+ * Opens the capture file. Responses are written as they came, before they are
+ * parsed, so bodies that fail to parse can be replayed too.
+ */
+bool communicator::set_capture_file(const std::string &filename)
+{
+    m_capture.close();
+    if(filename.empty()) {
+        return true;
+    }
+    return m_capture.open(filename);
+}
+
+/*
+ * Same stages as get_grid(), minus the network
+ */
+bool communicator::apply_grid_body(const uint8_t* body, size_t size, bool binary, grid_stage_times_t* times)
+{
+    try {
+        auto start = std::chrono::steady_clock::now();
+        grid_view_t view;
+        if(binary) {
+            view = decode_grid_wire(body, size, m_wire_scratch);
+        } else {
+            m_grid_parser.reset(&m_grid_update);
+            m_grid_parser.feed((const char*)body, size);
+            m_grid_parser.finish();
+            view = m_grid_update.view();
+        }
+        auto parsed = std::chrono::steady_clock::now();
+        metrics().stages[METRIC_PARSE].record(parsed - start);
+        apply_grid_update(view);
+        if(times != NULL) {
+            times->parse_ms = std::chrono::duration<double, std::milli>(parsed - start).count();
+            times->raster_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - parsed).count();
+        }
+    } catch(const std::exception& ex) {
+        std::cout << "Caught Exception: " << ex.what() << std::endl;
+        m_update_next_time = true;
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Applies a parsed grid response to m_env_data and the cost map.
+ * Throws grid_parse_exception if a field we need is missing.
+ */
+void communicator::apply_grid_update(const grid_view_t& update)
+{
+    //If is_changed is set to true, we need to update height, width,
+    //and goal, and stationary obstacles.
+    //If m_update_next_time is true, then we need to update everything,
+    //as if has_changed is true
+    bool has_changed = update.is_changed || (m_update_next_time);
+
+    // TODO: Check that the location and goal are within the grid
+    // TODO: Add check that obstacles are within the grid, at least partially
+    check_grid_update(update, has_changed);
+    //No obstacle is inflated further than across the grid
+    int max_radius = has_changed ? std::max(update.width, update.height) :
+                     std::max(m_costmap.width(), m_costmap.height());
+    if(has_changed) {
+        check_obstacle_radii(update.stationary_obstacles, max_radius);
+    }
+    check_obstacle_radii(update.moving_obstacles, max_radius);
+
+    auto raster_start = std::chrono::steady_clock::now();
+
+    //Temporary inflation params (so we only lock it once)
+    inflation_params_t tmp_inf_params;
+    predict_params_t tmp_predict_params;
+    {
+        std::lock_guard<std::mutex> lock(m_inflation_params_mutex);
+        tmp_inf_params = m_inflation_params;
+        tmp_predict_params = m_predict_params;
+    }
+
+    //m_env_data is only used on the update task, readers get the snapshot published below
+
+    //Always update location
+    //location
+    m_env_data.start_x = update.location_x;
+    m_env_data.start_y = update.location_y;
+    m_env_data.start_theta = update.location_theta;
+
+    bool rebuilt = false;
+    bool static_changed = false;
+    if(has_changed) {
+        int width = update.width;
+        int height = update.height;
+
+        //A new static layer only when the map size or the inflation changed, or the
+        //last update failed. Otherwise only the stationary obstacles that changed
+        //are stamped again and the planner gets the cells as changed cells.
+        bool full = m_update_next_time || width != m_costmap.width() || height != m_costmap.height() ||
+                    tmp_inf_params.radius != m_static_inf_params.radius ||
+                    tmp_inf_params.weight != m_static_inf_params.weight;
+
+        //height and width
+        m_env_data.height = height;
+        m_env_data.width = width;
+
+        //goal
+        m_env_data.end_x = update.goal_x;
+        m_env_data.end_y = update.goal_y;
+        m_env_data.end_theta = update.goal_theta;
+
+        if(full) {
+            if(tmp_inf_params.radius != m_static_inf_params.radius ||
+                    tmp_inf_params.weight != m_static_inf_params.weight) {
+                //The stamps of the old inflation are never asked for again
+                m_stamp_cache.clear();
+            }
+            //New static layer. The old one stays valid for whoever still holds a
+            //snapshot of it. It starts with every tile shared and zero, only tiles
+            //under an obstacle get memory.
+            m_costmap.reset(width, height);
+            tiled_grid& grid_2d = m_costmap.static_layer();
+
+            //Stationary obstacles to grid
+            if(tmp_inf_params.mode == INFLATION_DISTANCE_TRANSFORM) {
+                //The transform works on a whole row major grid, the empty tiles are dropped after
+                std::shared_ptr<grid_buffer_t> scratch = m_grid_pool.acquire((size_t)width * height);
+                inflate_distance_transform(scratch->data(), width, height, update.stationary_obstacles, tmp_inf_params,
+                                           *m_raster_pool);
+                grid_2d.assign(scratch->data(), width, height);
+            } else {
+                lookup_stamps(update.stationary_obstacles, m_stamp_cache, tmp_inf_params, m_stamps);
+                stamp_obstacles_tiled(grid_2d, update.stationary_obstacles, m_stamps, *m_raster_pool);
+            }
+            m_stationary.clear();
+            m_stationary.update(update.stationary_obstacles);
+            m_static_inf_params = tmp_inf_params;
+            m_grid_generation++;
+            rebuilt = true;
+        } else {
+            m_stationary.update(update.stationary_obstacles);
+            if(m_stationary.changed()) {
+                //Tiles under an added or removed obstacle are stamped again from every
+                //obstacle over them, so overlaps come out the same as a full rebuild.
+                //Stamps give the same costs as the distance transform.
+                m_stationary.dirty_tiles(width, height, m_stamp_cache, tmp_inf_params, m_dirty_tiles);
+                lookup_stamps(update.stationary_obstacles, m_stamp_cache, tmp_inf_params, m_stamps);
+                m_costmap.restamp_static(m_dirty_tiles, update.stationary_obstacles, m_stamps, *m_raster_pool);
+                static_changed = true;
+            }
+        }
+        m_env_data.grid_2d = &m_costmap.static_layer();
+    } //if(has_changed)
+
+    // The dynamic layer is private to this thread
+    m_costmap.begin_dynamic();
+    if(tmp_predict_params.mode == PREDICT_OFF) {
+        lookup_stamps(update.moving_obstacles, m_stamp_cache, tmp_inf_params, m_stamps);
+        m_costmap.stamp_dynamic_tiled(update.moving_obstacles, m_stamps, *m_raster_pool);
     } else {
-        //We need sqrt of the distance, so only compute it here.
-        double distance = std::sqrt(dist_squared);
-        double factor = exp(-1.0 * inf_param.weight * (distance - obs.radius));
-        return (unsigned char)((OBSTACLE_THRES - 1) * factor);
+        //Where the obstacles are heading, so paths around them stay clear for a while
+        m_predictor.predict(update.moving_obstacles, m_stamp_cache, tmp_inf_params, tmp_predict_params,
+                            m_predicted, m_stamps);
+        m_costmap.stamp_dynamic_tiled(m_predicted, m_stamps, *m_raster_pool);
+    }
+    auto diff_start = std::chrono::steady_clock::now();
+    metrics().stages[METRIC_RASTER].record(diff_start - raster_start);
+    m_costmap.end_dynamic();
+
+    //Publish. The static layer is never written again, changes go to a copy.
+    std::shared_ptr<env_snapshot_t> snapshot(new env_snapshot_t());
+    snapshot->data = m_env_data;
+    snapshot->grid = m_costmap.shared_static_layer();
+    snapshot->grid_generation = m_grid_generation;
+
+    {
+        //Scope for lock_guard
+        //lock, then add to m_moving_obstacles_pts and publish the snapshot they go with
+        std::lock_guard<std::mutex> lock(m_moving_obstacles_pts_mutex);
+        if(m_pending_updates > 0) {
+            //The planner has not taken the last grid yet, this one replaces it
+            m_update_counters.merged++;
+            metrics().updates_merged.fetch_add(1, std::memory_order_relaxed);
+        }
+        if(rebuilt) {
+            //Cells from before are in the new static layer or gone
+            m_moving_obstacles_pts.clear();
+            m_pending_index.clear();
+            m_pending_updates = 0;
+        }
+        m_pending_updates++;
+        if(static_changed) {
+            //First, the dynamic cells are diffed against the new static layer
+            merge_points(m_costmap.static_dirty_cells());
+        }
+        merge_points(m_costmap.dirty_cells());
+        m_update_counters.applied++;
+        metrics().updates.fetch_add(1, std::memory_order_relaxed);
+        m_env_snapshot.store(snapshot);
     }
+    metrics().stages[METRIC_DIFF].record(std::chrono::steady_clock::now() - diff_start);
+
+    grid_had_changed = rebuilt;
+    m_updated = true;
+    m_update_next_time = false; //We completed a full update this time, so we don't need a full update next time.
 }
 
 /*
@@ -454,6 +906,64 @@ int communicator::store_constant(std::string key, std::string value)
             m_env_const.timetoturn45degs = boost::lexical_cast<double>(value);
         } else if(boost::iequals(key, "cellsize_m")) {
             m_env_const.cellsize_m = boost::lexical_cast<double>(value);
+        } else if(boost::iequals(key, "inflation_mode")) {
+            inflation_mode_t mode;
+            if(boost::iequals(value, "stamp")) {
+                mode = INFLATION_STAMP;
+            } else if(boost::iequals(value, "distance_transform")) {
+                mode = INFLATION_DISTANCE_TRANSFORM;
+            } else {
+                throw std::invalid_argument("Unknown inflation_mode " + value);
+            }
+            std::lock_guard<std::mutex> lock(m_inflation_params_mutex);
+            m_inflation_params.mode = mode;
+        } else if(boost::iequals(key, "predict_mode")) {
+            predict_mode_t mode;
+            if(boost::iequals(value, "off")) {
+                mode = PREDICT_OFF;
+            } else if(boost::iequals(value, "swept")) {
+                mode = PREDICT_SWEPT;
+            } else if(boost::iequals(value, "discounted")) {
+                mode = PREDICT_DISCOUNTED;
+            } else {
+                throw std::invalid_argument("Unknown predict_mode " + value);
+            }
+            std::lock_guard<std::mutex> lock(m_inflation_params_mutex);
+            m_predict_params.mode = mode;
+        } else if(boost::iequals(key, "predict_horizon_s")) {
+            double horizon = boost::lexical_cast<double>(value);
+            if(horizon < 0) {
+                throw std::invalid_argument("predict_horizon_s must not be negative");
+            }
+            std::lock_guard<std::mutex> lock(m_inflation_params_mutex);
+            m_predict_params.horizon_s = horizon;
+        } else if(boost::iequals(key, "predict_discount")) {
+            double discount = boost::lexical_cast<double>(value);
+            if(discount < 0 || discount > 1) {
+                throw std::invalid_argument("predict_discount must be between 0 and 1");
+            }
+            std::lock_guard<std::mutex> lock(m_inflation_params_mutex);
+            m_predict_params.discount = discount;
+        } else if(boost::iequals(key, "raster_threads")) {
+            //Only read at startup, the pool must not be replaced while an update runs
+            m_raster_pool.reset(new thread_pool(boost::lexical_cast<unsigned int>(value)));
+        } else if(boost::iequals(key, "grid_encoding")) {
+            if(boost::iequals(value, "binary")) {
+                m_accept_binary_grid = true;
+            } else if(boost::iequals(value, "json")) {
+                m_accept_binary_grid = false;
+            } else {
+                throw std::invalid_argument("Unknown grid_encoding " + value);
+            }
+        } else if(boost::iequals(key, "poll_rate_hz")) {
+            double rate = boost::lexical_cast<double>(value);
+            if(rate < 0) {
+                throw std::invalid_argument("poll_rate_hz must not be negative");
+            }
+            std::lock_guard<std::mutex> lock(m_scheduler_mutex);
+            m_poll_rate_hz = rate;
+        } else if(boost::iequals(key, "stream_uri")) {
+            m_stream_uri = utility::conversions::to_string_t(value);
         } else if(boost::iequals(key, "motion_prim_file")) {
             if (FILE *file = fopen(value.c_str(), "r")) {
                 //File exists
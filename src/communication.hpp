@@ -20,13 +20,30 @@
 #ifndef COMMUNICATION_H
 #define COMMUNICATION_H
 #include "hasher.hpp"
+#include "costmap.hpp"
+#include "env_snapshot.hpp"
+#include "grid_capture.hpp"
+#include "grid_parser.hpp"
+#include "grid_wire.hpp"
+#include "metrics.hpp"
+#include "motion_predict.hpp"
+#include "path_json.hpp"
+#include "stationary_tracker.hpp"
+#include "inflation.hpp"
+#include "thread_pool.hpp"
+#include "tile_raster.hpp"
 
 #include <cpprest/http_client.h>
+#include <cpprest/ws_client.h>
 
 #include <boost/asio.hpp>
 
 #include <mutex>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 
@@ -35,27 +52,26 @@
 #define HOST "http://private-6dd53-jamapi.apiary-mock.com/"
 #endif
 
-// The threshold for obstacles in the cost map. 0-255
-#define OBSTACLE_THRES 255
-
 // The number of map units to inflate the radius of obstacles
 #define DEFAULT_INFLATION_RADIUS 6
 // The default for the inflation weight value (should be a double)
 #define DEFAULT_WEIGHT 0.6
+// Defaults of predict_horizon_s and predict_discount, prediction itself is off by default
+#define DEFAULT_PREDICT_HORIZON_S 2.0
+#define DEFAULT_PREDICT_DISCOUNT 0.5
 
-using namespace web::http::client;
+// Bytes read from the /api/grid response body at a time
+#define GRID_CHUNK_SIZE 16384
 
-struct env_data_t {
-    int height; //y
-    int width; //x
-    int start_x; //meters
-    int start_y; //meters
-    int start_theta; //degrees
-    int end_x; //meters
-    int end_y; //meters
-    int end_theta; //degrees
-    unsigned char* grid_2d;
-};
+// How long a GET of /api/grid may take
+#define FETCH_TIMEOUT_S 15
+// Grids fetched per second by the scheduler (poll_rate_hz in the config), 0 leaves fetching to update_data()
+#define DEFAULT_POLL_RATE_HZ 0.0
+// How long the server may hold a long poll, and the wait before polling again after an error
+#define LONG_POLL_TIMEOUT_S 60
+#define LONG_POLL_RETRY_MS 1000
+
+using namespace web::http::client;
 
 struct env_constants_t {
     unsigned char obs_thresh; //Value (0-255) at which we are in an obstacle in the grid
@@ -67,12 +83,26 @@ struct env_constants_t {
     const char* motion_prim_file; // Null terminated string for the motion primatives file
 };
 
-struct inflation_params_t {
-    int radius;
-    double weight;
+typedef std::unordered_map<std::pair<int, int>, unsigned char> point_char_map;
+
+// How subscribe() gets the grids
+enum subscribe_mode_t {
+    SUBSCRIBE_WEBSOCKET, //Server pushes every grid on GRID_STREAM_PATH, long polls if it cannot connect
+    SUBSCRIBE_LONG_POLL //GET /api/grid with If-None-Match, the server answers once it has a newer grid
 };
 
-typedef std::unordered_map<std::pair<int, int>, unsigned char> point_char_map;
+// How the updates went, totals since the start
+struct update_counters_t {
+    unsigned long applied; //Grids applied to the cost map
+    unsigned long merged; //Applied before the last one was taken, their changed cells merged into one list
+    unsigned long dropped; //Scheduled polls skipped because the fetch before was still running
+};
+
+// Time apply_grid_body() spent in each stage, in milliseconds
+struct grid_stage_times_t {
+    double parse_ms; //json parse or binary decode
+    double raster_ms; //inflating the obstacles into the grid and publishing it
+};
 
 class communicator {
 public:
@@ -90,35 +120,65 @@ public:
     bool is_updated();
     // Returns true if the update is still in progress
     bool update_in_progress();
-    // Returns the data
-    env_data_t get_env_data();
+    // Blocks until the update in progress is done or timeout passes. Returns is_updated()
+    bool wait_for_update(std::chrono::milliseconds timeout);
+    // Called on the update task every time an update finishes, NULL to remove it
+    void set_update_listener(std::function<void()> listener);
+    // Returns true if the last update replaced the grid (size, goal or stationary obstacles)
+    bool is_grid_changed();
+    // Returns the latest environment. It never changes, hold on to it for as long as needed.
+    // NULL until the first update is done.
+    env_snapshot_ptr get_env_snapshot();
     // Returns constants struct
     env_constants_t get_const_data();
-    // Returns the char_map of the updates points
-    point_char_map get_updated_points();
-
-    //Get a lock on the gird_2d data. This lock will unlock when it goes out of scope
-    std::unique_lock<std::mutex> get_lock_env_grid_2d();
-
-
-    // Functions for posting to _JAM
-    void post_results(); //This function needs to be updated to get the data passed to it.
+    // Returns the cells whose cost changed since the last call, one entry per cell with its latest cost
+    cell_update_list get_updated_points();
+    // Returns the latest environment and get_updated_points() together, so the cells
+    // always go with the snapshot. NULL until the first update is done.
+    env_snapshot_ptr take_update(cell_update_list& cells);
+
+    // Grids are pushed by the server and applied as they arrive, instead of by update_data().
+    // Does nothing if already subscribed.
+    void subscribe(subscribe_mode_t mode);
+    // Stops the subscription, no update runs once this returns
+    void unsubscribe();
+    bool is_subscribed();
+    // True when subscribed by long poll, asked for or after the stream failed
+    bool is_long_polling();
+    // Fetches a grid every 1 / poll_rate_hz seconds on its own thread, instead of by
+    // update_data(). Returns false if poll_rate_hz is 0. Does nothing if already running.
+    bool start_scheduler();
+    // Stops the scheduler and waits for its last fetch
+    void stop_scheduler();
+    bool is_scheduled();
+    update_counters_t get_update_counters();
+
+    // Number of grids applied so far, by update_data() or a subscription
+    unsigned long update_count();
+    // Blocks until update_count() is past count or timeout passes. Returns true if it is.
+    bool wait_for_update_count(unsigned long count, std::chrono::milliseconds timeout);
+
+
+    // Records every /api/grid response body to filename, "" stops. Call while no update runs.
+    // Returns false if the file could not be created.
+    bool set_capture_file(const std::string &filename);
+    // Parses a response body and applies it the way update_data() does, on this thread.
+    // For replaying captures, call while no update runs. Returns false if the body is bad.
+    bool apply_grid_body(const uint8_t* body, size_t size, bool binary, grid_stage_times_t* times = NULL);
+
+    // Posts a path to /api/path in the background. If a post is still running, the path
+    // waits for it, and a newer path replaces it before it is sent.
+    void post_results(const std::vector<sbpl_xy_theta_pt_t>& path);
+    // Returns true if the newest path given to post_results() was posted
     bool is_posted();
+    // Returns true while a post runs or a path waits for one
     bool post_in_progress();
+    // Blocks until no post runs or timeout passes. Returns is_posted()
+    bool wait_for_post(std::chrono::milliseconds timeout);
 
 private:
 
-    //Private struct used internally for obstacles
-    struct obstacle_t {
-        int x;
-        int y;
-        int radius;
-        int heading;
-        int velocity;
-    };
-
-
-    bool grid_had_changed; //True when the grid has been changed size in the most recent request
+    std::atomic_bool grid_had_changed; //True when the grid was rebuilt by the most recent request
     //also true when the grid is unset
     //Used to create a new search grid, rather than update an existing one.
 
@@ -126,29 +186,124 @@ private:
     std::atomic_bool m_update_next_time;
     std::atomic_bool m_posted;
 
-    std::mutex m_env_data_mutex; //Mutex for locking m_env_data when editing
-    env_data_t m_env_data; //Enviornment data
+    env_data_t m_env_data; //Enviornment data being built, only used by the update task
 
     env_constants_t m_env_const; //Enviornment constants
     // TODO: Figure our how m_env_const is set...
 
+    // Static and moving obstacle layers, only touched by the update task.
+    // m_env_data.grid_2d points at the static layer.
+    layered_costmap m_costmap;
+    // Row major scratch grid of the distance transform, kept between rebuilds
+    grid_buffer_pool m_grid_pool;
+    // Stationary obstacles in the static layer, and the inflation it was made with
+    stationary_tracker m_stationary;
+    inflation_params_t m_static_inf_params;
+    std::vector<int> m_dirty_tiles;
+    unsigned long m_grid_generation;
+    // Latest published environment
+    snapshot_slot<env_snapshot_t> m_env_snapshot;
+
     std::mutex m_moving_obstacles_pts_mutex;
-    point_char_map m_moving_obstacles_pts;
+    cell_update_list m_moving_obstacles_pts;
+    // Grids in m_moving_obstacles_pts, and where each cell is in it once a second grid came
+    unsigned long m_pending_updates;
+    std::unordered_map<size_t, size_t> m_pending_index;
+    update_counters_t m_update_counters;
 
     //Task objects
     pplx::task<void> m_task_update;   //Task for updating everything
 
+    // Set by update_data(), cleared once the update task is done, signalled on m_update_cv
+    bool m_update_running;
+    std::mutex m_update_mutex;
+    std::condition_variable m_update_cv;
+    std::function<void()> m_update_listener;
+    unsigned long m_update_count;
+
+    // Subscription state, the stream client and the long poll thread
+    std::mutex m_subscribe_mutex;
+    bool m_subscribed;
+    bool m_long_polling;
+    std::unique_ptr<web::websockets::client::websocket_callback_client> m_stream;
+    std::thread m_poll_thread;
+    pplx::cancellation_token_source m_poll_cancel;
+    // ETag of the last grid the long poll got
+    utility::string_t m_poll_etag;
+    // ws:// uri of the stream (stream_uri in the config), derived from HOST when empty
+    utility::string_t m_stream_uri;
+
+    // Polling scheduler, stopped through m_scheduler_cv
+    double m_poll_rate_hz;
+    std::mutex m_scheduler_mutex;
+    std::condition_variable m_scheduler_cv;
+    bool m_scheduler_stop;
+    std::thread m_scheduler_thread;
+
+    // Set while a post runs, m_post_next is the path to send once it is done
+    bool m_post_running;
+    bool m_post_waiting;
+    std::string m_post_next;
+    std::mutex m_post_mutex;
+    std::condition_variable m_post_cv;
+    pplx::task<void> m_task_post;
+
     //Task Generators - Return task objects
     pplx::task<void> get_grid(); //Returns a task for getting grid info
+    // Sends m_post_next, then whatever path came in meanwhile. Called with m_post_mutex held.
+    void start_post();
+    //Returns a task feeding the body to m_grid_parser until it is all read
+    pplx::task<void> read_grid_body(concurrency::streams::streambuf<uint8_t> body,
+                                    std::shared_ptr<std::vector<uint8_t> > chunk);
+
+    // Puts a parsed response into m_env_data and m_costmap
+    void apply_grid_update(const grid_view_t& update);
+
+    // Applies a pushed grid and lets the waiters and the listener know
+    void apply_pushed(const uint8_t* body, size_t size, bool binary);
+    // Connect the stream, or start the long poll thread. Called with m_subscribe_mutex held.
+    bool start_stream();
+    void start_long_poll();
+    void long_poll_main(pplx::cancellation_token token);
+    void scheduler_main();
+    // Adds the changed cells of a grid to m_moving_obstacles_pts. Called with its lock held.
+    void merge_points(const cell_update_list& cells);
+
+    // Streaming parser for /api/grid, and the update it fills. Only used by the update task.
+    grid_parser m_grid_parser;
+    grid_update_t m_grid_update;
+
+    // Ask for the binary grid encoding (grid_encoding in the config), json is the fallback
+    bool m_accept_binary_grid;
+    // Last binary grid body, and room to inflate compressed obstacles. Only used by the update task.
+    std::vector<unsigned char> m_wire_buffer;
+    std::vector<obstacle_t> m_wire_scratch;
+
+    // Response capture, only used by the update task. m_capture_body collects the json chunks.
+    grid_capture_writer m_capture;
+    std::vector<uint8_t> m_capture_body;
+    int64_t m_capture_time_us;
+
+    // Start of the fetch, then of the body once the headers are in. Only used by the update task.
+    std::chrono::steady_clock::time_point m_stage_start;
 
     http_client m_client;
     http_client_config m_client_config;
 
-    // Obstacle inflation parameters and its lock
+    // Obstacle inflation and prediction parameters and their lock
     std::mutex m_inflation_params_mutex;
     inflation_params_t m_inflation_params;
-
-    unsigned char calculate_cost(obstacle_t obs, int x, int y, inflation_params_t inf_param);
+    predict_params_t m_predict_params;
+
+    // Precomputed obstacle stamps, shared by the stationary and moving obstacles
+    inflation_stamp_cache m_stamp_cache;
+    // Stamps of the obstacles being rasterized, only used by the update task
+    stamp_list m_stamps;
+    // Moving obstacles along their predicted tracks, only used by the update task
+    motion_predictor m_predictor;
+    std::vector<obstacle_t> m_predicted;
+    // Threads rasterizing the obstacles (raster_threads in the config, 0 for one per core)
+    std::unique_ptr<thread_pool> m_raster_pool;
 
     //Store the key value pair into m_env_const
     int store_constant(std::string key, std::string value);
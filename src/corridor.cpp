@@ -0,0 +1,227 @@
+///////////////////////////////////////////////////////////////////////////////
+// corridor.cpp - Coarse corridor around the path - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "corridor.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <queue>
+#include <utility>
+
+// Coarse step costs, straight and diagonal, times the cost of the cell stepped into plus one like SBPL
+#define CORRIDOR_STRAIGHT_COST 10
+#define CORRIDOR_DIAGONAL_COST 14
+
+corridor::corridor() :
+    m_width(0),
+    m_height(0),
+    m_scale(1),
+    m_coarse_width(0),
+    m_coarse_height(0),
+    m_cells(0)
+{
+
+}
+
+bool corridor::build(const tiled_grid& grid, int start_x, int start_y, int goal_x, int goal_y,
+                     unsigned char obs_thresh, corridor_params_t params)
+{
+    clear();
+    int width = grid.width();
+    int height = grid.height();
+    if(width <= 0 || height <= 0 || params.scale <= 0 ||
+            start_x < 0 || start_y < 0 || start_x >= width || start_y >= height ||
+            goal_x < 0 || goal_y < 0 || goal_x >= width || goal_y >= height) {
+        return false;
+    }
+    m_width = width;
+    m_height = height;
+    m_scale = params.scale;
+    m_coarse_width = (width + m_scale - 1) / m_scale;
+    m_coarse_height = (height + m_scale - 1) / m_scale;
+
+    max_pool(grid);
+    int start = (start_y / m_scale) * m_coarse_width + start_x / m_scale;
+    int goal = (goal_y / m_scale) * m_coarse_width + goal_x / m_scale;
+    if(!search(start, goal, obs_thresh)) {
+        clear();
+        return false;
+    }
+    grow(std::max(params.buffer, 0));
+    return true;
+}
+
+void corridor::clear()
+{
+    m_coarse.clear();
+    m_mask.clear();
+    m_path.clear();
+    m_cells = 0;
+}
+
+bool corridor::valid() const
+{
+    return !m_path.empty();
+}
+
+size_t corridor::cells() const
+{
+    return m_cells;
+}
+
+const std::vector<int>& corridor::coarse_path() const
+{
+    return m_path;
+}
+
+/*
+ * Only the allocated tiles are read, everything else is zero. Each tile row
+ * is maxed into the blocks it crosses, a whole block span at a time.
+ */
+void corridor::max_pool(const tiled_grid& grid)
+{
+    m_coarse.assign((size_t)m_coarse_width * m_coarse_height, 0);
+    for(size_t t = 0; t < grid.tile_count(); t++) {
+        if(!grid.allocated(t)) {
+            continue;
+        }
+        tile_rect_t rect = grid.tile_rect(t);
+        const unsigned char* cells = grid.tile(t);
+        for(int y = rect.y0; y < rect.y1; y++) {
+            const unsigned char* row = cells + (y - rect.y0) * GRID_TILE_SIZE;
+            unsigned char* coarse_row = &m_coarse[(size_t)(y / m_scale) * m_coarse_width];
+            int x = rect.x0;
+            while(x < rect.x1) {
+                int block_end = std::min((x / m_scale + 1) * m_scale, rect.x1);
+                unsigned char& block = coarse_row[x / m_scale];
+                block = std::max(block, *std::max_element(row + (x - rect.x0), row + (block_end - rect.x0)));
+                x = block_end;
+            }
+        }
+    }
+}
+
+/*
+ * A* with the octile distance, which never overestimates since every step
+ * costs at least its length. The start and goal cells are never blocked, an
+ * obstacle next to the vehicle should not hide the whole block it is in.
+ */
+bool corridor::search(int start, int goal, unsigned char obs_thresh)
+{
+    const int dx[] = {1, -1, 0, 0, 1, 1, -1, -1};
+    const int dy[] = {0, 0, 1, -1, 1, -1, 1, -1};
+    size_t count = m_coarse.size();
+    std::vector<int64_t> g(count, std::numeric_limits<int64_t>::max());
+    std::vector<int> parent(count, -1);
+    int goal_x = goal % m_coarse_width;
+    int goal_y = goal / m_coarse_width;
+    auto heuristic = [&](int cell) {
+        int64_t ddx = std::abs(cell % m_coarse_width - goal_x);
+        int64_t ddy = std::abs(cell / m_coarse_width - goal_y);
+        return CORRIDOR_STRAIGHT_COST * std::max(ddx, ddy) +
+               (CORRIDOR_DIAGONAL_COST - CORRIDOR_STRAIGHT_COST) * std::min(ddx, ddy);
+    };
+
+    typedef std::pair<int64_t, int> open_t;
+    std::priority_queue<open_t, std::vector<open_t>, std::greater<open_t> > open;
+    g[start] = 0;
+    open.push(open_t(heuristic(start), start));
+    while(!open.empty()) {
+        open_t top = open.top();
+        open.pop();
+        int cell = top.second;
+        if(top.first - heuristic(cell) > g[cell]) {
+            //Stale, the cell was reached cheaper since
+            continue;
+        }
+        if(cell == goal) {
+            for(int at = goal; at != -1; at = parent[at]) {
+                m_path.push_back(at);
+            }
+            std::reverse(m_path.begin(), m_path.end());
+            return true;
+        }
+        int x = cell % m_coarse_width;
+        int y = cell / m_coarse_width;
+        for(int i = 0; i < 8; i++) {
+            int nx = x + dx[i];
+            int ny = y + dy[i];
+            if(nx < 0 || ny < 0 || nx >= m_coarse_width || ny >= m_coarse_height) {
+                continue;
+            }
+            int next = ny * m_coarse_width + nx;
+            unsigned char cost = m_coarse[next];
+            if(cost >= obs_thresh && next != goal) {
+                continue;
+            }
+            int64_t step = (i < 4) ? CORRIDOR_STRAIGHT_COST : CORRIDOR_DIAGONAL_COST;
+            int64_t next_g = g[cell] + step * ((next == goal ? 0 : cost) + 1);
+            if(next_g < g[next]) {
+                g[next] = next_g;
+                parent[next] = cell;
+                open.push(open_t(next_g + heuristic(next), next));
+            }
+        }
+    }
+    return false;
+}
+
+/*
+ * Marks the path cells and every coarse cell within buffer of one, then
+ * counts the fine cells that covers
+ */
+void corridor::grow(int buffer)
+{
+    m_mask.assign(m_coarse.size(), 0);
+    for(int cell : m_path) {
+        int x = cell % m_coarse_width;
+        int y = cell / m_coarse_width;
+        for(int ny = std::max(y - buffer, 0); ny <= std::min(y + buffer, m_coarse_height - 1); ny++) {
+            for(int nx = std::max(x - buffer, 0); nx <= std::min(x + buffer, m_coarse_width - 1); nx++) {
+                m_mask[ny * m_coarse_width + nx] = 1;
+            }
+        }
+    }
+
+    m_cells = 0;
+    for(int y = 0; y < m_coarse_height; y++) {
+        int rows = std::min(m_scale, m_height - y * m_scale);
+        for(int x = 0; x < m_coarse_width; x++) {
+            if(m_mask[y * m_coarse_width + x]) {
+                m_cells += (size_t)rows * std::min(m_scale, m_width - x * m_scale);
+            }
+        }
+    }
+}
+
+/*
+ * Down each column, whole coarse blocks at a time
+ */
+void corridor::mask_columns(unsigned char* const* columns, unsigned char blocked) const
+{
+    for(int x = 0; x < m_width; x++) {
+        unsigned char* column = columns[x];
+        for(int cy = 0; cy < m_coarse_height; cy++) {
+            if(!m_mask[(size_t)cy * m_coarse_width + x / m_scale]) {
+                std::fill(column + cy * m_scale, column + std::min((cy + 1) * m_scale, m_height), blocked);
+            }
+        }
+    }
+}
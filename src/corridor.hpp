@@ -0,0 +1,92 @@
+///////////////////////////////////////////////////////////////////////////////
+// corridor.h - Coarse corridor around the path - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef CORRIDOR_H
+#define CORRIDOR_H
+
+#include "tiled_grid.hpp"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Fine cells per coarse cell edge. 8 keeps a 10000 x 10000 grid at 1250 x 1250 coarse cells.
+#define CORRIDOR_DEFAULT_SCALE 8
+// Coarse cells added around the coarse path on every side
+#define CORRIDOR_DEFAULT_BUFFER 2
+
+struct corridor_params_t {
+    int scale; //Fine cells per coarse cell edge, 0 plans on the whole grid
+    int buffer; //Coarse cells of margin around the coarse path
+};
+
+/*
+ * Where the lattice search is allowed to go on a large grid.
+ *
+ * The grid is max pooled into scale x scale blocks, so a coarse cell costs as
+ * much as the worst cell under it, and an 8 connected A* finds a coarse path
+ * from start to goal over it. The cells of that path, grown by buffer coarse
+ * cells, are the corridor.
+ *
+ * Max pooling never makes a coarse cell cheaper than the cells under it, but it
+ * closes gaps narrower than a block, so a corridor can miss a way through that
+ * the fine grid has. Callers fall back to the whole grid when the fine search
+ * fails inside the corridor.
+ */
+class corridor {
+public:
+    corridor();
+
+    // Finds the corridor on a grid, start and goal in cells.
+    // Returns false if the coarse search finds no path or start or goal are off the grid.
+    bool build(const tiled_grid& grid, int start_x, int start_y, int goal_x, int goal_y,
+               unsigned char obs_thresh, corridor_params_t params);
+    void clear();
+
+    // True once build() found a corridor
+    bool valid() const;
+    // Whether the fine cell is inside the corridor
+    inline bool contains(int x, int y) const {
+        return m_mask[(y / m_scale) * m_coarse_width + x / m_scale] != 0;
+    }
+    // Fine cells inside the corridor
+    size_t cells() const;
+    // Coarse cells of the coarse path, start first, as x + y * coarse width
+    const std::vector<int>& coarse_path() const;
+
+    // Sets every cell outside the corridor to blocked, in SBPL style columns[x][y]
+    void mask_columns(unsigned char* const* columns, unsigned char blocked) const;
+
+private:
+    void max_pool(const tiled_grid& grid);
+    bool search(int start, int goal, unsigned char obs_thresh);
+    void grow(int buffer);
+
+    int m_width;
+    int m_height;
+    int m_scale;
+    int m_coarse_width;
+    int m_coarse_height;
+    std::vector<unsigned char> m_coarse; //Max pooled costs
+    std::vector<unsigned char> m_mask; //Coarse cells inside the corridor
+    std::vector<int> m_path;
+    size_t m_cells;
+};
+
+#endif /* CORRIDOR_H */
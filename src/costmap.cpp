@@ -0,0 +1,276 @@
+///////////////////////////////////////////////////////////////////////////////
+// costmap.cpp - Layered cost map - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "costmap.hpp"
+
+#include <algorithm>
+
+layered_costmap::layered_costmap():
+    m_width(0),
+    m_height(0)
+{
+
+}
+
+/*
+ * Resizes the map to width x height, with a new (zeroed) static layer.
+ * Whoever holds the old static layer keeps it. The previous dynamic layer
+ * is forgotten, so the next end_dynamic() reports every moving obstacle
+ * cell as dirty.
+ */
+void layered_costmap::reset(int width, int height)
+{
+    m_width = std::max(width, 0);
+    m_height = std::max(height, 0);
+
+    m_static = std::make_shared<tiled_grid>();
+    m_static->reset(m_width, m_height);
+    m_dynamic.reset(m_width, m_height);
+    m_seen.reset(m_width, m_height);
+
+    m_touched.clear();
+    m_prev_touched.clear();
+    m_prev_cost.clear();
+    m_dirty.clear();
+    m_static_dirty.clear();
+}
+
+int layered_costmap::width() const
+{
+    return m_width;
+}
+
+int layered_costmap::height() const
+{
+    return m_height;
+}
+
+tiled_grid& layered_costmap::static_layer()
+{
+    return *m_static;
+}
+
+const tiled_grid& layered_costmap::static_layer() const
+{
+    return *m_static;
+}
+
+std::shared_ptr<const tiled_grid> layered_costmap::shared_static_layer() const
+{
+    return m_static;
+}
+
+/*
+ * The new static layer starts as a copy of the old one, sharing every tile,
+ * and each dirty tile is stamped again into new memory by one thread from the
+ * obstacles binned to it. Cells that differ from the old tile are checked
+ * against the dynamic layer the planner last got, since the composed cost
+ * does not change under a higher moving obstacle.
+ */
+void layered_costmap::restamp_static(const std::vector<int>& tiles, obstacle_span_t obstacles,
+                                     const stamp_list& stamps, thread_pool& pool)
+{
+    std::shared_ptr<const tiled_grid> old_static = m_static;
+    m_static = std::make_shared<tiled_grid>(*old_static);
+    m_bins.build(m_width, m_height, GRID_TILE_SIZE, obstacles, stamps);
+    if(m_tile_dirty.size() < tiles.size()) {
+        m_tile_dirty.resize(tiles.size());
+    }
+    pool.parallel_for(tiles.size(), [this, &tiles, &obstacles, &stamps, &old_static](size_t i) {
+        int tile = tiles[i];
+        unsigned char* cells = m_static->clear_tile(tile);
+        stamp_tile(cells, m_bins, tile, obstacles, stamps);
+
+        const unsigned char* old_cells = old_static->tile(tile);
+        tile_rect_t rect = m_static->tile_rect(tile);
+        cell_update_list& dirty = m_tile_dirty[i];
+        dirty.clear();
+        for(int y = rect.y0; y < rect.y1; y++) {
+            int row = (y - rect.y0) * GRID_TILE_SIZE - rect.x0;
+            for(int x = rect.x0; x < rect.x1; x++) {
+                if(cells[row + x] == old_cells[row + x]) {
+                    continue;
+                }
+                unsigned char dynamic_cost = m_dynamic.cost(x, y);
+                unsigned char new_cost = std::max(cells[row + x], dynamic_cost);
+                if(new_cost != std::max(old_cells[row + x], dynamic_cost)) {
+                    dirty.push_back({x, y, new_cost});
+                }
+            }
+        }
+        m_static->compact_tile(tile);
+    });
+    m_static_dirty.clear();
+    for(size_t i = 0; i < tiles.size(); i++) {
+        m_static_dirty.insert(m_static_dirty.end(), m_tile_dirty[i].begin(), m_tile_dirty[i].end());
+    }
+}
+
+const cell_update_list& layered_costmap::static_dirty_cells() const
+{
+    return m_static_dirty;
+}
+
+/*
+ * Zeroes the cells of the dynamic layer set by the last update,
+ * remembering their cost so end_dynamic() can diff against it.
+ */
+void layered_costmap::begin_dynamic()
+{
+    m_prev_cost.clear();
+    m_prev_cost.reserve(m_touched.size());
+    for(int index : m_touched) {
+        unsigned char& cell = m_dynamic.write_cell(index % m_width, index / m_width);
+        m_prev_cost.push_back(cell);
+        cell = 0;
+    }
+    m_prev_touched.swap(m_touched);
+    m_touched.clear();
+}
+
+/*
+ * Stamped tile by tile, in the same order stamp_dynamic_tiled() would
+ */
+void layered_costmap::stamp_dynamic(const inflation_stamp_t& stamp, int center_x, int center_y)
+{
+    int x0 = std::max(center_x - stamp.half_size, 0);
+    int y0 = std::max(center_y - stamp.half_size, 0);
+    int x1 = std::min(center_x - stamp.half_size + stamp.size, m_width);
+    int y1 = std::min(center_y - stamp.half_size + stamp.size, m_height);
+    if(x0 >= x1 || y0 >= y1) {
+        return;
+    }
+    for(int ty = y0 >> GRID_TILE_SHIFT; ty <= (y1 - 1) >> GRID_TILE_SHIFT; ty++) {
+        for(int tx = x0 >> GRID_TILE_SHIFT; tx <= (x1 - 1) >> GRID_TILE_SHIFT; tx++) {
+            stamp_dynamic_tile(stamp, center_x, center_y, ty * m_dynamic.tiles_x() + tx, m_touched);
+        }
+    }
+}
+
+/*
+ * Each tile is stamped by one thread and keeps its own list of new cells,
+ * the lists are appended to m_touched in tile order once all are done.
+ * The bins use the tiles of the dynamic layer, so no two threads share one.
+ */
+void layered_costmap::stamp_dynamic_tiled(obstacle_span_t obstacles, const stamp_list& stamps, thread_pool& pool)
+{
+    m_bins.build(m_width, m_height, GRID_TILE_SIZE, obstacles, stamps);
+    const std::vector<int>& tiles = m_bins.busy_tiles();
+    if(m_tile_touched.size() < tiles.size()) {
+        m_tile_touched.resize(tiles.size());
+    }
+    pool.parallel_for(tiles.size(), [this, &tiles, &obstacles, &stamps](size_t i) {
+        int tile = tiles[i];
+        std::vector<int>& touched = m_tile_touched[i];
+        touched.clear();
+        for(const int* it = m_bins.begin(tile); it != m_bins.end(tile); it++) {
+            stamp_dynamic_tile(*stamps[*it], obstacles[*it].x, obstacles[*it].y, tile, touched);
+        }
+    });
+    for(size_t i = 0; i < tiles.size(); i++) {
+        m_touched.insert(m_touched.end(), m_tile_touched[i].begin(), m_tile_touched[i].end());
+    }
+}
+
+/*
+ * The tile only gets memory once a nonzero stamp cell lands on it
+ */
+void layered_costmap::stamp_dynamic_tile(const inflation_stamp_t& stamp, int center_x, int center_y,
+        int tile, std::vector<int>& touched)
+{
+    tile_rect_t rect = m_dynamic.tile_rect(tile);
+    unsigned char* cells = NULL;
+    int top = center_y - stamp.half_size;
+    int left = center_x - stamp.half_size;
+    int row_first = std::max(rect.y0 - top, 0);
+    int row_last = std::min(stamp.size, rect.y1 - top);
+    for(int row = row_first; row < row_last; row++) {
+        int begin = std::max(stamp.row_begin[row], rect.x0 - left);
+        int end = std::min(stamp.row_end[row], rect.x1 - left);
+        const unsigned char* src = &stamp.cost[row * stamp.size];
+        int index = (top + row) * m_width + left;
+        int tile_index = (top + row - rect.y0) * GRID_TILE_SIZE + left - rect.x0;
+        for(int i = begin; i < end; i++) {
+            if(src[i] == 0) {
+                continue;
+            }
+            if(cells == NULL) {
+                cells = m_dynamic.write_tile(tile);
+            }
+            unsigned char& cell = cells[tile_index + i];
+            if(cell == 0) {
+                touched.push_back(index + i);
+            }
+            if(cell < src[i]) {
+                cell = src[i];
+            }
+        }
+    }
+}
+
+/*
+ * Builds the dirty cell list. A cell is dirty when max(static, dynamic)
+ * differs from what it was after the last update. Only cells touched by
+ * either update can change, so nothing else is visited.
+ */
+void layered_costmap::end_dynamic()
+{
+    m_dirty.clear();
+
+    for(size_t i = 0; i < m_prev_touched.size(); i++) {
+        int index = m_prev_touched[i];
+        int x = index % m_width;
+        int y = index / m_width;
+        unsigned char static_cost = m_static->cost(x, y);
+        unsigned char old_cost = std::max(static_cost, m_prev_cost[i]);
+        unsigned char new_cost = std::max(static_cost, m_dynamic.cost(x, y));
+        m_seen.write_cell(x, y) = 1;
+        if(old_cost != new_cost) {
+            m_dirty.push_back({x, y, new_cost});
+        }
+    }
+
+    for(int index : m_touched) {
+        int x = index % m_width;
+        int y = index / m_width;
+        if(m_seen.cost(x, y)) {
+            continue;
+        }
+        unsigned char static_cost = m_static->cost(x, y);
+        unsigned char new_cost = std::max(static_cost, m_dynamic.cost(x, y));
+        if(new_cost != static_cost) {
+            m_dirty.push_back({x, y, new_cost});
+        }
+    }
+
+    for(int index : m_prev_touched) {
+        m_seen.write_cell(index % m_width, index / m_width) = 0;
+    }
+}
+
+unsigned char layered_costmap::cost(int x, int y) const
+{
+    return std::max(m_static->cost(x, y), m_dynamic.cost(x, y));
+}
+
+const cell_update_list& layered_costmap::dirty_cells() const
+{
+    return m_dirty;
+}
+
@@ -0,0 +1,126 @@
+///////////////////////////////////////////////////////////////////////////////
+// costmap.h - Layered cost map - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef COSTMAP_H
+#define COSTMAP_H
+
+#include "inflation.hpp"
+#include "tile_raster.hpp"
+#include "tiled_grid.hpp"
+
+#include <memory>
+#include <vector>
+
+// A single cell whose composed cost changed
+struct cell_update_t {
+    int x;
+    int y;
+    unsigned char cost;
+};
+
+typedef std::vector<cell_update_t> cell_update_list;
+
+/*
+ * Cost map made of a static layer (stationary obstacles) and a dynamic layer
+ * (moving obstacles). The cost of a cell is the max of both layers. Both are
+ * tiled_grids, so only the tiles obstacles were stamped on take memory.
+ *
+ * The dynamic layer is rebuilt every update between begin_dynamic() and
+ * end_dynamic(). Only the cells touched by this update or the last one are
+ * looked at, and the ones whose composed cost changed end up in dirty_cells().
+ */
+class layered_costmap {
+public:
+    layered_costmap();
+
+    // Resizes the map with a new, empty static layer and zeroes the dynamic layer.
+    // Drops the dynamic layer history.
+    void reset(int width, int height);
+
+    int width() const;
+    int height() const;
+
+    // The static layer, width x height cells
+    tiled_grid& static_layer();
+    const tiled_grid& static_layer() const;
+    // The static layer, for snapshots. It must not be written after this is shared.
+    std::shared_ptr<const tiled_grid> shared_static_layer() const;
+
+    // Stamps the given tiles of the static layer again, from scratch, with stamps[i] for every
+    // obstacles[i], which must be all the stationary obstacles. The cells whose composed cost
+    // changed go to static_dirty_cells(). Snapshots of the old static layer are not touched.
+    void restamp_static(const std::vector<int>& tiles, obstacle_span_t obstacles, const stamp_list& stamps,
+                        thread_pool& pool);
+    // The cells the last restamp_static() changed, with their new composed cost
+    const cell_update_list& static_dirty_cells() const;
+
+    // Clears the dynamic layer so the moving obstacles can be stamped again
+    void begin_dynamic();
+    // Raises the dynamic cost of a cell to cost. Cells off the map are ignored.
+    inline void stamp_dynamic(int x, int y, unsigned char cost) {
+        if(x < 0 || x >= m_width || y < 0 || y >= m_height || cost == 0) {
+            return;
+        }
+        unsigned char& cell = m_dynamic.write_cell(x, y);
+        if(cell == 0) {
+            m_touched.push_back(x + y * m_width);
+        }
+        if(cell < cost) {
+            cell = cost;
+        }
+    }
+    // Raises the dynamic layer by a stamp centered at (center_x, center_y), clipped to the map
+    void stamp_dynamic(const inflation_stamp_t& stamp, int center_x, int center_y);
+    // Raises the dynamic layer by stamps[i] for every obstacles[i], tile by tile on the pool.
+    // Same layer as stamp_dynamic() in order, the touched cells are listed tile by tile.
+    void stamp_dynamic_tiled(obstacle_span_t obstacles, const stamp_list& stamps, thread_pool& pool);
+    // Compares the new dynamic layer with the last one and fills dirty_cells()
+    void end_dynamic();
+
+    // Composed cost of a cell
+    unsigned char cost(int x, int y) const;
+
+    // The cells whose composed cost changed in the last begin/end_dynamic cycle
+    const cell_update_list& dirty_cells() const;
+
+private:
+    // stamp_dynamic clipped to one tile, new dynamic cells go to touched
+    void stamp_dynamic_tile(const inflation_stamp_t& stamp, int center_x, int center_y,
+                            int tile, std::vector<int>& touched);
+
+    int m_width;
+    int m_height;
+
+    std::shared_ptr<tiled_grid> m_static;
+    tiled_grid m_dynamic; //Tiles stay allocated once a moving obstacle went over them
+
+    std::vector<int> m_touched; //Indexes with a dynamic cost this update
+    std::vector<int> m_prev_touched; //Indexes with a dynamic cost last update
+    std::vector<unsigned char> m_prev_cost; //Dynamic cost of m_prev_touched, same order
+    tiled_grid m_seen; //Scratch marks used by end_dynamic
+
+    tile_bins m_bins; //Scratch for stamp_dynamic_tiled and restamp_static
+    std::vector<std::vector<int> > m_tile_touched; //New dynamic cells of each busy tile
+    std::vector<cell_update_list> m_tile_dirty; //Changed cells of each restamped tile
+
+    cell_update_list m_dirty;
+    cell_update_list m_static_dirty;
+};
+
+#endif /* COSTMAP_H */
@@ -0,0 +1,154 @@
+///////////////////////////////////////////////////////////////////////////////
+// distance_transform.cpp - Distance transform inflation - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "distance_transform.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <map>
+
+/*
+ * Transform for all the obstacles of one radius.
+ * Only cells within pad = radius + inflation radius of a center get a cost,
+ * so centers further than pad off the grid are dropped and distances are
+ * capped at pad + 1.
+ */
+static void inflate_radius_class(unsigned char* grid, int width, int height,
+                                 int radius, std::vector<std::pair<int, int> >& centers,
+                                 inflation_params_t inf_param, thread_pool& pool)
+{
+    const int pad = std::max(radius + inf_param.radius, 0);
+    const int far = pad + 1;
+
+    //Cost for every squared distance that can still have one
+    std::vector<unsigned char> cost_lut((size_t)pad * pad + 1);
+    for(size_t d2 = 0; d2 < cost_lut.size(); d2++) {
+        cost_lut[d2] = inflation_cost_squared(radius, (int)d2, inf_param);
+    }
+
+    //Drop the centers too far off the grid, then sort by column, then row
+    centers.erase(std::remove_if(centers.begin(), centers.end(), [&](const std::pair<int, int>& center) {
+        return center.first < -pad || center.first >= width + pad ||
+               center.second < -pad || center.second >= height + pad;
+    }), centers.end());
+    std::sort(centers.begin(), centers.end());
+    centers.erase(std::unique(centers.begin(), centers.end()), centers.end());
+
+    std::vector<int> columns; //x of every column holding at least one center
+    std::vector<size_t> column_start; //first center of that column in centers
+    for(size_t i = 0; i < centers.size(); i++) {
+        if(columns.empty() || columns.back() != centers[i].first) {
+            columns.push_back(centers[i].first);
+            column_start.push_back(i);
+        }
+    }
+    if(columns.empty()) {
+        return;
+    }
+    column_start.push_back(centers.size());
+
+    //Pass 1: distance to the nearest center in the same column, for every row of the grid
+    int n_cols = columns.size();
+    std::vector<int> column_dist((size_t)n_cols * height);
+    pool.parallel_for_range(n_cols, [&](int begin, int end) {
+        for(int c = begin; c < end; c++) {
+            int* dist = &column_dist[(size_t)c * height];
+            size_t first = column_start[c];
+            size_t last = column_start[c + 1];
+            size_t next = first;
+            for(int y = 0; y < height; y++) {
+                while(next + 1 < last && centers[next + 1].second <= y) {
+                    next++;
+                }
+                int best = std::abs(centers[next].second - y);
+                if(next + 1 < last) {
+                    best = std::min(best, std::abs(centers[next + 1].second - y));
+                }
+                dist[y] = std::min(best, far);
+            }
+        }
+    });
+
+    //Pass 2: lower envelope of the parabolas (x - q)^2 + column_dist(q)^2 along every row
+    pool.parallel_for_range(height, [&](int begin, int end) {
+        std::vector<int> v(n_cols); //Columns on the envelope
+        std::vector<double> z(n_cols + 1); //Where each envelope parabola starts
+        for(int y = begin; y < end; y++) {
+            int k = -1;
+            for(int c = 0; c < n_cols; c++) {
+                int g = column_dist[(size_t)c * height + y];
+                if(g >= far) {
+                    continue; //Too far to give any cost along this row
+                }
+                long long q = columns[c];
+                long long f_q = (long long)g * g + q * q;
+                double s = 0;
+                while(k >= 0) {
+                    long long p = columns[v[k]];
+                    long long g_p = column_dist[(size_t)v[k] * height + y];
+                    s = (double)(f_q - (g_p * g_p + p * p)) / (2.0 * (q - p));
+                    if(s > z[k]) {
+                        break;
+                    }
+                    k--;
+                }
+                k++;
+                v[k] = c;
+                z[k] = (k == 0) ? -std::numeric_limits<double>::infinity() : s;
+                z[k + 1] = std::numeric_limits<double>::infinity();
+            }
+            if(k < 0) {
+                continue;
+            }
+
+            int j = 0;
+            unsigned char* row = &grid[(size_t)y * width];
+            for(int x = 0; x < width; x++) {
+                while(z[j + 1] < x) {
+                    j++;
+                }
+                long long dx = x - columns[v[j]];
+                long long g = column_dist[(size_t)v[j] * height + y];
+                long long d2 = dx * dx + g * g;
+                if(d2 < (long long)cost_lut.size()) {
+                    row[x] = std::max(row[x], cost_lut[d2]);
+                }
+            }
+        }
+    });
+}
+
+void inflate_distance_transform(unsigned char* grid, int width, int height,
+                                obstacle_span_t obstacles,
+                                inflation_params_t inf_param, thread_pool& pool)
+{
+    if(width <= 0 || height <= 0) {
+        return;
+    }
+
+    std::map<int, std::vector<std::pair<int, int> > > by_radius;
+    for(const obstacle_t& obs : obstacles) {
+        by_radius[obs.radius].push_back(std::make_pair(obs.x, obs.y));
+    }
+    for(auto& radius_class : by_radius) {
+        inflate_radius_class(grid, width, height, radius_class.first, radius_class.second, inf_param, pool);
+    }
+}
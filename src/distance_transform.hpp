@@ -0,0 +1,46 @@
+///////////////////////////////////////////////////////////////////////////////
+// distance_transform.h - Distance transform inflation - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef DISTANCE_TRANSFORM_H
+#define DISTANCE_TRANSFORM_H
+
+#include "inflation.hpp"
+#include "thread_pool.hpp"
+
+#include <vector>
+
+/*
+ * Inflates obstacles into a row major grid with an exact euclidean distance
+ * transform (Felzenszwalb & Huttenlocher) instead of one stamp per obstacle.
+ *
+ * Obstacles are grouped by radius. For every radius the squared distance to
+ * the nearest obstacle center is computed for the whole grid, then turned into
+ * a cost with inflation_cost(), so the result is the same as stamping every
+ * obstacle. Each radius costs O(C * height) for the column pass plus
+ * O((C + width) * height) for the row pass, C being the number of distinct
+ * columns holding a center. So the work grows with the obstacles until every
+ * column has one, and is at most O(radii * width * height).
+ *
+ * Columns, then rows, are split over the pool.
+ */
+void inflate_distance_transform(unsigned char* grid, int width, int height,
+                                obstacle_span_t obstacles,
+                                inflation_params_t inf_param, thread_pool& pool);
+
+#endif /* DISTANCE_TRANSFORM_H */
@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////////
+// env_snapshot.cpp - Immutable environment snapshots - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "env_snapshot.hpp"
+
+grid_buffer_pool::pool_state_t::~pool_state_t()
+{
+    for(grid_buffer_t* buffer : idle) {
+        delete buffer;
+    }
+}
+
+grid_buffer_pool::grid_buffer_pool(size_t max_idle) :
+    m_state(new pool_state_t())
+{
+    m_state->max_idle = max_idle;
+}
+
+/*
+ * Takes an idle buffer (the one with the most room, so resizing does not
+ * allocate) or makes a new one. The deleter puts it back in the pool.
+ */
+std::shared_ptr<grid_buffer_t> grid_buffer_pool::acquire(size_t size)
+{
+    grid_buffer_t* buffer = NULL;
+    {
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        if(!m_state->idle.empty()) {
+            auto best = m_state->idle.begin();
+            for(auto it = m_state->idle.begin(); it != m_state->idle.end(); it++) {
+                if((*it)->capacity() > (*best)->capacity()) {
+                    best = it;
+                }
+            }
+            buffer = *best;
+            m_state->idle.erase(best);
+        }
+    }
+    if(buffer == NULL) {
+        buffer = new grid_buffer_t();
+    }
+    buffer->assign(size, 0);
+
+    std::weak_ptr<pool_state_t> weak_state = m_state;
+    return std::shared_ptr<grid_buffer_t>(buffer, [weak_state](grid_buffer_t * released) {
+        std::shared_ptr<pool_state_t> state = weak_state.lock();
+        if(state) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if(state->idle.size() < state->max_idle) {
+                state->idle.push_back(released);
+                return;
+            }
+        }
+        delete released;
+    });
+}
+
+size_t grid_buffer_pool::idle() const
+{
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    return m_state->idle.size();
+}
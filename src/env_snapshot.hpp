@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////////
+// env_snapshot.h - Immutable environment snapshots - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef ENV_SNAPSHOT_H
+#define ENV_SNAPSHOT_H
+
+#include "tiled_grid.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct env_data_t {
+    int height; //y
+    int width; //x
+    int start_x; //meters
+    int start_y; //meters
+    int start_theta; //degrees
+    int end_x; //meters
+    int end_y; //meters
+    int end_theta; //degrees
+    const tiled_grid* grid_2d; //Owned by the snapshot holding this
+};
+
+typedef std::vector<unsigned char> grid_buffer_t;
+
+/*
+ * One generation of the environment. Never changed once published, so it can
+ * be read without locks for as long as the shared_ptr is held.
+ */
+struct env_snapshot_t {
+    env_data_t data; //data.grid_2d points at grid
+    std::shared_ptr<const tiled_grid> grid;
+    unsigned long grid_generation; //Goes up every time the grid is replaced
+};
+
+typedef std::shared_ptr<const env_snapshot_t> env_snapshot_ptr;
+
+/*
+ * Hands out zeroed grid buffers and takes them back once the last shared_ptr
+ * to them is gone, so a new grid reuses the memory of an old one instead of
+ * allocating it again. The pool may be destroyed before its buffers.
+ */
+class grid_buffer_pool {
+public:
+    // max_idle is how many released buffers are kept around
+    explicit grid_buffer_pool(size_t max_idle = 2);
+
+    // A buffer of size cells, all zero
+    std::shared_ptr<grid_buffer_t> acquire(size_t size);
+
+    // Number of buffers waiting to be reused
+    size_t idle() const;
+
+private:
+    struct pool_state_t {
+        std::mutex mutex;
+        std::vector<grid_buffer_t*> idle;
+        size_t max_idle;
+        ~pool_state_t();
+    };
+
+    std::shared_ptr<pool_state_t> m_state;
+};
+
+/*
+ * Holds the latest snapshot. Readers copy the shared_ptr and writers replace
+ * it, both under a spin lock held only for the pointer copy, so neither side
+ * ever waits for the other to finish its work.
+ */
+template<typename T>
+class snapshot_slot {
+public:
+    snapshot_slot() {
+        m_lock.clear();
+    }
+
+    std::shared_ptr<const T> load() const {
+        lock();
+        std::shared_ptr<const T> ptr = m_ptr;
+        m_lock.clear(std::memory_order_release);
+        return ptr;
+    }
+
+    void store(std::shared_ptr<const T> ptr) {
+        lock();
+        m_ptr.swap(ptr);
+        m_lock.clear(std::memory_order_release);
+        //The old snapshot, if this was the last reference, is freed here, outside the lock
+    }
+
+private:
+    void lock() const {
+        while(m_lock.test_and_set(std::memory_order_acquire)) {
+        }
+    }
+
+    mutable std::atomic_flag m_lock;
+    std::shared_ptr<const T> m_ptr;
+};
+
+#endif /* ENV_SNAPSHOT_H */
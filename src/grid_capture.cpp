@@ -0,0 +1,155 @@
+///////////////////////////////////////////////////////////////////////////////
+// grid_capture.cpp - Recording of raw grid responses - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "grid_capture.hpp"
+
+#include <chrono>
+
+#define GRID_CAPTURE_HEADER_SIZE 8
+#define GRID_CAPTURE_RECORD_HEADER_SIZE 16
+
+static void put_u32(uint8_t* out, uint32_t value)
+{
+    out[0] = value & 0xff;
+    out[1] = (value >> 8) & 0xff;
+    out[2] = (value >> 16) & 0xff;
+    out[3] = (value >> 24) & 0xff;
+}
+
+static uint32_t get_u32(const uint8_t* data)
+{
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+int64_t grid_capture_now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+grid_capture_writer::grid_capture_writer() :
+    m_file(NULL)
+{
+
+}
+
+grid_capture_writer::~grid_capture_writer()
+{
+    close();
+}
+
+bool grid_capture_writer::open(const std::string& filename)
+{
+    close();
+    m_file = fopen(filename.c_str(), "wb");
+    if(m_file == NULL) {
+        return false;
+    }
+    uint8_t header[GRID_CAPTURE_HEADER_SIZE] = {0};
+    put_u32(header, GRID_CAPTURE_MAGIC);
+    header[4] = GRID_CAPTURE_VERSION & 0xff;
+    header[5] = (GRID_CAPTURE_VERSION >> 8) & 0xff;
+    if(fwrite(header, 1, sizeof(header), m_file) != sizeof(header)) {
+        close();
+        return false;
+    }
+    fflush(m_file);
+    return true;
+}
+
+void grid_capture_writer::close()
+{
+    if(m_file != NULL) {
+        fclose(m_file);
+        m_file = NULL;
+    }
+}
+
+bool grid_capture_writer::is_open() const
+{
+    return m_file != NULL;
+}
+
+bool grid_capture_writer::write(int64_t time_us, uint8_t encoding, const uint8_t* body, size_t size)
+{
+    if(m_file == NULL || size > UINT32_MAX) {
+        return false;
+    }
+    uint8_t header[GRID_CAPTURE_RECORD_HEADER_SIZE] = {0};
+    put_u32(header, (uint32_t)((uint64_t)time_us & 0xffffffff));
+    put_u32(header + 4, (uint32_t)((uint64_t)time_us >> 32));
+    put_u32(header + 8, (uint32_t)size);
+    header[12] = encoding;
+    if(fwrite(header, 1, sizeof(header), m_file) != sizeof(header) ||
+            (size > 0 && fwrite(body, 1, size, m_file) != size)) {
+        return false;
+    }
+    return fflush(m_file) == 0;
+}
+
+grid_capture_reader::grid_capture_reader() :
+    m_file(NULL)
+{
+
+}
+
+grid_capture_reader::~grid_capture_reader()
+{
+    close();
+}
+
+bool grid_capture_reader::open(const std::string& filename)
+{
+    close();
+    m_file = fopen(filename.c_str(), "rb");
+    if(m_file == NULL) {
+        return false;
+    }
+    uint8_t header[GRID_CAPTURE_HEADER_SIZE];
+    if(fread(header, 1, sizeof(header), m_file) != sizeof(header) || get_u32(header) != GRID_CAPTURE_MAGIC ||
+            (header[4] | (header[5] << 8)) != GRID_CAPTURE_VERSION) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void grid_capture_reader::close()
+{
+    if(m_file != NULL) {
+        fclose(m_file);
+        m_file = NULL;
+    }
+}
+
+bool grid_capture_reader::next(grid_capture_record_t& record)
+{
+    if(m_file == NULL) {
+        return false;
+    }
+    uint8_t header[GRID_CAPTURE_RECORD_HEADER_SIZE];
+    if(fread(header, 1, sizeof(header), m_file) != sizeof(header)) {
+        return false;
+    }
+    record.time_us = (int64_t)((uint64_t)get_u32(header) | ((uint64_t)get_u32(header + 4) << 32));
+    uint32_t size = get_u32(header + 8);
+    record.encoding = header[12];
+    record.body.resize(size);
+    return size == 0 || fread(record.body.data(), 1, size, m_file) == size;
+}
@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+// grid_capture.h - Recording of raw grid responses - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GRID_CAPTURE_H
+#define GRID_CAPTURE_H
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#define GRID_CAPTURE_MAGIC 0x50435244 // "DRCP" read as a little endian uint32
+#define GRID_CAPTURE_VERSION 1
+
+// grid_capture_record_t::encoding
+#define GRID_CAPTURE_JSON 0
+#define GRID_CAPTURE_WIRE 1 // See grid_wire.hpp
+
+/*
+ * A capture file is an 8 byte header (magic, version, unused u16) followed by
+ * one record per response: time_us as an int64, the body size as a uint32,
+ * the encoding as a uint8, 3 unused bytes and the body. All little endian.
+ */
+struct grid_capture_record_t {
+    int64_t time_us; //Wall clock time the response came in, microseconds since the epoch
+    uint8_t encoding;
+    std::vector<uint8_t> body;
+};
+
+// Microseconds since the epoch, for grid_capture_record_t::time_us
+int64_t grid_capture_now_us();
+
+// Appends responses to a capture file
+class grid_capture_writer {
+public:
+    grid_capture_writer();
+    ~grid_capture_writer();
+
+    // Starts a new capture, replacing the file. False if it could not be created.
+    bool open(const std::string& filename);
+    void close();
+    bool is_open() const;
+    // Writes one record and flushes it, so a crash keeps everything before it
+    bool write(int64_t time_us, uint8_t encoding, const uint8_t* body, size_t size);
+
+private:
+    grid_capture_writer(const grid_capture_writer&);
+    grid_capture_writer& operator=(const grid_capture_writer&);
+
+    FILE* m_file;
+};
+
+// Reads the records of a capture file in order
+class grid_capture_reader {
+public:
+    grid_capture_reader();
+    ~grid_capture_reader();
+
+    // False if the file can not be read or is not a capture
+    bool open(const std::string& filename);
+    void close();
+    // Reads the next record, false at the end of the file or on a cut off record
+    bool next(grid_capture_record_t& record);
+
+private:
+    grid_capture_reader(const grid_capture_reader&);
+    grid_capture_reader& operator=(const grid_capture_reader&);
+
+    FILE* m_file;
+};
+
+#endif /* GRID_CAPTURE_H */
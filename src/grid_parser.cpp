@@ -0,0 +1,389 @@
+///////////////////////////////////////////////////////////////////////////////
+// grid_parser.cpp - Streaming parser for /api/grid - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "grid_parser.hpp"
+
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+// Bits of the obstacle fields found so far
+#define OBSTACLE_FIELD_X 1
+#define OBSTACLE_FIELD_Y 2
+#define OBSTACLE_FIELD_RADIUS 4
+#define OBSTACLE_FIELD_HEADING 8
+#define OBSTACLE_FIELD_VELOCITY 16
+
+grid_parser::grid_parser():
+    m_update(NULL),
+    m_lex(LEX_VALUE),
+    m_obstacle_fields(0),
+    m_done(false)
+{
+
+}
+
+void grid_parser::reset(grid_update_t* update)
+{
+    m_update = update;
+    m_update->clear();
+    m_stack.clear();
+    m_lex = LEX_VALUE;
+    m_token.clear();
+    m_obstacle_fields = 0;
+    m_done = false;
+}
+
+/*
+ * Tokenizes the chunk one byte at a time. A token cut in two by the end of
+ * a chunk is kept in m_token and finished by the next call.
+ */
+void grid_parser::feed(const char* data, size_t size)
+{
+    size_t i = 0;
+    while(i < size) {
+        char c = data[i];
+        switch(m_lex) {
+        case LEX_STRING:
+            if(c == '"') {
+                m_lex = LEX_VALUE;
+                on_string();
+            } else if(c == '\\') {
+                m_lex = LEX_STRING_ESCAPE;
+            } else {
+                m_token += c;
+            }
+            i++;
+            break;
+        case LEX_STRING_ESCAPE:
+            //Escapes only matter for keys, and ours have none
+            m_token += c;
+            m_lex = LEX_STRING;
+            i++;
+            break;
+        case LEX_NUMBER:
+            if((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E') {
+                m_token += c;
+                i++;
+            } else {
+                //The number ended, c still needs to be looked at
+                m_lex = LEX_VALUE;
+                on_number();
+            }
+            break;
+        case LEX_LITERAL:
+            if(c >= 'a' && c <= 'z') {
+                m_token += c;
+                i++;
+            } else {
+                m_lex = LEX_VALUE;
+                on_literal();
+            }
+            break;
+        case LEX_VALUE:
+            switch(c) {
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+            case ':':
+                break;
+            case ',':
+                if(!m_stack.empty() && m_stack.back().is_object) {
+                    m_stack.back().expect_key = true;
+                }
+                break;
+            case '{':
+                begin_container(true);
+                break;
+            case '[':
+                begin_container(false);
+                break;
+            case '}':
+                end_container(true);
+                break;
+            case ']':
+                end_container(false);
+                break;
+            case '"':
+                m_token.clear();
+                m_lex = LEX_STRING;
+                break;
+            default:
+                m_token.clear();
+                m_token += c;
+                if((c >= '0' && c <= '9') || c == '-') {
+                    m_lex = LEX_NUMBER;
+                } else if(c >= 'a' && c <= 'z') {
+                    m_lex = LEX_LITERAL;
+                } else {
+                    throw grid_parse_exception("Bad json in grid response");
+                }
+            }
+            i++;
+            break;
+        }
+    }
+}
+
+void grid_parser::finish()
+{
+    if(!m_done) {
+        throw grid_parse_exception("Grid response ended before the end of the json");
+    }
+}
+
+/*
+ * Works out what the new object or array is from its parent and key
+ */
+void grid_parser::begin_container(bool is_object)
+{
+    if(m_done) {
+        throw grid_parse_exception("Bad json in grid response: data after the grid object");
+    }
+
+    role_t role = ROLE_IGNORED;
+    if(m_stack.empty()) {
+        if(!is_object) {
+            throw grid_parse_exception("Bad json in grid response: expected an object");
+        }
+        role = ROLE_ROOT;
+    } else {
+        const frame_t& parent = m_stack.back();
+        if(parent.role == ROLE_ROOT && is_object) {
+            if(parent.key == KEY_LOCATION) {
+                role = ROLE_LOCATION;
+                m_update->present |= GRID_FIELD_LOCATION;
+            } else if(parent.key == KEY_GOAL) {
+                role = ROLE_GOAL;
+                m_update->present |= GRID_FIELD_GOAL;
+            } else if(parent.key == KEY_OBSTACLES) {
+                role = ROLE_OBSTACLES;
+                m_update->present |= GRID_FIELD_OBSTACLES;
+            }
+        } else if(parent.role == ROLE_OBSTACLES && !is_object) {
+            if(parent.key == KEY_STATIONARY_OBSTACLES) {
+                role = ROLE_STATIONARY_LIST;
+                m_update->present |= GRID_FIELD_STATIONARY;
+            } else if(parent.key == KEY_MOVING_OBSTACLES) {
+                role = ROLE_MOVING_LIST;
+                m_update->present |= GRID_FIELD_MOVING;
+            }
+        } else if(parent.role == ROLE_STATIONARY_LIST && is_object) {
+            role = ROLE_STATIONARY_OBSTACLE;
+            m_update->stationary_obstacles.push_back({0, 0, 0, 0, 0});
+            m_obstacle_fields = 0;
+        } else if(parent.role == ROLE_MOVING_LIST && is_object) {
+            role = ROLE_MOVING_OBSTACLE;
+            m_update->moving_obstacles.push_back({0, 0, 0, 0, 0});
+            m_obstacle_fields = 0;
+        }
+    }
+
+    frame_t frame = {role, is_object, is_object, KEY_NONE};
+    m_stack.push_back(frame);
+}
+
+void grid_parser::end_container(bool is_object)
+{
+    if(m_stack.empty() || m_stack.back().is_object != is_object) {
+        throw grid_parse_exception("Bad json in grid response: unbalanced brackets");
+    }
+
+    //Obstacles need all their fields, like the .at() calls used to
+    role_t role = m_stack.back().role;
+    if(role == ROLE_STATIONARY_OBSTACLE || role == ROLE_MOVING_OBSTACLE) {
+        const char* missing = NULL;
+        if(!(m_obstacle_fields & OBSTACLE_FIELD_X)) {
+            missing = "x";
+        } else if(!(m_obstacle_fields & OBSTACLE_FIELD_Y)) {
+            missing = "y";
+        } else if(!(m_obstacle_fields & OBSTACLE_FIELD_RADIUS)) {
+            missing = "radius";
+        } else if(role == ROLE_MOVING_OBSTACLE && !(m_obstacle_fields & OBSTACLE_FIELD_HEADING)) {
+            missing = "heading";
+        } else if(role == ROLE_MOVING_OBSTACLE && !(m_obstacle_fields & OBSTACLE_FIELD_VELOCITY)) {
+            missing = "velocity";
+        }
+        if(missing != NULL) {
+            throw grid_parse_exception(std::string("value ") + missing + " not found in obstacle");
+        }
+    }
+
+    m_stack.pop_back();
+    if(m_stack.empty()) {
+        m_done = true;
+    }
+}
+
+void grid_parser::on_string()
+{
+    if(m_stack.empty()) {
+        throw grid_parse_exception("Bad json in grid response: expected an object");
+    }
+    frame_t& frame = m_stack.back();
+    if(frame.is_object && frame.expect_key) {
+        frame.key = lookup_key(m_token);
+        frame.expect_key = false;
+    }
+    //String values are not used
+}
+
+void grid_parser::on_number()
+{
+    const char* token = m_token.c_str();
+    char* end = NULL;
+    bool in_range = false;
+    int value = 0;
+    errno = 0;
+    if(m_token.find_first_of(".eE") == std::string::npos) {
+        long number = std::strtol(token, &end, 10);
+        in_range = errno != ERANGE && number >= INT_MIN && number <= INT_MAX;
+        value = in_range ? (int)number : 0;
+    } else {
+        //Written so NaN and infinity are out of range too
+        double number = std::strtod(token, &end);
+        in_range = number >= INT_MIN && number <= INT_MAX;
+        value = in_range ? (int)number : 0;
+    }
+    if(end == token || *end != '\0' || !in_range) {
+        throw grid_parse_exception("Bad json in grid response: bad number " + m_token);
+    }
+    store_int(value);
+}
+
+void grid_parser::on_literal()
+{
+    if(m_token == "true") {
+        store_bool(true);
+    } else if(m_token == "false") {
+        store_bool(false);
+    } else if(m_token != "null") {
+        throw grid_parse_exception("Bad json in grid response: unknown literal " + m_token);
+    }
+}
+
+void grid_parser::store_int(int value)
+{
+    if(m_stack.empty() || !m_stack.back().is_object) {
+        return;
+    }
+    const frame_t& frame = m_stack.back();
+    switch(frame.role) {
+    case ROLE_ROOT:
+        if(frame.key == KEY_GRID_WIDTH) {
+            m_update->width = value;
+            m_update->present |= GRID_FIELD_WIDTH;
+        } else if(frame.key == KEY_GRID_HEIGHT) {
+            m_update->height = value;
+            m_update->present |= GRID_FIELD_HEIGHT;
+        }
+        break;
+    case ROLE_LOCATION:
+        if(frame.key == KEY_X) {
+            m_update->location_x = value;
+            m_update->present |= GRID_FIELD_LOCATION_X;
+        } else if(frame.key == KEY_Y) {
+            m_update->location_y = value;
+            m_update->present |= GRID_FIELD_LOCATION_Y;
+        } else if(frame.key == KEY_THETA) {
+            m_update->location_theta = value;
+            m_update->present |= GRID_FIELD_LOCATION_THETA;
+        }
+        break;
+    case ROLE_GOAL:
+        if(frame.key == KEY_X) {
+            m_update->goal_x = value;
+            m_update->present |= GRID_FIELD_GOAL_X;
+        } else if(frame.key == KEY_Y) {
+            m_update->goal_y = value;
+            m_update->present |= GRID_FIELD_GOAL_Y;
+        } else if(frame.key == KEY_THETA) {
+            m_update->goal_theta = value;
+            m_update->present |= GRID_FIELD_GOAL_THETA;
+        }
+        break;
+    case ROLE_STATIONARY_OBSTACLE:
+    case ROLE_MOVING_OBSTACLE: {
+        obstacle_t& obs = (frame.role == ROLE_STATIONARY_OBSTACLE) ?
+                          m_update->stationary_obstacles.back() : m_update->moving_obstacles.back();
+        if(frame.key == KEY_X) {
+            obs.x = value;
+            m_obstacle_fields |= OBSTACLE_FIELD_X;
+        } else if(frame.key == KEY_Y) {
+            obs.y = value;
+            m_obstacle_fields |= OBSTACLE_FIELD_Y;
+        } else if(frame.key == KEY_RADIUS) {
+            obs.radius = value;
+            m_obstacle_fields |= OBSTACLE_FIELD_RADIUS;
+        } else if(frame.key == KEY_HEADING && frame.role == ROLE_MOVING_OBSTACLE) {
+            obs.heading = value;
+            m_obstacle_fields |= OBSTACLE_FIELD_HEADING;
+        } else if(frame.key == KEY_VELOCITY && frame.role == ROLE_MOVING_OBSTACLE) {
+            obs.velocity = value;
+            m_obstacle_fields |= OBSTACLE_FIELD_VELOCITY;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void grid_parser::store_bool(bool value)
+{
+    if(m_stack.empty() || !m_stack.back().is_object) {
+        return;
+    }
+    const frame_t& frame = m_stack.back();
+    if(frame.role == ROLE_ROOT && frame.key == KEY_IS_CHANGED) {
+        m_update->is_changed = value;
+        m_update->present |= GRID_FIELD_IS_CHANGED;
+    }
+}
+
+grid_parser::key_t grid_parser::lookup_key(const std::string& key)
+{
+    static const struct {
+        const char* name;
+        key_t key;
+    } keys[] = {
+        {"x", KEY_X},
+        {"y", KEY_Y},
+        {"radius", KEY_RADIUS},
+        {"heading", KEY_HEADING},
+        {"velocity", KEY_VELOCITY},
+        {"theta", KEY_THETA},
+        {"is_changed", KEY_IS_CHANGED},
+        {"grid_width", KEY_GRID_WIDTH},
+        {"grid_height", KEY_GRID_HEIGHT},
+        {"location", KEY_LOCATION},
+        {"goal", KEY_GOAL},
+        {"obstacles", KEY_OBSTACLES},
+        {"stationary_obstacles", KEY_STATIONARY_OBSTACLES},
+        {"moving_obstacles", KEY_MOVING_OBSTACLES}
+    };
+    for(const auto& entry : keys) {
+        if(key == entry.name) {
+            return entry.key;
+        }
+    }
+    return KEY_OTHER;
+}
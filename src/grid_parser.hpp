@@ -0,0 +1,112 @@
+///////////////////////////////////////////////////////////////////////////////
+// grid_parser.h - Streaming parser for /api/grid - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GRID_PARSER_H
+#define GRID_PARSER_H
+
+#include "grid_update.hpp"
+
+#include <string>
+#include <vector>
+
+/*
+ * SAX style parser for the /api/grid json.
+ * The body is fed in chunks of any size as it comes off the socket, and the
+ * obstacles go straight into the vectors of a grid_update_t without building
+ * a json tree. Unknown keys are skipped.
+ */
+class grid_parser {
+public:
+    grid_parser();
+
+    // Starts a new document. update is cleared and filled by the next feed() calls.
+    void reset(grid_update_t* update);
+    // Parses the next chunk of the document. Throws grid_parse_exception on bad json.
+    void feed(const char* data, size_t size);
+    // Call after the last chunk. Throws grid_parse_exception if the document is incomplete.
+    void finish();
+
+private:
+    // What the object or array being parsed is
+    enum role_t {
+        ROLE_IGNORED,
+        ROLE_ROOT,
+        ROLE_LOCATION,
+        ROLE_GOAL,
+        ROLE_OBSTACLES,
+        ROLE_STATIONARY_LIST,
+        ROLE_MOVING_LIST,
+        ROLE_STATIONARY_OBSTACLE,
+        ROLE_MOVING_OBSTACLE
+    };
+
+    // Keys we care about, anything else is KEY_OTHER
+    enum key_t {
+        KEY_NONE,
+        KEY_OTHER,
+        KEY_IS_CHANGED,
+        KEY_GRID_WIDTH,
+        KEY_GRID_HEIGHT,
+        KEY_LOCATION,
+        KEY_GOAL,
+        KEY_OBSTACLES,
+        KEY_STATIONARY_OBSTACLES,
+        KEY_MOVING_OBSTACLES,
+        KEY_X,
+        KEY_Y,
+        KEY_THETA,
+        KEY_RADIUS,
+        KEY_HEADING,
+        KEY_VELOCITY
+    };
+
+    // Where the tokenizer is
+    enum lex_state_t {
+        LEX_VALUE, // Between tokens
+        LEX_STRING, // In a string
+        LEX_STRING_ESCAPE, // Right after a \ in a string
+        LEX_NUMBER, // In a number
+        LEX_LITERAL // In true, false or null
+    };
+
+    struct frame_t {
+        role_t role;
+        bool is_object;
+        bool expect_key; // Objects only, the next string is a key
+        key_t key; // Objects only, the key of the value being parsed
+    };
+
+    void begin_container(bool is_object);
+    void end_container(bool is_object);
+    void on_string();
+    void on_number();
+    void on_literal();
+    void store_int(int value);
+    void store_bool(bool value);
+    static key_t lookup_key(const std::string& key);
+
+    grid_update_t* m_update;
+    std::vector<frame_t> m_stack;
+    lex_state_t m_lex;
+    std::string m_token;
+    unsigned int m_obstacle_fields; //Fields found in the obstacle being parsed
+    bool m_done; //The root object was closed
+};
+
+#endif /* GRID_PARSER_H */
@@ -0,0 +1,110 @@
+///////////////////////////////////////////////////////////////////////////////
+// grid_update.cpp - Grid update from the server - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "grid_update.hpp"
+
+void grid_update_t::clear()
+{
+    present = 0;
+    is_changed = false;
+    width = 0;
+    height = 0;
+    location_x = 0;
+    location_y = 0;
+    location_theta = 0;
+    goal_x = 0;
+    goal_y = 0;
+    goal_theta = 0;
+    stationary_obstacles.clear();
+    moving_obstacles.clear();
+}
+
+grid_view_t grid_update_t::view() const
+{
+    grid_view_t view = {present, is_changed, width, height,
+                        location_x, location_y, location_theta,
+                        goal_x, goal_y, goal_theta,
+                        obstacle_span_t(stationary_obstacles), obstacle_span_t(moving_obstacles)
+                       };
+    return view;
+}
+
+/*
+ * Same checks, in the same order and with the same messages,
+ * as get_grid() did when it walked the json tree.
+ */
+void check_grid_update(const grid_view_t& update, bool full)
+{
+    if(!(update.present & GRID_FIELD_IS_CHANGED)) {
+        throw grid_parse_exception("value is_changed is messed up");
+    }
+    if(!(update.present & GRID_FIELD_LOCATION)) {
+        throw grid_parse_exception("value location not found in grid");
+    }
+    if(!(update.present & GRID_FIELD_LOCATION_X)) {
+        throw grid_parse_exception("value x not found in location");
+    }
+    if(!(update.present & GRID_FIELD_LOCATION_Y)) {
+        throw grid_parse_exception("value y not found in location");
+    }
+    if(!(update.present & GRID_FIELD_LOCATION_THETA)) {
+        throw grid_parse_exception("value theta not found in location");
+    }
+    if(!(update.present & GRID_FIELD_OBSTACLES)) {
+        throw grid_parse_exception("value obstacles not found in grid");
+    }
+    if(full) {
+        if(!(update.present & GRID_FIELD_WIDTH)) {
+            throw grid_parse_exception("value grid_width is messed up");
+        }
+        if(!(update.present & GRID_FIELD_HEIGHT)) {
+            throw grid_parse_exception("value grid_height is messed up");
+        }
+        if(!(update.present & GRID_FIELD_STATIONARY)) {
+            throw grid_parse_exception("value stationary_obstacles not found in grid");
+        }
+        if(!(update.present & GRID_FIELD_GOAL)) {
+            throw grid_parse_exception("value goal not found in grid");
+        }
+        if(!(update.present & GRID_FIELD_GOAL_X)) {
+            throw grid_parse_exception("value x not found in goal");
+        }
+        if(!(update.present & GRID_FIELD_GOAL_Y)) {
+            throw grid_parse_exception("value y not found in goal");
+        }
+        if(!(update.present & GRID_FIELD_GOAL_THETA)) {
+            throw grid_parse_exception("value theta not found in goal");
+        }
+    }
+    if(!(update.present & GRID_FIELD_MOVING)) {
+        throw grid_parse_exception("value moving_obstacles not found in grid");
+    }
+}
+
+/*
+ * Bounds the obstacle radii before any stamp is made for them.
+ */
+void check_obstacle_radii(obstacle_span_t obstacles, int max_radius)
+{
+    for(const obstacle_t& obs : obstacles) {
+        if(obs.radius < 0 || obs.radius > max_radius) {
+            throw grid_parse_exception("obstacle radius " + std::to_string(obs.radius) + " out of range");
+        }
+    }
+}
@@ -0,0 +1,101 @@
+///////////////////////////////////////////////////////////////////////////////
+// grid_update.h - Grid update from the server - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GRID_UPDATE_H
+#define GRID_UPDATE_H
+
+#include "inflation.hpp" //For obstacle_t
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Bits of grid_update_t::present and grid_view_t::present, set for every field found with the right type
+enum grid_field_t {
+    GRID_FIELD_IS_CHANGED = 1 << 0,
+    GRID_FIELD_WIDTH = 1 << 1,
+    GRID_FIELD_HEIGHT = 1 << 2,
+    GRID_FIELD_LOCATION = 1 << 3,
+    GRID_FIELD_LOCATION_X = 1 << 4,
+    GRID_FIELD_LOCATION_Y = 1 << 5,
+    GRID_FIELD_LOCATION_THETA = 1 << 6,
+    GRID_FIELD_GOAL = 1 << 7,
+    GRID_FIELD_GOAL_X = 1 << 8,
+    GRID_FIELD_GOAL_Y = 1 << 9,
+    GRID_FIELD_GOAL_THETA = 1 << 10,
+    GRID_FIELD_OBSTACLES = 1 << 11,
+    GRID_FIELD_STATIONARY = 1 << 12,
+    GRID_FIELD_MOVING = 1 << 13
+};
+
+// Read only view of one /api/grid response. The obstacles point into
+// a grid_update_t or straight into a received binary buffer.
+struct grid_view_t {
+    unsigned int present; //grid_field_t bits
+    bool is_changed;
+    int width;
+    int height;
+    int location_x;
+    int location_y;
+    int location_theta;
+    int goal_x;
+    int goal_y;
+    int goal_theta;
+    obstacle_span_t stationary_obstacles;
+    obstacle_span_t moving_obstacles;
+};
+
+// Everything we read from one /api/grid response
+struct grid_update_t {
+    unsigned int present; //grid_field_t bits
+    bool is_changed;
+    int width;
+    int height;
+    int location_x;
+    int location_y;
+    int location_theta;
+    int goal_x;
+    int goal_y;
+    int goal_theta;
+    std::vector<obstacle_t> stationary_obstacles;
+    std::vector<obstacle_t> moving_obstacles;
+
+    // Zeroes everything. The obstacle vectors keep their memory for the next update.
+    void clear();
+    // View of this update, valid until it is changed
+    grid_view_t view() const;
+};
+
+// Thrown when a grid response is malformed or misses a field
+class grid_parse_exception : public std::runtime_error {
+public:
+    explicit grid_parse_exception(const std::string& what): std::runtime_error(what) {}
+};
+
+/*
+ * Throws grid_parse_exception if a field get_grid() needs is missing.
+ * The grid size, goal and stationary obstacles are only needed when full is true.
+ */
+void check_grid_update(const grid_view_t& update, bool full);
+
+// Throws grid_parse_exception if an obstacle's radius is negative or above max_radius.
+// Every radius gets its own inflation stamp, so it has to be bounded before one is made.
+void check_obstacle_radii(obstacle_span_t obstacles, int max_radius);
+
+#endif /* GRID_UPDATE_H */
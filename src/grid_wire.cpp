@@ -0,0 +1,223 @@
+///////////////////////////////////////////////////////////////////////////////
+// grid_wire.cpp - Binary encoding of /api/grid - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "grid_wire.hpp"
+
+#include <zlib.h>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <cstring>
+
+#define GRID_WIRE_HEADER_SIZE 52
+// Deflate packs at most about 1032 bytes into one, anything claiming more is not a real stream
+#define GRID_WIRE_MAX_DEFLATE_RATIO 1032
+// Largest inflated obstacle array accepted, 256MB is over 13 million obstacles
+#define GRID_WIRE_MAX_RAW_SIZE (256u << 20)
+
+static_assert(sizeof(obstacle_t) == 5 * sizeof(int32_t), "obstacle_t must match the packed wire layout");
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define GRID_WIRE_NATIVE_LAYOUT 1
+#else
+#define GRID_WIRE_NATIVE_LAYOUT 0
+#endif
+
+static void put_u32(std::vector<uint8_t>& out, uint32_t value)
+{
+    out.push_back(value & 0xff);
+    out.push_back((value >> 8) & 0xff);
+    out.push_back((value >> 16) & 0xff);
+    out.push_back((value >> 24) & 0xff);
+}
+
+static void put_u16(std::vector<uint8_t>& out, uint16_t value)
+{
+    out.push_back(value & 0xff);
+    out.push_back((value >> 8) & 0xff);
+}
+
+static uint32_t get_u32(const uint8_t* data)
+{
+    return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static uint16_t get_u16(const uint8_t* data)
+{
+    return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+/*
+ * Appends the obstacles as packed little endian int32s
+ */
+static void put_obstacles(std::vector<uint8_t>& out, obstacle_span_t obstacles)
+{
+    for(const obstacle_t& obs : obstacles) {
+        put_u32(out, obs.x);
+        put_u32(out, obs.y);
+        put_u32(out, obs.radius);
+        put_u32(out, obs.heading);
+        put_u32(out, obs.velocity);
+    }
+}
+
+/*
+ * Reads count packed obstacles into obstacles, which must have room for them
+ */
+static void get_obstacles(const uint8_t* data, size_t count, obstacle_t* obstacles)
+{
+#if GRID_WIRE_NATIVE_LAYOUT
+    memcpy(obstacles, data, count * sizeof(obstacle_t));
+#else
+    for(size_t i = 0; i < count; i++, data += sizeof(obstacle_t)) {
+        obstacles[i].x = (int32_t)get_u32(data);
+        obstacles[i].y = (int32_t)get_u32(data + 4);
+        obstacles[i].radius = (int32_t)get_u32(data + 8);
+        obstacles[i].heading = (int32_t)get_u32(data + 12);
+        obstacles[i].velocity = (int32_t)get_u32(data + 16);
+    }
+#endif
+}
+
+bool is_grid_wire_content_type(const std::string& content_type)
+{
+    return boost::algorithm::istarts_with(content_type, GRID_WIRE_CONTENT_TYPE);
+}
+
+void encode_grid_wire(const grid_view_t& grid, bool compress, std::vector<uint8_t>& out)
+{
+    std::vector<uint8_t> payload;
+    payload.reserve((grid.stationary_obstacles.size() + grid.moving_obstacles.size()) * sizeof(obstacle_t));
+    put_obstacles(payload, grid.stationary_obstacles);
+    put_obstacles(payload, grid.moving_obstacles);
+
+    uint16_t flags = grid.is_changed ? GRID_WIRE_FLAG_IS_CHANGED : 0;
+    if(compress) {
+        uLongf packed_size = compressBound(payload.size());
+        std::vector<uint8_t> packed(packed_size);
+        if(compress2(packed.data(), &packed_size, payload.data(), payload.size(), Z_BEST_SPEED) != Z_OK) {
+            throw std::runtime_error("Failed to deflate the grid");
+        }
+        packed.resize(packed_size);
+        payload.swap(packed);
+        flags |= GRID_WIRE_FLAG_DEFLATE;
+    }
+
+    out.clear();
+    out.reserve(GRID_WIRE_HEADER_SIZE + payload.size());
+    put_u32(out, GRID_WIRE_MAGIC);
+    put_u16(out, GRID_WIRE_VERSION);
+    put_u16(out, flags);
+    put_u32(out, grid.width);
+    put_u32(out, grid.height);
+    put_u32(out, grid.location_x);
+    put_u32(out, grid.location_y);
+    put_u32(out, grid.location_theta);
+    put_u32(out, grid.goal_x);
+    put_u32(out, grid.goal_y);
+    put_u32(out, grid.goal_theta);
+    put_u32(out, grid.stationary_obstacles.size());
+    put_u32(out, grid.moving_obstacles.size());
+    put_u32(out, payload.size());
+    out.insert(out.end(), payload.begin(), payload.end());
+}
+
+grid_view_t decode_grid_wire(const uint8_t* data, size_t size, std::vector<obstacle_t>& scratch)
+{
+    if(size < GRID_WIRE_HEADER_SIZE || get_u32(data) != GRID_WIRE_MAGIC) {
+        throw grid_parse_exception("Bad binary grid: no header");
+    }
+    if(get_u16(data + 4) != GRID_WIRE_VERSION) {
+        throw grid_parse_exception("Bad binary grid: unknown version");
+    }
+
+    grid_wire_header_t header;
+    header.flags = get_u16(data + 6);
+    header.width = (int32_t)get_u32(data + 8);
+    header.height = (int32_t)get_u32(data + 12);
+    header.location_x = (int32_t)get_u32(data + 16);
+    header.location_y = (int32_t)get_u32(data + 20);
+    header.location_theta = (int32_t)get_u32(data + 24);
+    header.goal_x = (int32_t)get_u32(data + 28);
+    header.goal_y = (int32_t)get_u32(data + 32);
+    header.goal_theta = (int32_t)get_u32(data + 36);
+    header.stationary_count = get_u32(data + 40);
+    header.moving_count = get_u32(data + 44);
+    header.payload_size = get_u32(data + 48);
+
+    const uint8_t* payload = data + GRID_WIRE_HEADER_SIZE;
+    if(header.payload_size > size - GRID_WIRE_HEADER_SIZE) {
+        throw grid_parse_exception("Bad binary grid: truncated");
+    }
+
+    size_t count = (size_t)header.stationary_count + header.moving_count;
+    size_t raw_size = count * sizeof(obstacle_t);
+    if(raw_size / sizeof(obstacle_t) != count) {
+        throw grid_parse_exception("Bad binary grid: too many obstacles");
+    }
+    const obstacle_t* obstacles = NULL;
+    if(header.flags & GRID_WIRE_FLAG_DEFLATE) {
+        //Checked before the counts size anything, a bad header must not get to allocate
+        if(raw_size > GRID_WIRE_MAX_RAW_SIZE ||
+                raw_size > (uint64_t)header.payload_size * GRID_WIRE_MAX_DEFLATE_RATIO) {
+            throw grid_parse_exception("Bad binary grid: obstacle counts too large for the payload");
+        }
+        scratch.resize(count);
+        uLongf unpacked_size = raw_size;
+        if(uncompress((Bytef*)scratch.data(), &unpacked_size, payload, header.payload_size) != Z_OK ||
+                unpacked_size != raw_size) {
+            throw grid_parse_exception("Bad binary grid: failed to inflate the obstacles");
+        }
+#if !GRID_WIRE_NATIVE_LAYOUT
+        std::vector<obstacle_t> packed(scratch);
+        get_obstacles((const uint8_t*)packed.data(), count, scratch.data());
+#endif
+        obstacles = scratch.data();
+    } else {
+        if(header.payload_size != raw_size) {
+            throw grid_parse_exception("Bad binary grid: obstacle count does not match the payload");
+        }
+        if(GRID_WIRE_NATIVE_LAYOUT && ((uintptr_t)payload % alignof(obstacle_t)) == 0) {
+            //Zero copy, the packed layout is obstacle_t's
+            obstacles = (const obstacle_t*)payload;
+        } else {
+            scratch.resize(count);
+            get_obstacles(payload, count, scratch.data());
+            obstacles = scratch.data();
+        }
+    }
+
+    grid_view_t view;
+    view.present = GRID_FIELD_IS_CHANGED | GRID_FIELD_WIDTH | GRID_FIELD_HEIGHT |
+                   GRID_FIELD_LOCATION | GRID_FIELD_LOCATION_X | GRID_FIELD_LOCATION_Y | GRID_FIELD_LOCATION_THETA |
+                   GRID_FIELD_GOAL | GRID_FIELD_GOAL_X | GRID_FIELD_GOAL_Y | GRID_FIELD_GOAL_THETA |
+                   GRID_FIELD_OBSTACLES | GRID_FIELD_STATIONARY | GRID_FIELD_MOVING;
+    view.is_changed = (header.flags & GRID_WIRE_FLAG_IS_CHANGED) != 0;
+    view.width = header.width;
+    view.height = header.height;
+    view.location_x = header.location_x;
+    view.location_y = header.location_y;
+    view.location_theta = header.location_theta;
+    view.goal_x = header.goal_x;
+    view.goal_y = header.goal_y;
+    view.goal_theta = header.goal_theta;
+    view.stationary_obstacles = obstacle_span_t(obstacles, header.stationary_count);
+    view.moving_obstacles = obstacle_span_t(obstacles + header.stationary_count, header.moving_count);
+    return view;
+}
@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// grid_wire.h - Binary encoding of /api/grid - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef GRID_WIRE_H
+#define GRID_WIRE_H
+
+#include "grid_update.hpp"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Content type of the binary grid. We ask for it in Accept, the server may still answer json.
+#define GRID_WIRE_CONTENT_TYPE "application/vnd.drops.grid"
+
+// Websocket path the server pushes grids on, a binary message per grid
+#define GRID_STREAM_PATH "/api/grid/stream"
+
+#define GRID_WIRE_MAGIC 0x47505244 // "DRPG" read as a little endian uint32
+#define GRID_WIRE_VERSION 1
+
+// grid_wire_header_t::flags
+#define GRID_WIRE_FLAG_IS_CHANGED 1
+#define GRID_WIRE_FLAG_DEFLATE 2 // The obstacle arrays are zlib deflate compressed
+
+/*
+ * Fixed size header, all little endian. It is followed by payload_size bytes
+ * holding stationary_count then moving_count obstacles, each packed as five
+ * int32 (x, y, radius, heading, velocity), the same layout as obstacle_t.
+ */
+struct grid_wire_header_t {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t flags;
+    int32_t width;
+    int32_t height;
+    int32_t location_x;
+    int32_t location_y;
+    int32_t location_theta;
+    int32_t goal_x;
+    int32_t goal_y;
+    int32_t goal_theta;
+    uint32_t stationary_count;
+    uint32_t moving_count;
+    uint32_t payload_size; // Bytes after the header, compressed size if deflated
+};
+
+// True if a response with this content type holds a binary grid
+bool is_grid_wire_content_type(const std::string& content_type);
+
+/*
+ * Encodes a grid into out. With compress the obstacle arrays are deflated.
+ */
+void encode_grid_wire(const grid_view_t& grid, bool compress, std::vector<uint8_t>& out);
+
+/*
+ * Decodes a binary grid. The obstacles of the returned view point straight
+ * into data when it is not compressed (on little endian hosts), else into
+ * scratch. Either buffer must outlive the view.
+ * Throws grid_parse_exception if the buffer is not a valid binary grid, or
+ * its compressed obstacle counts are more than the payload could inflate to.
+ */
+grid_view_t decode_grid_wire(const uint8_t* data, size_t size, std::vector<obstacle_t>& scratch);
+
+#endif /* GRID_WIRE_H */
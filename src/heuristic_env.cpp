@@ -0,0 +1,132 @@
+///////////////////////////////////////////////////////////////////////////////
+// heuristic_env.cpp - Lattice environment with a kept heuristic - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "heuristic_env.hpp"
+#include "metrics.hpp"
+
+#include <algorithm>
+
+cached_heuristic_environment::cached_heuristic_environment() :
+    m_expansions(0),
+    m_rebuilt(false)
+{
+
+}
+
+/*
+ * A new grid, the fields are built again on the next search
+ */
+bool cached_heuristic_environment::InitializeEnv(int width, int height, const unsigned char* mapdata,
+        double startx, double starty, double starttheta,
+        double goalx, double goaly, double goaltheta,
+        double goaltol_x, double goaltol_y, double goaltol_theta,
+        const std::vector<sbpl_2Dpt_t>& perimeterptsV, double cellsize_m,
+        double nominalvel_mpersecs, double timetoturn45degs_inplace,
+        unsigned char obsthresh, const char* sMotPrimFile)
+{
+    m_from_goal.clear();
+    m_from_start.clear();
+    return mprim_cache_environment::InitializeEnv(width, height, mapdata, startx, starty, starttheta,
+            goalx, goaly, goaltheta, goaltol_x, goaltol_y, goaltol_theta,
+            perimeterptsV, cellsize_m, nominalvel_mpersecs, timetoturn45degs_inplace,
+            obsthresh, sMotPrimFile);
+}
+
+bool cached_heuristic_environment::UpdateCost(int x, int y, unsigned char newcost)
+{
+    if(IsWithinMapCell(x, y) && GetMapCost(x, y) != newcost) {
+        m_from_goal.mark_dirty(x, y);
+        m_from_start.mark_dirty(x, y);
+    }
+    return mprim_cache_environment::UpdateCost(x, y, newcost);
+}
+
+unsigned char* const* cached_heuristic_environment::grid_columns()
+{
+    return EnvNAVXYTHETALATCfg.Grid2D;
+}
+
+/*
+ * Called by the planners at the start of every search, with true when they
+ * need the cost to the goal. The flags SBPL keeps are not used.
+ */
+void cached_heuristic_environment::EnsureHeuristicsUpdated(bool bGoalHeuristics)
+{
+    metric_timer timer(METRIC_HEURISTIC);
+    const EnvNAVXYTHETALATConfig_t &cfg = EnvNAVXYTHETALATCfg;
+    if(bGoalHeuristics) {
+        update_field(m_from_goal, cfg.EndX_c, cfg.EndY_c, cfg.StartX_c, cfg.StartY_c);
+    } else {
+        update_field(m_from_start, cfg.StartX_c, cfg.StartY_c, cfg.EndX_c, cfg.EndY_c);
+    }
+}
+
+int cached_heuristic_environment::GetGoalHeuristic(int stateID)
+{
+    return heuristic(m_from_goal, stateID, EnvNAVXYTHETALATCfg.EndX_c, EnvNAVXYTHETALATCfg.EndY_c);
+}
+
+int cached_heuristic_environment::GetStartHeuristic(int stateID)
+{
+    return heuristic(m_from_start, stateID, EnvNAVXYTHETALATCfg.StartX_c, EnvNAVXYTHETALATCfg.StartY_c);
+}
+
+void cached_heuristic_environment::set_heuristic_pool(thread_pool* pool)
+{
+    m_from_goal.set_pool(pool);
+    m_from_start.set_pool(pool);
+}
+
+uint64_t cached_heuristic_environment::heuristic_expansions() const
+{
+    return m_expansions;
+}
+
+bool cached_heuristic_environment::heuristic_rebuilt() const
+{
+    return m_rebuilt;
+}
+
+void cached_heuristic_environment::update_field(heuristic_field& field, int source_x, int source_y,
+        int target_x, int target_y)
+{
+    const EnvNAVXYTHETALATConfig_t &cfg = EnvNAVXYTHETALATCfg;
+    if(!field.valid() || field.source_x() != source_x || field.source_y() != source_y) {
+        field.build(cfg.Grid2D, cfg.EnvWidth_c, cfg.EnvHeight_c, cfg.cost_inscribed_thresh, cfg.cellsize_m,
+                    source_x, source_y);
+    }
+    field.compute(target_x, target_y);
+    m_expansions = field.expansions();
+    m_rebuilt = field.rebuilt();
+}
+
+/*
+ * The same as SBPL's: the larger of the 2D cost and the straight line, in the
+ * time it takes at the nominal velocity
+ */
+int cached_heuristic_environment::heuristic(const heuristic_field& field, int stateID, int to_x, int to_y)
+{
+    if(!field.valid()) {
+        return 0;
+    }
+    EnvNAVXYTHETALATHashEntry_t* entry = StateID2CoordTable[stateID];
+    int h2D = field.distance(entry->X, entry->Y);
+    int hEuclid = (int)(NAVXYTHETALAT_COSTMULT_MTOMM * EuclideanDistance_m(entry->X, entry->Y, to_x, to_y));
+    return (int)(((double)std::max(h2D, hEuclid)) / EnvNAVXYTHETALATCfg.nominalvel_mpersecs);
+}
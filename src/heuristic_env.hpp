@@ -0,0 +1,76 @@
+///////////////////////////////////////////////////////////////////////////////
+// heuristic_env.h - Lattice environment with a kept heuristic - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef HEURISTIC_ENV_H
+#define HEURISTIC_ENV_H
+
+#include "heuristic_field.hpp"
+#include "mprim_cache.hpp"
+
+/*
+ * The lattice environment with its 2D heuristics kept between searches.
+ *
+ * SBPL drops both heuristics on every UpdateCost() and searches the 2D grid
+ * again on the next replan. Here the cost to go from the goal (forward
+ * searches) and from the start (backward searches) are heuristic_fields
+ * keyed by the cell they start from. Changed cells are repaired in place, and
+ * a field only starts over when its cell moves or the environment is
+ * initialized again. Moving obstacles with a fixed goal cost a repair instead
+ * of a full 2D search per replan.
+ */
+class cached_heuristic_environment : public mprim_cache_environment {
+public:
+    cached_heuristic_environment();
+
+    bool InitializeEnv(int width, int height, const unsigned char* mapdata,
+                       double startx, double starty, double starttheta,
+                       double goalx, double goaly, double goaltheta,
+                       double goaltol_x, double goaltol_y, double goaltol_theta,
+                       const std::vector<sbpl_2Dpt_t>& perimeterptsV, double cellsize_m,
+                       double nominalvel_mpersecs, double timetoturn45degs_inplace,
+                       unsigned char obsthresh, const char* sMotPrimFile);
+    // SBPL's UpdateCost, also queues the cell for the heuristics
+    bool UpdateCost(int x, int y, unsigned char newcost);
+
+    virtual void EnsureHeuristicsUpdated(bool bGoalHeuristics);
+    virtual int GetGoalHeuristic(int stateID);
+    virtual int GetStartHeuristic(int stateID);
+
+    // SBPL's grid, columns[x][y]. Writes through it skip UpdateCost(), so they
+    // are only for filling the grid between InitializeEnv() and the first search.
+    unsigned char* const* grid_columns();
+
+    // Fresh builds of both fields expand large buckets on pool, see heuristic_field
+    void set_heuristic_pool(thread_pool* pool);
+
+    // Cells the heuristic expanded in the last EnsureHeuristicsUpdated(), and if it started over
+    uint64_t heuristic_expansions() const;
+    bool heuristic_rebuilt() const;
+
+private:
+    void update_field(heuristic_field& field, int source_x, int source_y, int target_x, int target_y);
+    int heuristic(const heuristic_field& field, int stateID, int to_x, int to_y);
+
+    heuristic_field m_from_goal;
+    heuristic_field m_from_start;
+    uint64_t m_expansions;
+    bool m_rebuilt;
+};
+
+#endif /* HEURISTIC_ENV_H */
@@ -0,0 +1,384 @@
+///////////////////////////////////////////////////////////////////////////////
+// heuristic_field.cpp - Incremental 2D cost to go - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "heuristic_field.hpp"
+
+#include <cmath>
+
+static const int NEIGHBOUR_DX[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+static const int NEIGHBOUR_DY[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+
+heuristic_field::heuristic_field() :
+    m_grid(NULL),
+    m_width(0),
+    m_height(0),
+    m_obs_thresh(0),
+    m_straight_mm(0),
+    m_diagonal_mm(0),
+    m_source(-1),
+    m_frontier(HEURISTIC_INFINITE),
+    m_restart(false),
+    m_pool(NULL),
+    m_expansions(0),
+    m_rebuilt(false)
+{
+
+}
+
+void heuristic_field::build(const unsigned char* const* grid, int width, int height, unsigned char obs_thresh,
+                            double cellsize_m, int source_x, int source_y)
+{
+    m_grid = grid;
+    m_width = width;
+    m_height = height;
+    m_obs_thresh = obs_thresh;
+    m_straight_mm = (int)(cellsize_m * 1000);
+    m_diagonal_mm = (int)(cellsize_m * 1000 * std::sqrt(2.0));
+    m_source = (source_x >= 0 && source_y >= 0 && source_x < width && source_y < height) ?
+               source_x * height + source_y : -1;
+    m_restart = true;
+}
+
+void heuristic_field::clear()
+{
+    m_grid = NULL;
+    m_source = -1;
+    m_g = std::vector<int>();
+    m_open = std::priority_queue<open_t, std::vector<open_t>, std::greater<open_t> >();
+    m_dirty.clear();
+    m_frontier = HEURISTIC_INFINITE;
+}
+
+void heuristic_field::set_pool(thread_pool* pool)
+{
+    m_pool = pool;
+}
+
+void heuristic_field::mark_dirty(int x, int y)
+{
+    if(m_restart || x < 0 || y < 0 || x >= m_width || y >= m_height) {
+        return;
+    }
+    m_dirty.push_back(x * m_height + y);
+    if(m_dirty.size() > (size_t)m_width * m_height / HEURISTIC_REBUILD_FRACTION) {
+        //Repairing would visit most of the field anyway
+        m_dirty.clear();
+        m_restart = true;
+    }
+}
+
+/*
+ * Plain Dijkstra from whatever restart() or repair() left in the open list.
+ * Entries whose g went down since they were pushed have a newer entry and
+ * are skipped.
+ */
+void heuristic_field::compute(int target_x, int target_y)
+{
+    m_expansions = 0;
+    m_rebuilt = m_restart;
+    if(m_grid == NULL) {
+        return;
+    }
+    bool has_target = target_x >= 0 && target_y >= 0 && target_x < m_width && target_y < m_height;
+    int target = has_target ? target_x * m_height + target_y : -1;
+    if(m_restart) {
+        restart();
+        wavefront(target);
+    } else if(!m_dirty.empty()) {
+        repair();
+    }
+
+    while(!m_open.empty()) {
+        open_t top = m_open.top();
+        int cell = top.second;
+        if(top.first != m_g[cell]) {
+            m_open.pop();
+            continue;
+        }
+        if(target >= 0 && m_g[target] <= top.first &&
+                (int64_t)top.first > (int64_t)HEURISTIC_SEARCH_FACTOR * m_g[target]) {
+            break;
+        }
+        m_open.pop();
+        m_expansions++;
+
+        int x = cell / m_height;
+        int y = cell % m_height;
+        for(int i = 0; i < 8; i++) {
+            int nx = x + NEIGHBOUR_DX[i];
+            int ny = y + NEIGHBOUR_DY[i];
+            if(nx < 0 || ny < 0 || nx >= m_width || ny >= m_height) {
+                continue;
+            }
+            int cost = step_cost(x, y, nx, ny);
+            if(cost >= HEURISTIC_INFINITE) {
+                continue;
+            }
+            int next = nx * m_height + ny;
+            int g = (int)std::min((int64_t)top.first + cost, (int64_t)HEURISTIC_INFINITE - 1);
+            if(g < m_g[next]) {
+                push(next, g);
+            }
+        }
+    }
+    m_frontier = m_open.empty() ? HEURISTIC_INFINITE : m_open.top().first;
+}
+
+bool heuristic_field::valid() const
+{
+    return m_grid != NULL;
+}
+
+int heuristic_field::source_x() const
+{
+    return m_source < 0 ? -1 : m_source / m_height;
+}
+
+int heuristic_field::source_y() const
+{
+    return m_source < 0 ? -1 : m_source % m_height;
+}
+
+uint64_t heuristic_field::expansions() const
+{
+    return m_expansions;
+}
+
+bool heuristic_field::rebuilt() const
+{
+    return m_rebuilt;
+}
+
+/*
+ * Mirrors SBPL2DGridSearch, so the heuristic is the same as SBPL's own
+ */
+int heuristic_field::step_cost(int x, int y, int nx, int ny) const
+{
+    int cost = std::max(m_grid[x][y], m_grid[nx][ny]);
+    bool diagonal = x != nx && y != ny;
+    if(diagonal) {
+        cost = std::max(cost, (int)std::max(m_grid[x][ny], m_grid[nx][y]));
+    }
+    if(cost >= m_obs_thresh) {
+        return HEURISTIC_INFINITE;
+    }
+    return (cost + 1) * (diagonal ? m_diagonal_mm : m_straight_mm);
+}
+
+void heuristic_field::restart()
+{
+    m_g.assign((size_t)m_width * m_height, HEURISTIC_INFINITE);
+    m_open = std::priority_queue<open_t, std::vector<open_t>, std::greater<open_t> >();
+    m_dirty.clear();
+    m_restart = false;
+}
+
+/*
+ * Dial's algorithm over a ring of buckets m_straight_mm wide, long enough for
+ * the costliest step. Cells expanded together only read m_g, what they improve
+ * is collected per task and applied in task order afterwards, so the result
+ * does not depend on the threads. Stops a whole bucket at a time, with the
+ * same rule as compute().
+ */
+void heuristic_field::wavefront(int target)
+{
+    if(m_source < 0) {
+        return;
+    }
+    const int bucket_mm = std::max(m_straight_mm, 1);
+    const size_t ring = (size_t)m_obs_thresh * m_diagonal_mm / bucket_mm + 2;
+    m_buckets.resize(ring);
+    size_t queued = 0;
+    //Cells already in the bucket of their new g are not queued again
+    auto improve = [&](int cell, int g) {
+        if(g >= m_g[cell]) {
+            return;
+        }
+        bool in_bucket = m_g[cell] < HEURISTIC_INFINITE && m_g[cell] / bucket_mm == g / bucket_mm;
+        m_g[cell] = g;
+        if(!in_bucket) {
+            m_buckets[(size_t)(g / bucket_mm) % ring].push_back(cell);
+            queued++;
+        }
+    };
+    auto relax = [&](int cell, std::vector<open_t>& relaxed) {
+        int x = cell / m_height;
+        int y = cell % m_height;
+        for(int i = 0; i < 8; i++) {
+            int nx = x + NEIGHBOUR_DX[i];
+            int ny = y + NEIGHBOUR_DY[i];
+            if(nx < 0 || ny < 0 || nx >= m_width || ny >= m_height) {
+                continue;
+            }
+            int cost = step_cost(x, y, nx, ny);
+            if(cost >= HEURISTIC_INFINITE) {
+                continue;
+            }
+            int next = nx * m_height + ny;
+            int g = (int)std::min((int64_t)m_g[cell] + cost, (int64_t)HEURISTIC_INFINITE - 1);
+            if(g < m_g[next]) {
+                relaxed.push_back(open_t(g, next));
+            }
+        }
+    };
+
+    improve(m_source, 0);
+    for(int64_t b = 0; queued > 0; b++) {
+        std::vector<int>& bucket = m_buckets[(size_t)b % ring];
+        if(bucket.empty()) {
+            continue;
+        }
+        if(target >= 0 && m_g[target] < HEURISTIC_INFINITE &&
+                b * bucket_mm > (int64_t)HEURISTIC_SEARCH_FACTOR * m_g[target]) {
+            break;
+        }
+        queued -= bucket.size();
+        //Cells that moved to an earlier bucket since were expanded there
+        bucket.erase(std::remove_if(bucket.begin(), bucket.end(), [&](int cell) {
+            return m_g[cell] / bucket_mm != b;
+        }), bucket.end());
+        m_expansions += bucket.size();
+
+        bool parallel = m_pool != NULL && m_pool->size() > 1 && bucket.size() >= HEURISTIC_PARALLEL_MIN_CELLS;
+        size_t tasks = parallel ? m_pool->size() * 4 : 1;
+        m_relaxed.resize(std::max(m_relaxed.size(), tasks));
+        auto expand = [&](size_t task) {
+            std::vector<open_t>& relaxed = m_relaxed[task];
+            relaxed.clear();
+            for(size_t i = bucket.size() * task / tasks; i < bucket.size() * (task + 1) / tasks; i++) {
+                relax(bucket[i], relaxed);
+            }
+        };
+        if(parallel) {
+            m_pool->parallel_for(tasks, expand);
+        } else {
+            expand(0);
+        }
+        for(size_t task = 0; task < tasks; task++) {
+            for(const open_t& entry : m_relaxed[task]) {
+                improve(entry.second, entry.first);
+            }
+        }
+        bucket.clear();
+    }
+
+    //What is left goes to the heap, for compute() and later calls to carry on from
+    for(size_t i = 0; i < ring; i++) {
+        for(int cell : m_buckets[i]) {
+            if((size_t)(m_g[cell] / bucket_mm) % ring == i) {
+                m_open.push(open_t(m_g[cell], cell));
+            }
+        }
+        m_buckets[i].clear();
+    }
+}
+
+/*
+ * A changed cell changes the steps between any two cells of the 3 x 3 block
+ * around it, through the diagonals cutting its corners. Those cells are
+ * checked first: a distance that no longer equals a neighbour's plus the step
+ * from it is raised to infinite, and its neighbours are checked in turn. Then
+ * the raised cells take the best their neighbours offer, and every cell that
+ * may now offer its neighbours less goes back in the open list.
+ */
+void heuristic_field::repair()
+{
+    std::vector<int> affected;
+    affected.reserve(m_dirty.size() * 9);
+    for(int cell : m_dirty) {
+        int x = cell / m_height;
+        int y = cell % m_height;
+        for(int nx = std::max(x - 1, 0); nx <= std::min(x + 1, m_width - 1); nx++) {
+            for(int ny = std::max(y - 1, 0); ny <= std::min(y + 1, m_height - 1); ny++) {
+                affected.push_back(nx * m_height + ny);
+            }
+        }
+    }
+    m_dirty.clear();
+    std::sort(affected.begin(), affected.end());
+    affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+
+    std::vector<int> check(affected);
+    std::vector<int> raised;
+    while(!check.empty()) {
+        int cell = check.back();
+        check.pop_back();
+        if(cell == m_source || m_g[cell] >= HEURISTIC_INFINITE || supported(cell)) {
+            continue;
+        }
+        m_g[cell] = HEURISTIC_INFINITE;
+        raised.push_back(cell);
+        int x = cell / m_height;
+        int y = cell % m_height;
+        for(int i = 0; i < 8; i++) {
+            int nx = x + NEIGHBOUR_DX[i];
+            int ny = y + NEIGHBOUR_DY[i];
+            if(nx >= 0 && ny >= 0 && nx < m_width && ny < m_height && m_g[nx * m_height + ny] < HEURISTIC_INFINITE) {
+                check.push_back(nx * m_height + ny);
+            }
+        }
+    }
+
+    for(int cell : raised) {
+        int g = best_from_neighbours(cell);
+        if(g < m_g[cell]) {
+            push(cell, g);
+        }
+    }
+    for(int cell : affected) {
+        if(m_g[cell] < HEURISTIC_INFINITE) {
+            m_open.push(open_t(m_g[cell], cell));
+        }
+    }
+}
+
+void heuristic_field::push(int cell, int g)
+{
+    m_g[cell] = g;
+    m_open.push(open_t(g, cell));
+}
+
+/*
+ * Whether a neighbour still gets the cell its distance, or less, in which case
+ * Dijkstra lowers it. Steps cost more than 0, so support leads back to the source.
+ */
+bool heuristic_field::supported(int cell) const
+{
+    return best_from_neighbours(cell) <= m_g[cell];
+}
+
+int heuristic_field::best_from_neighbours(int cell) const
+{
+    int x = cell / m_height;
+    int y = cell % m_height;
+    int64_t best = HEURISTIC_INFINITE;
+    for(int i = 0; i < 8; i++) {
+        int nx = x + NEIGHBOUR_DX[i];
+        int ny = y + NEIGHBOUR_DY[i];
+        if(nx < 0 || ny < 0 || nx >= m_width || ny >= m_height) {
+            continue;
+        }
+        int g = m_g[nx * m_height + ny];
+        int cost = step_cost(x, y, nx, ny);
+        if(g < HEURISTIC_INFINITE && cost < HEURISTIC_INFINITE) {
+            best = std::min(best, std::min((int64_t)g + cost, (int64_t)HEURISTIC_INFINITE - 1));
+        }
+    }
+    return (int)best;
+}
@@ -0,0 +1,124 @@
+///////////////////////////////////////////////////////////////////////////////
+// heuristic_field.h - Incremental 2D cost to go - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef HEURISTIC_FIELD_H
+#define HEURISTIC_FIELD_H
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+// Distance of unreached cells, SBPL's INFINITECOST
+#define HEURISTIC_INFINITE 1000000000
+// Cells are settled until the target is and the search is this many times its cost past it, like SBPL's
+// SBPL_2DGRIDSEARCH_TERM_CONDITION_TWOTIMESOPTPATH
+#define HEURISTIC_SEARCH_FACTOR 2
+// Above one dirty cell in this many the field starts over instead of repairing
+#define HEURISTIC_REBUILD_FRACTION 16
+// Buckets of a fresh build with fewer cells than this are expanded on the calling thread
+#define HEURISTIC_PARALLEL_MIN_CELLS 1024
+
+/*
+ * Costs of the 8 connected 2D paths from a source cell, the way SBPL's
+ * SBPL2DGridSearch counts them: (worst cell cost + 1) * length in mm, with
+ * the two cells a diagonal step cuts through counted, and cells at or above
+ * obs_thresh blocked. SBPL turns this into the heuristic of its lattice search.
+ *
+ * SBPL searches the whole 2D grid again whenever one cell changes. This field
+ * keeps its distances between searches instead. Cells that changed since the
+ * last compute() are repaired: distances that no longer follow from a
+ * neighbour are dropped along with everything derived from them, then given
+ * the best value their neighbours offer, and Dijkstra runs from there. Only
+ * the part of the field behind the changed cells is visited.
+ *
+ * Like SBPL the search stops once the target is settled and the frontier is
+ * HEURISTIC_SEARCH_FACTOR times its distance away. Cells past the frontier get
+ * the frontier as their lower bound, and a later compute() with a target
+ * further out carries on from there.
+ *
+ * A fresh build, the source moved or the map is new, runs as a wavefront over
+ * buckets one straight step wide instead of the binary heap. No step is
+ * shorter than a bucket, so every cell of a bucket is final when the bucket
+ * comes up and its cells can be expanded at the same time, on the pool if one
+ * is set. Backward searches root the field at the vehicle, so that is every tick.
+ */
+class heuristic_field {
+public:
+    heuristic_field();
+
+    // Starts over from source on an x major grid, grid[x][y]. The grid is read, not copied.
+    void build(const unsigned char* const* grid, int width, int height, unsigned char obs_thresh,
+               double cellsize_m, int source_x, int source_y);
+    // Drops everything, valid() is false until the next build()
+    void clear();
+    // Expands large buckets of fresh builds on pool, NULL (the default) for the calling thread only
+    void set_pool(thread_pool* pool);
+    // Queues a cell whose cost changed in the grid, repaired on the next compute()
+    void mark_dirty(int x, int y);
+    // Repairs the dirty cells and settles cells until target is settled, see above
+    void compute(int target_x, int target_y);
+
+    // Lower bound on the cost from the source to x, y in mm, exact up to the frontier
+    inline int distance(int x, int y) const {
+        return std::min(m_g[(size_t)x * m_height + y], m_frontier);
+    }
+    bool valid() const;
+    int source_x() const;
+    int source_y() const;
+    // Cells expanded by the last compute(), and whether it had to start over
+    uint64_t expansions() const;
+    bool rebuilt() const;
+
+private:
+    // Cost of the step between two neighbouring cells, HEURISTIC_INFINITE if blocked. Symmetric.
+    int step_cost(int x, int y, int nx, int ny) const;
+    void restart();
+    // The fresh build from restart(), leaves the cells it did not reach in m_open
+    void wavefront(int target);
+    void repair();
+    void push(int cell, int g);
+    bool supported(int cell) const;
+    int best_from_neighbours(int cell) const;
+
+    typedef std::pair<int, int> open_t; //g, cell
+    const unsigned char* const* m_grid;
+    int m_width;
+    int m_height;
+    unsigned char m_obs_thresh;
+    int m_straight_mm;
+    int m_diagonal_mm;
+    int m_source;
+    std::vector<int> m_g; //x * height + y
+    std::priority_queue<open_t, std::vector<open_t>, std::greater<open_t> > m_open;
+    int m_frontier;
+    std::vector<int> m_dirty;
+    bool m_restart; //Too many dirty cells, start over on the next compute()
+    thread_pool* m_pool;
+    std::vector<std::vector<int> > m_buckets; //Ring of cells by g / m_straight_mm, only used by wavefront()
+    std::vector<std::vector<open_t> > m_relaxed; //Per task of a parallel bucket, improved neighbours
+    uint64_t m_expansions;
+    bool m_rebuilt;
+};
+
+#endif /* HEURISTIC_FIELD_H */
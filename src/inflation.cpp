@@ -0,0 +1,121 @@
+///////////////////////////////////////////////////////////////////////////////
+// inflation.cpp - Obstacle inflation stamps - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "inflation.hpp"
+#include "hasher.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+unsigned char inflation_cost(int obs_radius, int dx, int dy, inflation_params_t inf_param)
+{
+    return inflation_cost_squared(obs_radius, (dx * dx) + (dy * dy), inf_param);
+}
+
+unsigned char inflation_cost_squared(int obs_radius, int dist_squared, inflation_params_t inf_param)
+{
+    if(dist_squared <= obs_radius * obs_radius) {
+        //point is within circle
+        return OBSTACLE_THRES;
+    } else if (dist_squared >  (obs_radius + inf_param.radius) * (obs_radius + inf_param.radius)) {
+        return 0;
+    } else {
+        //We need sqrt of the distance, so only compute it here.
+        double distance = std::sqrt(dist_squared);
+        double factor = exp(-1.0 * inf_param.weight * (distance - obs_radius));
+        return (unsigned char)((OBSTACLE_THRES - 1) * factor);
+    }
+}
+
+/*
+ * Evaluates inflation_cost for every cell of the obstacle's bounding box.
+ * Only one quadrant is computed, the other three are mirrored.
+ */
+std::shared_ptr<const inflation_stamp_t> make_inflation_stamp(int obs_radius, inflation_params_t inf_param)
+{
+    std::shared_ptr<inflation_stamp_t> stamp(new inflation_stamp_t());
+    stamp->half_size = std::max(obs_radius + inf_param.radius, 0);
+    stamp->size = 2 * stamp->half_size + 1;
+    stamp->cost.assign(stamp->size * stamp->size, 0);
+    stamp->row_begin.assign(stamp->size, stamp->half_size);
+    stamp->row_end.assign(stamp->size, stamp->half_size);
+
+    int half = stamp->half_size;
+    int size = stamp->size;
+    for(int dy = -half; dy <= 0; dy++) {
+        for(int dx = -half; dx <= 0; dx++) {
+            unsigned char cost = inflation_cost(obs_radius, dx, dy, inf_param);
+            stamp->cost[(half + dx) + (half + dy) * size] = cost;
+            stamp->cost[(half - dx) + (half + dy) * size] = cost;
+            stamp->cost[(half + dx) + (half - dy) * size] = cost;
+            stamp->cost[(half - dx) + (half - dy) * size] = cost;
+        }
+    }
+
+    //Find the non zero span of every row, so rasterizing can skip the corners
+    for(int row = 0; row < size; row++) {
+        const unsigned char* costs = &stamp->cost[row * size];
+        int begin = 0;
+        while(begin < size && costs[begin] == 0) {
+            begin++;
+        }
+        if(begin < size) {
+            stamp->row_begin[row] = begin;
+            stamp->row_end[row] = size - begin;
+        }
+    }
+    return stamp;
+}
+
+size_t inflation_stamp_cache::key_hasher::operator()(const key_t& key) const
+{
+    size_t seed = 0;
+    hash_combine(seed, key.obs_radius);
+    hash_combine(seed, key.inf_radius);
+    hash_combine(seed, key.weight);
+    return seed;
+}
+
+std::shared_ptr<const inflation_stamp_t> inflation_stamp_cache::get(int obs_radius, inflation_params_t inf_param)
+{
+    key_t key = {obs_radius, inf_param.radius, inf_param.weight};
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_stamps.find(key);
+    if(it != m_stamps.end()) {
+        return it->second;
+    }
+    std::shared_ptr<const inflation_stamp_t> stamp = make_inflation_stamp(obs_radius, inf_param);
+    if(m_stamps.size() >= INFLATION_STAMP_CACHE_MAX) {
+        m_stamps.clear();
+    }
+    m_stamps[key] = stamp;
+    return stamp;
+}
+
+void inflation_stamp_cache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stamps.clear();
+}
+
+size_t inflation_stamp_cache::size()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stamps.size();
+}
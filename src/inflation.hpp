@@ -0,0 +1,131 @@
+///////////////////////////////////////////////////////////////////////////////
+// inflation.h - Obstacle inflation stamps - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef INFLATION_H
+#define INFLATION_H
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// The threshold for obstacles in the cost map. 0-255
+#define OBSTACLE_THRES 255
+// Most stamps inflation_stamp_cache holds, it starts over when full
+#define INFLATION_STAMP_CACHE_MAX 256
+
+// How obstacles are inflated into the static grid
+enum inflation_mode_t {
+    INFLATION_STAMP, // Max blend one precomputed stamp per obstacle
+    INFLATION_DISTANCE_TRANSFORM // Euclidean distance transform over the whole grid
+};
+
+struct inflation_params_t {
+    int radius;
+    double weight;
+    inflation_mode_t mode;
+};
+
+//Obstacle as received from the server. Stationary obstacles have heading and velocity 0
+struct obstacle_t {
+    int x;
+    int y;
+    int radius;
+    int heading;
+    int velocity;
+};
+
+// Read only view of a contiguous array of obstacles, from a vector or a received buffer
+struct obstacle_span_t {
+    const obstacle_t* data;
+    size_t count;
+
+    obstacle_span_t(): data(NULL), count(0) {}
+    obstacle_span_t(const obstacle_t* obstacles, size_t size): data(obstacles), count(size) {}
+    obstacle_span_t(const std::vector<obstacle_t>& obstacles): data(obstacles.data()), count(obstacles.size()) {}
+
+    const obstacle_t* begin() const {
+        return data;
+    }
+    const obstacle_t* end() const {
+        return data + count;
+    }
+    size_t size() const {
+        return count;
+    }
+    const obstacle_t& operator[](size_t i) const {
+        return data[i];
+    }
+};
+
+// Cost of the cell (dx, dy) away from the center of an obstacle of radius obs_radius
+unsigned char inflation_cost(int obs_radius, int dx, int dy, inflation_params_t inf_param);
+// Same as inflation_cost, from the squared distance to the center
+unsigned char inflation_cost_squared(int obs_radius, int dist_squared, inflation_params_t inf_param);
+
+/*
+ * Precomputed costs of every cell around one obstacle.
+ * The stamp is size x size cells, centered on (half_size, half_size).
+ * Row dy only has non zero costs in [row_begin[dy], row_end[dy]).
+ */
+struct inflation_stamp_t {
+    int half_size;
+    int size;
+    std::vector<unsigned char> cost;
+    std::vector<int> row_begin;
+    std::vector<int> row_end;
+};
+
+// Builds the stamp for an obstacle of radius obs_radius
+std::shared_ptr<const inflation_stamp_t> make_inflation_stamp(int obs_radius, inflation_params_t inf_param);
+
+/*
+ * Cache of stamps keyed by (obstacle radius, inflation radius, weight).
+ * Stamps are built the first time they are asked for and then shared
+ * between obstacles and updates. Safe to use from several threads.
+ * Holds at most INFLATION_STAMP_CACHE_MAX stamps. Stamps already handed out
+ * stay valid when it starts over.
+ */
+class inflation_stamp_cache {
+public:
+    // Returns the stamp for these parameters, building it if needed
+    std::shared_ptr<const inflation_stamp_t> get(int obs_radius, inflation_params_t inf_param);
+    // Drops every cached stamp
+    void clear();
+    // Number of stamps in the cache
+    size_t size();
+
+private:
+    struct key_t {
+        int obs_radius;
+        int inf_radius;
+        double weight;
+        bool operator==(const key_t& other) const {
+            return obs_radius == other.obs_radius && inf_radius == other.inf_radius && weight == other.weight;
+        }
+    };
+    struct key_hasher {
+        size_t operator()(const key_t& key) const;
+    };
+
+    std::mutex m_mutex;
+    std::unordered_map<key_t, std::shared_ptr<const inflation_stamp_t>, key_hasher> m_stamps;
+};
+
+#endif /* INFLATION_H */
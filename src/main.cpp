@@ -19,12 +19,24 @@
 
 #include "main.hpp"
 #include "communication.hpp"
+#include "metrics.hpp"
 #include "plan.hpp"
+#include "portfolio.hpp"
 #include "util.hpp"
 
 #include <signal.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 
 #include <boost/asio.hpp>
 
@@ -37,8 +49,14 @@ using namespace web;
 using namespace web::http;
 using namespace web::http::client;
 
-void print_env(env_data_t my_env_data, point_char_map moving_obs, std::vector<sbpl_xy_theta_pt_t> path)
+void print_env(env_data_t my_env_data, cell_update_list moving_obs, std::vector<sbpl_xy_theta_pt_t> path)
 {
+    //Dense overlay of the moving obstacle cells, -1 where there is no update
+    std::vector<int> moving_overlay(my_env_data.height * my_env_data.width, -1);
+    for (auto cell : moving_obs) {
+        moving_overlay[cell.x + cell.y * my_env_data.width] = cell.cost;
+    }
+
     std::cout << "Grid"  << std::endl << std::endl;
     point_char_map path_points = point_char_map();
     for (unsigned int i = 0; i < path.size(); i++) {
@@ -79,8 +97,8 @@ void print_env(env_data_t my_env_data, point_char_map moving_obs, std::vector<sb
                     std::cout << "/";
                     break;
                 }
-            } else if (moving_obs.count(point) == 1) {
-                unsigned char obs_val = moving_obs.at(point);
+            } else if (moving_overlay[j + i * my_env_data.width] != -1) {
+                int obs_val = moving_overlay[j + i * my_env_data.width];
                 if (obs_val == 255) {
                     std::cout << "O";
                 } else if(obs_val == 0) {
@@ -88,10 +106,10 @@ void print_env(env_data_t my_env_data, point_char_map moving_obs, std::vector<sb
                 } else {
                     std::cout << (obs_val / 26);
                 }
-            } else if(my_env_data.grid_2d[j + i * my_env_data.width] == 0) {
+            } else if(my_env_data.grid_2d->cost(j, i) == 0) {
                 std::cout << " ";
-            } else if (my_env_data.grid_2d[j + i * my_env_data.width] < 255) {
-                std::cout << (my_env_data.grid_2d[j + i * my_env_data.width] / 26);
+            } else if (my_env_data.grid_2d->cost(j, i) < 255) {
+                std::cout << (my_env_data.grid_2d->cost(j, i) / 26);
             } else {
                 std::cout << "O";
             }
@@ -131,23 +149,373 @@ void print_path(std::vector<sbpl_xy_theta_pt_t> path)
     }
 }
 
-void print_moving_obs_points(point_char_map mov_obs)
+void print_moving_obs_points(cell_update_list mov_obs)
 {
     std::cout << "Printing Moving Obstacles" << std::endl;
     for (auto obs : mov_obs) {
-        std::cout << obs.first.first << ", " << obs.first.second << " " << (int)obs.second << std::endl;
+        std::cout << obs.x << ", " << obs.y << " " << (int)obs.cost << std::endl;
     }
 
 }
 
+// Cleared by SIGINT to stop the replanning loop after the current tick
+volatile sig_atomic_t g_running = 1;
+bool g_looping = false;
+
 void signal_handler(int s)
 {
     std::printf("Caught signal %d\n", s);
-    exit(1);
+    if(!g_looping || !g_running) {
+        exit(1);
+    }
+    g_running = 0;
+}
+
+long long to_ms(std::chrono::steady_clock::duration elapsed)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
+
+// What the tick line says about the winning planner of a portfolio
+std::string winner_of(const Planner &)
+{
+    return "";
+}
+
+std::string winner_of(const planner_portfolio &my_portfolio)
+{
+    const char* winner = my_portfolio.winner();
+    return winner == NULL ? "" : std::string(" won ") + winner;
+}
+
+/*
+ * Creates a planner from a snapshot, that plans for at most planning_time seconds
+ * Returns NULL if SBPL could not be initialized
+ */
+template<typename planner_type>
+std::unique_ptr<planner_type> create_planner(const std::function<planner_type*()> &make_planner,
+        env_snapshot_ptr my_env, env_constants_t &my_env_const, double planning_time)
+{
+    std::unique_ptr<planner_type> my_planner(make_planner());
+    my_planner->set_planning_time(planning_time);
+    if(my_planner->initialize(my_env, my_env_const) != 0) {
+        return NULL;
+    }
+    return my_planner;
+}
+
+/*
+ * Replans at tick_rate ticks per second until SIGINT, or for max_ticks if not 0.
+ * The next grid is fetched while the planner works on the current one. Moving
+ * obstacle changes go through update_grid_points and the new location through
+ * set_start so the search is reused, and so do stationary obstacle changes and a
+ * new goal. The planner is only rebuilt when the grid generation changes, that
+ * is when the map size changes.
+ * Each plan may use what is left of its tick, and every better path it finds on
+ * the way is counted. With preempt, a plan that already has a path stops as soon
+ * as the next grid is in and the next tick starts right away.
+ * When the communicator is subscribed or its scheduler polls, grids come in on
+ * their own and a tick starts as soon as one is in instead of on the tick rate,
+ * which then only sets the planning time. Grids that come in while planning are
+ * merged, the next tick plans on the newest one with all their changed cells.
+ * With post, every tick's path is posted in the background, the newest one if
+ * posting falls behind. It is reduced to waypoints first unless waypoint_tolerance is 0.
+ * A tick whose grid changed no cell under the last path, with the search done
+ * and the start and goal where they were, keeps the path instead of planning.
+ * make_planner gives a new Planner or planner_portfolio.
+ */
+template<typename planner_type>
+int run_loop(communicator &my_communicator, env_constants_t my_env_const, double tick_rate, int max_ticks,
+             bool preempt, bool post, double waypoint_tolerance, std::function<planner_type*()> make_planner)
+{
+    const std::chrono::milliseconds fetch_timeout(FETCH_TIMEOUT_MS);
+    const auto tick_period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                 std::chrono::duration<double>(1.0 / tick_rate));
+    const bool push = my_communicator.is_subscribed() || my_communicator.is_scheduled();
+
+    std::unique_ptr<planner_type> my_planner;
+    long long total_ms = 0;
+    long long worst_ms = 0;
+    int ticks = 0;
+    int paths = 0;
+    int preempted = 0;
+    int kept_paths = 0;
+    std::vector<sbpl_xy_theta_pt_t> waypoints;
+
+    //Set by the update task and the planner's solution callback, whichever comes
+    //second preempts the plan. Both see each other's flag.
+    std::atomic_bool grid_arrived(false);
+    std::atomic_bool tick_has_path(false);
+    std::atomic_bool tick_preempted(false);
+    //Pushed and scheduled grids call the listener at any time, not only while plan_until() runs
+    std::mutex planner_mutex;
+    double first_s = 0;
+    double last_epsilon = 0;
+    int solutions = 0;
+    solution_callback on_solution = [&](plan_solution_ptr solution) {
+        if(solutions == 0) {
+            first_s = solution->seconds;
+        }
+        last_epsilon = solution->epsilon;
+        solutions++;
+        tick_has_path = true;
+        if(preempt && grid_arrived) {
+            tick_preempted = true;
+            my_planner->preempt();
+        }
+    };
+    if(preempt) {
+        my_communicator.set_update_listener([&]() {
+            std::lock_guard<std::mutex> lock(planner_mutex);
+            grid_arrived = true;
+            if(tick_has_path && my_planner != NULL) {
+                tick_preempted = true;
+                my_planner->preempt();
+            }
+        });
+    }
+
+    g_looping = true;
+    if(!push) {
+        my_communicator.update_data();
+    }
+    unsigned long seen = 0;
+    auto next_tick = std::chrono::steady_clock::now();
+    while(g_running && (max_ticks == 0 || ticks < max_ticks)) {
+        auto tick_start = std::chrono::steady_clock::now();
+        auto deadline = next_tick + tick_period;
+
+        bool updated;
+        unsigned long grids = 1;
+        if(push) {
+            //Wait for a grid newer than the last one planned on, the newest if several came
+            updated = my_communicator.wait_for_update_count(seen, fetch_timeout);
+            grids = my_communicator.update_count() - seen;
+            seen += grids;
+        } else {
+            //Update N was started last tick (or above), wait for it
+            updated = my_communicator.wait_for_update(fetch_timeout);
+        }
+        auto fetched = std::chrono::steady_clock::now();
+
+        //Before the grid is taken, one that arrives from here on preempts this tick's plan
+        grid_arrived = false;
+        tick_has_path = false;
+        tick_preempted = false;
+        solutions = 0;
+
+        cell_update_list moving_obs_pts;
+        bool rebuilt = false;
+        if(updated) {
+            //The cells are every change since the last tick, even if grids came in between
+            env_snapshot_ptr my_env = my_communicator.take_update(moving_obs_pts);
+            if(my_planner == NULL || my_planner->grid_generation() != my_env->grid_generation) {
+                std::lock_guard<std::mutex> lock(planner_mutex);
+                my_planner = create_planner(make_planner, my_env, my_env_const, 1.0 / tick_rate);
+                if(my_planner == NULL) {
+                    std::cout << "Failed to initialize the planner!" << std::endl;
+                    my_communicator.set_update_listener(NULL);
+                    return 1;
+                }
+                my_planner->set_solution_callback(on_solution);
+                rebuilt = true;
+            } else {
+                if(my_planner->set_start(my_env->data.start_x, my_env->data.start_y, my_env->data.start_theta) != 0) {
+                    std::cout << "Tick " << ticks << ": location is off the map" << std::endl;
+                }
+                if(my_planner->set_goal(my_env->data.end_x, my_env->data.end_y, my_env->data.end_theta) != 0) {
+                    std::cout << "Tick " << ticks << ": goal is off the map" << std::endl;
+                }
+            }
+        }
+
+        //Fetch N+1 while planning on N. The planner has its own copy of the grid.
+        if(!push) {
+            my_communicator.update_data();
+        }
+
+        if(!updated) {
+            std::cout << "Tick " << ticks << ": no grid data from server" << std::endl;
+        } else {
+            my_planner->update_grid_points(moving_obs_pts);
+            auto update_done = std::chrono::steady_clock::now();
+            //Nothing under the last optimal path changed, planning again would find it again
+            bool kept = !rebuilt && my_planner->path_current();
+            int has_path = Planner::PATH_EXISTS;
+            if(!kept) {
+                has_path = my_planner->plan_until(std::max(deadline, update_done + std::chrono::milliseconds(MIN_PLAN_MS)));
+            }
+            auto plan_done = std::chrono::steady_clock::now();
+            paths += has_path ? 1 : 0;
+            kept_paths += kept ? 1 : 0;
+            preempted += tick_preempted ? 1 : 0;
+            waypoints.clear();
+            if(post && has_path && !kept) {
+                if(waypoint_tolerance > 0) {
+                    my_planner->simplify_path(my_planner->path(), waypoint_tolerance, waypoints);
+                    my_communicator.post_results(waypoints);
+                } else {
+                    my_communicator.post_results(my_planner->path());
+                }
+            }
+
+            long long tick_ms = to_ms(plan_done - tick_start);
+            total_ms += tick_ms;
+            worst_ms = std::max(worst_ms, tick_ms);
+            std::cout << "Tick " << ticks << ": wait(ms) " << to_ms(fetched - tick_start)
+                      << " update(ms) " << to_ms(update_done - fetched)
+                      << " plan(ms) " << to_ms(plan_done - update_done);
+            if(solutions > 0) {
+                std::cout << " first path(ms) " << (long long)(first_s * 1000)
+                          << " paths " << solutions << " eps " << last_epsilon;
+            }
+            std::cout << " total(ms) " << tick_ms
+                      << " changed cells " << moving_obs_pts.size()
+                      << (grids > 1 ? " merged " + std::to_string(grids) + " grids" : "")
+                      << (waypoints.empty() ? "" : " waypoints " + std::to_string(waypoints.size()) + " of " +
+                          std::to_string(my_planner->path().size()))
+                      << (rebuilt ? " rebuilt" : "")
+                      << (kept ? " kept" : "")
+                      << (tick_preempted ? " preempted" : "")
+                      << winner_of(*my_planner)
+                      << (has_path ? " path" : " NO PATH") << std::endl;
+        }
+        ticks++;
+
+        next_tick += tick_period;
+        auto now = std::chrono::steady_clock::now();
+        if(push || next_tick < now || tick_preempted) {
+            //Grids come on their own, overran the tick, or newer data is waiting. Start the next one right
+            //away rather than trying to catch up
+            next_tick = now;
+        } else {
+            std::this_thread::sleep_until(next_tick);
+        }
+    }
+
+    //Let the last fetch finish before the communicator goes away
+    if(push) {
+        my_communicator.stop_scheduler();
+        my_communicator.unsubscribe();
+    } else {
+        my_communicator.wait_for_update(fetch_timeout);
+    }
+    my_communicator.set_update_listener(NULL);
+    if(post && !my_communicator.wait_for_post(fetch_timeout)) {
+        std::cout << "The last path was not posted" << std::endl;
+    }
+
+    std::cout << "Ticks: " << ticks << " with path: " << paths << " kept without replanning: " << kept_paths;
+    if(preempt) {
+        std::cout << " preempted: " << preempted;
+    }
+    std::cout << std::endl;
+    if(ticks > 0) {
+        std::cout << "Average tick time(ms): " << total_ms / ticks << " worst: " << worst_ms << std::endl;
+    }
+    update_counters_t counters = my_communicator.get_update_counters();
+    std::cout << "Grids: " << counters.applied << " merged: " << counters.merged
+              << " polls dropped: " << counters.dropped << std::endl;
+    return 0;
+}
+
+void print_usage(const char* name)
+{
+    std::cout << "Usage: " << name << " [-l] [-p] [-r ticks_per_second] [-n ticks] [-P first|best] [-L log.csv] [-c capture] [-m metrics] [-C scale] [-s ws|poll] [-o] [-w meters]" << std::endl;
+    std::cout << "  -l  keep replanning as new grids come in, until ctrl-c" << std::endl;
+    std::cout << "  -r  tick rate of -l (default " << DEFAULT_TICK_RATE << ")" << std::endl;
+    std::cout << "  -n  stop -l after this many ticks (default 0, run forever)" << std::endl;
+    std::cout << "  -p  with -l, stop improving a path once the next grid is in" << std::endl;
+    std::cout << "  -P  with -l, race several planners and keep the first or the best path" << std::endl;
+    std::cout << "  -L  csv file -P logs every planner of every plan to (default " << DEFAULT_PORTFOLIO_LOG << ")" << std::endl;
+    std::cout << "  -c  record every grid response to a capture file, for bin/bench_replay" << std::endl;
+    std::cout << "  -m  rewrite a metrics file every second, json if it ends in .json" << std::endl;
+    std::cout << "  -C  plan inside a corridor found on a grid scale times coarser, try "
+              << CORRIDOR_DEFAULT_SCALE << " (default 0, whole grid)" << std::endl;
+    std::cout << "  -s  with -l, have the server push grids over " << GRID_STREAM_PATH
+              << " (ws) or by long poll (poll) instead of fetching one a tick" << std::endl;
+    std::cout << "  -o  post every path found to /api/path" << std::endl;
+    std::cout << "  -w  how far -o waypoints may stray from the path, 0 posts every pose (default "
+              << PATH_SIMPLIFY_DEFAULT_TOLERANCE_M << ")" << std::endl;
 }
 
 int main(int argc, char *argv[])
 {
+    bool loop = false;
+    bool preempt = false;
+    bool portfolio = false;
+    portfolio_mode_t portfolio_mode = PORTFOLIO_FIRST;
+    std::string portfolio_log = DEFAULT_PORTFOLIO_LOG;
+    std::string capture_file;
+    std::string metrics_file;
+    double tick_rate = DEFAULT_TICK_RATE;
+    int max_ticks = 0;
+    corridor_params_t corridor_params = {0, CORRIDOR_DEFAULT_BUFFER};
+    bool subscribe = false;
+    bool post = false;
+    double waypoint_tolerance = PATH_SIMPLIFY_DEFAULT_TOLERANCE_M;
+    subscribe_mode_t subscribe_mode = SUBSCRIBE_WEBSOCKET;
+    int opt;
+    while((opt = getopt(argc, argv, "lpr:n:P:L:c:m:C:s:ow:h")) != -1) {
+        switch(opt) {
+        case 'l':
+            loop = true;
+            break;
+        case 'p':
+            preempt = true;
+            break;
+        case 'r':
+            tick_rate = std::atof(optarg);
+            break;
+        case 'n':
+            max_ticks = std::atoi(optarg);
+            break;
+        case 'P':
+            portfolio = true;
+            if(std::string(optarg) == "best") {
+                portfolio_mode = PORTFOLIO_BEST;
+            } else if(std::string(optarg) != "first") {
+                print_usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'L':
+            portfolio_log = optarg;
+            break;
+        case 'c':
+            capture_file = optarg;
+            break;
+        case 'm':
+            metrics_file = optarg;
+            break;
+        case 'C':
+            corridor_params.scale = std::atoi(optarg);
+            break;
+        case 'o':
+            post = true;
+            break;
+        case 'w':
+            waypoint_tolerance = std::atof(optarg);
+            break;
+        case 's':
+            subscribe = true;
+            if(std::string(optarg) == "poll") {
+                subscribe_mode = SUBSCRIBE_LONG_POLL;
+            } else if(std::string(optarg) != "ws") {
+                print_usage(argv[0]);
+                return 1;
+            }
+            break;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if(tick_rate <= 0 || max_ticks < 0 || corridor_params.scale < 0 || waypoint_tolerance < 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
     // Setup signal interrupt
     struct sigaction sigIntHandler;
     sigIntHandler.sa_handler = signal_handler;
@@ -161,23 +529,62 @@ int main(int argc, char *argv[])
         std::cout << "Error with config: EXITING" << std::endl;
         return 1;
     }
+    if(!my_communicator.set_capture_file(capture_file)) {
+        std::cout << "Cannot create capture file: " << capture_file << std::endl;
+        return 1;
+    }
+    std::unique_ptr<metrics_dumper> my_metrics;
+    if(!metrics_file.empty()) {
+        my_metrics.reset(new metrics_dumper(metrics_file));
+    }
+
+    if(loop && subscribe) {
+        my_communicator.subscribe(subscribe_mode);
+    } else if(loop && my_communicator.start_scheduler()) {
+        std::cout << "Polling the server on a timer, see poll_rate_hz" << std::endl;
+    }
+
+    if(loop && portfolio) {
+        std::vector<planner_config_t> configs(std::begin(DEFAULT_PORTFOLIO), std::end(DEFAULT_PORTFOLIO));
+        std::function<planner_portfolio*()> make_portfolio = [&]() {
+            planner_portfolio* my_portfolio = new planner_portfolio(portfolio_mode, configs);
+            //No heuristic pool, the planners already take a core each and would queue on it
+            my_portfolio->set_corridor(corridor_params);
+            if(!my_portfolio->open_log(portfolio_log)) {
+                std::cout << "Could not open " << portfolio_log << ", not logging" << std::endl;
+            }
+            return my_portfolio;
+        };
+        return run_loop(my_communicator, my_communicator.get_const_data(), tick_rate, max_ticks, preempt, post,
+                        waypoint_tolerance, make_portfolio);
+    }
+    //Backward searches root the 2D heuristic at the vehicle, so it is built again whenever the vehicle moves
+    thread_pool heuristic_pool;
+    if(loop) {
+        std::function<Planner*()> make_planner = [corridor_params, &heuristic_pool]() {
+            Planner* my_planner = new Planner();
+            my_planner->set_corridor(corridor_params);
+            my_planner->set_heuristic_pool(&heuristic_pool);
+            return my_planner;
+        };
+        return run_loop(my_communicator, my_communicator.get_const_data(), tick_rate, max_ticks, preempt, post,
+                        waypoint_tolerance, make_planner);
+    }
 
     auto start = std::chrono::system_clock::now();
     my_communicator.update_data();
     std::cout << "Waiting for first data from server" << std::endl;
-    while(my_communicator.update_in_progress()) {
-        usleep(10);
-    }
-    if(!my_communicator.is_updated()) {
+    if(!my_communicator.wait_for_update(std::chrono::milliseconds(FETCH_TIMEOUT_MS))) {
         std::cout << "Failed to get grid data from server!" << std::endl;
         return 1;
     }
     auto end = std::chrono::system_clock::now();
     auto elapsed = end - start;
 
-    env_data_t my_env_data = my_communicator.get_env_data();
+    env_snapshot_ptr my_env = my_communicator.get_env_snapshot();
+    env_data_t my_env_data = my_env->data; //grid_2d is valid while my_env is held
     env_constants_t my_env_const = my_communicator.get_const_data();
-    point_char_map moveing_obs_pts = my_communicator.get_updated_points();
+    cell_update_list moveing_obs_pts = my_communicator.get_updated_points();
 
     std::cout << "Height:   " << my_env_data.height << std::endl;
     std::cout << "Width:    " << my_env_data.width << std::endl;
@@ -194,14 +601,12 @@ int main(int argc, char *argv[])
 
     //Create a planner object
     Planner my_planner;
-    {
-        //Lock the grid, then intialize the planner
-        std::unique_lock<std::mutex> env_grid_lock = my_communicator.get_lock_env_grid_2d();
+    my_planner.set_corridor(corridor_params);
+    my_planner.set_heuristic_pool(&heuristic_pool);
 #ifdef _DEBUG
-        std::cout << "Initialize Planner" << std::endl;
+    std::cout << "Initialize Planner" << std::endl;
 #endif
-        my_planner.initialize(my_env_data, my_env_const);
-    }
+    my_planner.initialize(my_env, my_env_const);
 
     end = std::chrono::system_clock::now();
     elapsed = end - start;
@@ -233,6 +638,19 @@ int main(int argc, char *argv[])
 
     if(has_path) {
         std::cout << "Has path" << std::endl;
+        if(post) {
+            if(waypoint_tolerance > 0) {
+                std::vector<sbpl_xy_theta_pt_t> waypoints;
+                my_planner.simplify_path(my_planner.path(), waypoint_tolerance, waypoints);
+                std::cout << "Waypoints: " << waypoints.size() << " of " << my_planner.path().size() << std::endl;
+                my_communicator.post_results(waypoints);
+            } else {
+                my_communicator.post_results(my_planner.path());
+            }
+            if(!my_communicator.wait_for_post(std::chrono::milliseconds(FETCH_TIMEOUT_MS))) {
+                std::cout << "Failed to post the path!" << std::endl;
+            }
+        }
     } else {
         std::cout << "NO PATH FOUND"  << std::endl;
     }
@@ -24,6 +24,15 @@
 
 #define GRID_UNDEFINED -1
 
+// Replans per second in loop mode (-l), change with -r
+#define DEFAULT_TICK_RATE 2.0
+// How long to wait for a grid from the server, longer than the http client timeout
+#define FETCH_TIMEOUT_MS 20000
+// Planning time every tick gets, even when waiting for the grid or a rebuild used up the tick
+#define MIN_PLAN_MS 50
+// Where -P logs how every planner did, change with -L
+#define DEFAULT_PORTFOLIO_LOG "portfolio.csv"
+
 struct grid_t {
     int x, y;
 };
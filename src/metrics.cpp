@@ -0,0 +1,261 @@
+///////////////////////////////////////////////////////////////////////////////
+// metrics.cpp - Latency histograms and search counters - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "metrics.hpp"
+
+#include <cstdio>
+#include <sstream>
+
+static const char* STAGE_NAMES[METRIC_STAGE_COUNT] = {
+    "fetch", "parse", "raster", "diff", "update_cost", "changed_edges", "heuristic", "replan", "simplify", "post"
+};
+
+// Percentiles in the dumps
+static const double DUMP_PERCENTILES[] = {50, 90, 99, 99.9};
+
+latency_histogram::latency_histogram() :
+    m_count(0),
+    m_sum(0),
+    m_max(0)
+{
+    for(int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        m_buckets[i] = 0;
+    }
+}
+
+void latency_histogram::record(uint64_t us)
+{
+    m_buckets[bucket_of(us)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(us, std::memory_order_relaxed);
+    uint64_t seen = m_max.load(std::memory_order_relaxed);
+    while(us > seen && !m_max.compare_exchange_weak(seen, us, std::memory_order_relaxed)) {
+    }
+}
+
+void latency_histogram::record(std::chrono::steady_clock::duration elapsed)
+{
+    long long us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    record((uint64_t)(us < 0 ? 0 : us));
+}
+
+uint64_t latency_histogram::count() const
+{
+    return m_count.load(std::memory_order_relaxed);
+}
+
+uint64_t latency_histogram::max() const
+{
+    return m_max.load(std::memory_order_relaxed);
+}
+
+double latency_histogram::mean() const
+{
+    uint64_t n = count();
+    return n == 0 ? 0.0 : (double)m_sum.load(std::memory_order_relaxed) / n;
+}
+
+/*
+ * Walks the buckets up to the rank of p. The buckets are read one by one
+ * while others may record, so the result is close but not exact under load.
+ */
+uint64_t latency_histogram::percentile(double p) const
+{
+    uint64_t n = count();
+    if(n == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)(p / 100.0 * n + 0.999999);
+    rank = rank < 1 ? 1 : (rank > n ? n : rank);
+    uint64_t seen = 0;
+    for(int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if(seen >= rank) {
+            uint64_t upper = bucket_upper(i);
+            return upper < max() ? upper : max();
+        }
+    }
+    return max();
+}
+
+/*
+ * Values below HISTOGRAM_SUB_BUCKETS are their own bucket. Above, the top
+ * HISTOGRAM_SUB_BITS + 1 bits pick the bucket within the value's power of two.
+ */
+int latency_histogram::bucket_of(uint64_t us)
+{
+    if(us < HISTOGRAM_SUB_BUCKETS) {
+        return (int)us;
+    }
+    int exponent = 63 - __builtin_clzll(us);
+    if(exponent >= HISTOGRAM_MAX_BITS) {
+        return HISTOGRAM_BUCKETS - 1;
+    }
+    int shift = exponent - HISTOGRAM_SUB_BITS;
+    return HISTOGRAM_SUB_BUCKETS * shift + (int)(us >> shift);
+}
+
+uint64_t latency_histogram::bucket_upper(int bucket)
+{
+    if(bucket < HISTOGRAM_SUB_BUCKETS) {
+        return bucket;
+    }
+    int shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+    uint64_t mantissa = bucket - HISTOGRAM_SUB_BUCKETS * shift;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+const char* metric_stage_name(metric_stage_t stage)
+{
+    return STAGE_NAMES[stage];
+}
+
+metrics_registry::metrics_registry() :
+    plans(0),
+    paths(0),
+    expansions(0),
+    last_expansions(0),
+    last_epsilon(0),
+    last_path_length(0),
+    updates(0),
+    updates_merged(0),
+    polls_dropped(0),
+    posts_coalesced(0)
+{
+
+}
+
+void metrics_registry::record_search(bool path_found, uint64_t search_expansions, double epsilon, double path_length)
+{
+    plans.fetch_add(1, std::memory_order_relaxed);
+    if(path_found) {
+        paths.fetch_add(1, std::memory_order_relaxed);
+    }
+    expansions.fetch_add(search_expansions, std::memory_order_relaxed);
+    last_expansions = search_expansions;
+    last_epsilon = epsilon;
+    last_path_length = path_length;
+}
+
+std::string metrics_registry::to_text() const
+{
+    std::ostringstream out;
+    for(int i = 0; i < METRIC_STAGE_COUNT; i++) {
+        const latency_histogram& stage = stages[i];
+        const char* name = STAGE_NAMES[i];
+        for(double p : DUMP_PERCENTILES) {
+            out << "drops_stage_us{stage=\"" << name << "\",quantile=\"" << p / 100 << "\"} "
+                << stage.percentile(p) << '\n';
+        }
+        out << "drops_stage_us_max{stage=\"" << name << "\"} " << stage.max() << '\n';
+        out << "drops_stage_us_mean{stage=\"" << name << "\"} " << stage.mean() << '\n';
+        out << "drops_stage_count{stage=\"" << name << "\"} " << stage.count() << '\n';
+    }
+    out << "drops_plans_total " << plans << '\n';
+    out << "drops_paths_total " << paths << '\n';
+    out << "drops_expansions_total " << expansions << '\n';
+    out << "drops_last_expansions " << last_expansions << '\n';
+    out << "drops_last_epsilon " << last_epsilon << '\n';
+    out << "drops_last_path_length_m " << last_path_length << '\n';
+    out << "drops_updates_total " << updates << '\n';
+    out << "drops_updates_merged_total " << updates_merged << '\n';
+    out << "drops_polls_dropped_total " << polls_dropped << '\n';
+    out << "drops_posts_coalesced_total " << posts_coalesced << '\n';
+    return out.str();
+}
+
+std::string metrics_registry::to_json() const
+{
+    std::ostringstream out;
+    out << "{\"stages\":{";
+    for(int i = 0; i < METRIC_STAGE_COUNT; i++) {
+        const latency_histogram& stage = stages[i];
+        out << (i == 0 ? "" : ",") << '"' << STAGE_NAMES[i] << "\":{\"count\":" << stage.count()
+            << ",\"mean_us\":" << stage.mean()
+            << ",\"p50_us\":" << stage.percentile(50)
+            << ",\"p90_us\":" << stage.percentile(90)
+            << ",\"p99_us\":" << stage.percentile(99)
+            << ",\"p999_us\":" << stage.percentile(99.9)
+            << ",\"max_us\":" << stage.max() << '}';
+    }
+    out << "},\"search\":{\"plans\":" << plans << ",\"paths\":" << paths
+        << ",\"expansions\":" << expansions << ",\"last_expansions\":" << last_expansions
+        << ",\"last_epsilon\":" << last_epsilon << ",\"last_path_length_m\":" << last_path_length << '}'
+        << ",\"updates\":{\"applied\":" << updates << ",\"merged\":" << updates_merged
+        << ",\"polls_dropped\":" << polls_dropped << ",\"posts_coalesced\":" << posts_coalesced << "}}\n";
+    return out.str();
+}
+
+metrics_registry& metrics()
+{
+    static metrics_registry registry;
+    return registry;
+}
+
+metrics_dumper::metrics_dumper(const std::string& filename, std::chrono::milliseconds period) :
+    m_filename(filename),
+    m_json(filename.size() >= 5 && filename.compare(filename.size() - 5, 5, ".json") == 0),
+    m_period(period),
+    m_stop(false),
+    m_thread(&metrics_dumper::run, this)
+{
+
+}
+
+metrics_dumper::~metrics_dumper()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+    dump();
+}
+
+/*
+ * Writes a temporary file next to the real one and renames it over it
+ */
+bool metrics_dumper::dump()
+{
+    std::string body = m_json ? metrics().to_json() : metrics().to_text();
+    std::string temp = m_filename + ".tmp";
+    FILE* file = fopen(temp.c_str(), "w");
+    if(file == NULL) {
+        return false;
+    }
+    bool good = fwrite(body.data(), 1, body.size(), file) == body.size();
+    good = (fclose(file) == 0) && good;
+    return good && rename(temp.c_str(), m_filename.c_str()) == 0;
+}
+
+void metrics_dumper::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(!m_stop) {
+        if(m_cv.wait_for(lock, m_period, [this]() {
+            return m_stop;
+        })) {
+            break;
+        }
+        lock.unlock();
+        dump();
+        lock.lock();
+    }
+}
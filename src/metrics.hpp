@@ -0,0 +1,171 @@
+///////////////////////////////////////////////////////////////////////////////
+// metrics.h - Latency histograms and search counters - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Values below 2^HISTOGRAM_SUB_BITS get a bucket each, every power of two above is
+// split in 2^HISTOGRAM_SUB_BITS buckets, so a bucket is at most 1/16 = 6% wide
+#define HISTOGRAM_SUB_BITS 4
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+// Up to 2^40 us, about 12 days
+#define HISTOGRAM_MAX_BITS 40
+#define HISTOGRAM_BUCKETS (HISTOGRAM_SUB_BUCKETS * (HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1))
+
+// How often metrics_dumper rewrites its file
+#define METRICS_DUMP_PERIOD_MS 1000
+
+/*
+ * Log linear histogram of microsecond latencies, in the style of HDR histograms.
+ * record() is a few relaxed atomic adds, safe from any thread.
+ */
+class latency_histogram {
+public:
+    latency_histogram();
+
+    void record(uint64_t us);
+    void record(std::chrono::steady_clock::duration elapsed);
+
+    uint64_t count() const;
+    uint64_t max() const;
+    double mean() const;
+    // Upper bound of the bucket holding the p-th percentile, 0 <= p <= 100
+    uint64_t percentile(double p) const;
+
+private:
+    latency_histogram(const latency_histogram&);
+    latency_histogram& operator=(const latency_histogram&);
+
+    static int bucket_of(uint64_t us);
+    static uint64_t bucket_upper(int bucket);
+
+    std::atomic<uint64_t> m_buckets[HISTOGRAM_BUCKETS];
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_sum;
+    std::atomic<uint64_t> m_max;
+};
+
+// The timed stages of an update and a plan
+enum metric_stage_t {
+    METRIC_FETCH, //Request sent to response headers in
+    METRIC_PARSE, //Body read and parsed, or decoded for the binary grid
+    METRIC_RASTER, //Obstacles inflated into the grid
+    METRIC_DIFF, //Moving obstacle layer compared with the last one
+    METRIC_UPDATE_COST, //Changed cells handed to SBPL's UpdateCost
+    METRIC_CHANGED_EDGES, //SBPL finding the states behind the changed cells
+    METRIC_HEURISTIC, //2D heuristic repaired or built at the start of a search
+    METRIC_REPLAN, //One whole search, every replan() slice of it
+    METRIC_SIMPLIFY, //Path reduced to waypoints
+    METRIC_POST, //Path posted to response in
+    METRIC_STAGE_COUNT
+};
+
+// Name of a stage in the dumps
+const char* metric_stage_name(metric_stage_t stage);
+
+/*
+ * Everything that is measured, one per process. See metrics().
+ */
+struct metrics_registry {
+    metrics_registry();
+
+    latency_histogram stages[METRIC_STAGE_COUNT];
+
+    //Search counters, totals since the start
+    std::atomic<uint64_t> plans;
+    std::atomic<uint64_t> paths;
+    std::atomic<uint64_t> expansions;
+    //Of the last search
+    std::atomic<uint64_t> last_expansions;
+    std::atomic<double> last_epsilon;
+    std::atomic<double> last_path_length; //Meters
+
+    //Update counters, totals since the start
+    std::atomic<uint64_t> updates; //Grids applied to the cost map
+    std::atomic<uint64_t> updates_merged; //Applied before the planner took the one before, their cells merged
+    std::atomic<uint64_t> polls_dropped; //Scheduled polls skipped because the last fetch was still running
+    std::atomic<uint64_t> posts_coalesced; //Paths replaced by a newer one before they were posted
+
+    // Records how a search went
+    void record_search(bool path_found, uint64_t search_expansions, double epsilon, double path_length);
+
+    // Prometheus style text, one line per value
+    std::string to_text() const;
+    std::string to_json() const;
+};
+
+metrics_registry& metrics();
+
+/*
+ * Adds the time from construction to destruction to a stage
+ */
+class metric_timer {
+public:
+    explicit metric_timer(metric_stage_t stage) :
+        m_stage(stage),
+        m_start(std::chrono::steady_clock::now()) {
+    }
+    ~metric_timer() {
+        metrics().stages[m_stage].record(std::chrono::steady_clock::now() - m_start);
+    }
+
+private:
+    metric_stage_t m_stage;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+/*
+ * Rewrites a file with the metrics every period, as json if the name ends in
+ * .json, else as text. The file is replaced in one rename, so readers never
+ * see half of it.
+ */
+class metrics_dumper {
+public:
+    explicit metrics_dumper(const std::string& filename,
+                            std::chrono::milliseconds period = std::chrono::milliseconds(METRICS_DUMP_PERIOD_MS));
+    // Writes one last dump and stops
+    ~metrics_dumper();
+
+    // Writes the file now, false if it could not be written
+    bool dump();
+
+private:
+    metrics_dumper(const metrics_dumper&);
+    metrics_dumper& operator=(const metrics_dumper&);
+
+    void run();
+
+    std::string m_filename;
+    bool m_json;
+    std::chrono::milliseconds m_period;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop;
+    std::thread m_thread;
+};
+
+#endif /* METRICS_H */
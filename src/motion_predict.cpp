@@ -0,0 +1,101 @@
+///////////////////////////////////////////////////////////////////////////////
+// motion_predict.cpp - Predicted tracks of moving obstacles - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "motion_predict.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void motion_predictor::predict(obstacle_span_t obstacles, inflation_stamp_cache& cache, inflation_params_t inf_param,
+                               predict_params_t params, std::vector<obstacle_t>& samples, stamp_list& stamps)
+{
+    samples.clear();
+    stamps.clear();
+    for(const obstacle_t& obs : obstacles) {
+        std::shared_ptr<const inflation_stamp_t> stamp = cache.get(obs.radius, inf_param);
+        double distance = (params.mode == PREDICT_OFF) ? 0.0 : std::abs(obs.velocity) * params.horizon_s;
+        double spacing = std::max(1.0, obs.radius / 2.0);
+        if(distance <= 0) {
+            samples.push_back(obs);
+            stamps.push_back(stamp);
+            continue;
+        }
+        spacing = std::max(spacing, distance / (PREDICT_MAX_SAMPLES - 2));
+
+        double heading = obs.heading * M_PI / 180.0;
+        double dir_x = std::cos(heading);
+        double dir_y = std::sin(heading);
+        if(obs.velocity < 0) {
+            dir_x = -dir_x;
+            dir_y = -dir_y;
+        }
+        //Samples between both ends sit on multiples of spacing along the track line, not
+        //relative to the obstacle, so they stay put from one update to the next and only
+        //the ends of the track change cells
+        double origin = obs.x * dir_x + obs.y * dir_y;
+        push_sample(obs, 0.0, dir_x, dir_y, stamp, 0.0, params, samples, stamps);
+        for(double along = (std::floor(origin / spacing) + 1) * spacing - origin; along < distance;
+                along += spacing) {
+            push_sample(obs, along, dir_x, dir_y, stamp, along / distance, params, samples, stamps);
+        }
+        push_sample(obs, distance, dir_x, dir_y, stamp, 1.0, params, samples, stamps);
+    }
+}
+
+/*
+ * Adds obs moved along cells down its track. fraction is how far along the
+ * horizon that is, which sets the discount.
+ */
+void motion_predictor::push_sample(const obstacle_t& obs, double along, double dir_x, double dir_y,
+                                   const std::shared_ptr<const inflation_stamp_t>& stamp, double fraction,
+                                   predict_params_t params, std::vector<obstacle_t>& samples, stamp_list& stamps)
+{
+    obstacle_t sample = obs;
+    sample.x = obs.x + (int)std::lround(dir_x * along);
+    sample.y = obs.y + (int)std::lround(dir_y * along);
+    samples.push_back(sample);
+    if(params.mode == PREDICT_DISCOUNTED) {
+        int level = (int)std::lround(fraction * PREDICT_DISCOUNT_LEVELS);
+        stamps.push_back(discounted(stamp, level, params.discount));
+    } else {
+        stamps.push_back(stamp);
+    }
+}
+
+std::shared_ptr<const inflation_stamp_t> motion_predictor::discounted(
+    const std::shared_ptr<const inflation_stamp_t>& stamp, int level, double discount)
+{
+    if(level == 0) {
+        return stamp;
+    }
+    scaled_key_t key = {stamp.get(), level, discount};
+    auto it = m_scaled.find(key);
+    if(it != m_scaled.end()) {
+        return it->second.second;
+    }
+
+    double scale = 1.0 - (1.0 - discount) * level / PREDICT_DISCOUNT_LEVELS;
+    std::shared_ptr<inflation_stamp_t> scaled(new inflation_stamp_t(*stamp));
+    for(unsigned char& cost : scaled->cost) {
+        //Rounded up, a cell with some cost keeps some
+        cost = (unsigned char)std::min(255.0, std::ceil(cost * scale));
+    }
+    m_scaled[key] = std::make_pair(stamp, scaled);
+    return scaled;
+}
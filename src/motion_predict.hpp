@@ -0,0 +1,92 @@
+///////////////////////////////////////////////////////////////////////////////
+// motion_predict.h - Predicted tracks of moving obstacles - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MOTION_PREDICT_H
+#define MOTION_PREDICT_H
+
+#include "inflation.hpp"
+#include "tile_raster.hpp"
+
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Steps between full cost and the discount in PREDICT_DISCOUNTED, each is a stamp of its own
+#define PREDICT_DISCOUNT_LEVELS 8
+// Most positions stamped along one track, the spacing grows past it
+#define PREDICT_MAX_SAMPLES 64
+
+enum predict_mode_t {
+    PREDICT_OFF, //Moving obstacles are stamped where they are
+    PREDICT_SWEPT, //Full cost along the whole projected track
+    PREDICT_DISCOUNTED //Cost falls off along the track, down to discount at the horizon
+};
+
+struct predict_params_t {
+    predict_mode_t mode;
+    double horizon_s; //How far ahead the track goes, in seconds
+    double discount; //PREDICT_DISCOUNTED weight of the cost at the horizon, 0 to 1
+};
+
+/*
+ * Turns each moving obstacle into copies of itself along its projected track,
+ * from where it is now to where it will be horizon_s from now. Heading is in
+ * degrees from the x axis, towards y, and velocity in cells per second.
+ *
+ * The copies are spaced by half the obstacle radius, so the core of the track
+ * has no gaps, and are stamped like any obstacle. Between the two ends they
+ * sit at fixed points of the track, so a steady obstacle only changes the
+ * cells at the ends of its track from one update to the next. A path planned around the
+ * track stays clear while the obstacle follows it.
+ */
+class motion_predictor {
+public:
+    // Fills samples with the positions to stamp and stamps with their stamps, in the same order
+    void predict(obstacle_span_t obstacles, inflation_stamp_cache& cache, inflation_params_t inf_param,
+                 predict_params_t params, std::vector<obstacle_t>& samples, stamp_list& stamps);
+
+private:
+    void push_sample(const obstacle_t& obs, double along, double dir_x, double dir_y,
+                     const std::shared_ptr<const inflation_stamp_t>& stamp, double fraction,
+                     predict_params_t params, std::vector<obstacle_t>& samples, stamp_list& stamps);
+    // stamp with every cost scaled by level / PREDICT_DISCOUNT_LEVELS of the way to discount
+    std::shared_ptr<const inflation_stamp_t> discounted(const std::shared_ptr<const inflation_stamp_t>& stamp,
+            int level, double discount);
+
+    struct scaled_key_t {
+        const inflation_stamp_t* stamp;
+        int level;
+        double discount;
+        bool operator<(const scaled_key_t& other) const {
+            if(stamp != other.stamp) {
+                return stamp < other.stamp;
+            }
+            if(level != other.level) {
+                return level < other.level;
+            }
+            return discount < other.discount;
+        }
+    };
+    //The source stamp is kept with its scaled copy, so its address is not reused while in the map
+    std::map<scaled_key_t, std::pair<std::shared_ptr<const inflation_stamp_t>,
+        std::shared_ptr<const inflation_stamp_t> > > m_scaled;
+};
+
+#endif /* MOTION_PREDICT_H */
@@ -0,0 +1,271 @@
+///////////////////////////////////////////////////////////////////////////////
+// mprim_cache.cpp - Compiled motion primitive cache - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "mprim_cache.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+uint64_t fnv1a_64(const void* data, size_t size, uint64_t seed)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint64_t hash = seed;
+    for(size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool checksum_file(FILE* file, uint64_t& size, uint64_t& checksum)
+{
+    char buffer[16384];
+    size = 0;
+    checksum = fnv1a_64(NULL, 0);
+    rewind(file);
+    size_t read;
+    while((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        checksum = fnv1a_64(buffer, read, checksum);
+        size += read;
+    }
+    return !ferror(file);
+}
+
+bool write_mprim_cache(const std::string& path, const mprim_cache_header_t& header,
+                       const std::vector<SBPL_xytheta_mprimitive>& prims)
+{
+    mprim_cache_header_t out_header = header;
+    std::vector<mprim_cache_prim_t> out_prims;
+    std::vector<mprim_cache_pose_t> out_poses;
+    out_prims.reserve(prims.size());
+    for(const SBPL_xytheta_mprimitive& prim : prims) {
+        mprim_cache_prim_t out_prim;
+        out_prim.id = prim.motprimID;
+        out_prim.start_theta = prim.starttheta_c;
+        out_prim.cost_mult = prim.additionalactioncostmult;
+        out_prim.end_x = prim.endcell.x;
+        out_prim.end_y = prim.endcell.y;
+        out_prim.end_theta = prim.endcell.theta;
+        out_prim.first_pose = out_poses.size();
+        out_prim.pose_count = prim.intermptV.size();
+        out_prims.push_back(out_prim);
+        for(const sbpl_xy_theta_pt_t& pose : prim.intermptV) {
+            out_poses.push_back({pose.x, pose.y, pose.theta});
+        }
+    }
+    out_header.magic = MPRIM_CACHE_MAGIC;
+    out_header.version = MPRIM_CACHE_VERSION;
+    out_header.prim_count = out_prims.size();
+    out_header.pose_count = out_poses.size();
+    out_header.reserved = 0;
+
+    std::string tmp_path = path + ".tmp";
+    FILE* file = fopen(tmp_path.c_str(), "wb");
+    if(file == NULL) {
+        return false;
+    }
+    bool good = fwrite(&out_header, sizeof(out_header), 1, file) == 1 &&
+                fwrite(out_prims.data(), sizeof(mprim_cache_prim_t), out_prims.size(), file) == out_prims.size() &&
+                fwrite(out_poses.data(), sizeof(mprim_cache_pose_t), out_poses.size(), file) == out_poses.size();
+    good = (fclose(file) == 0) && good;
+    if(!good || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+mprim_cache_file::mprim_cache_file() :
+    m_data(NULL),
+    m_size(0)
+{
+
+}
+
+mprim_cache_file::~mprim_cache_file()
+{
+    close();
+}
+
+bool mprim_cache_file::open(const std::string& path)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(mprim_cache_header_t)) {
+        ::close(fd);
+        return false;
+    }
+    void* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(data == MAP_FAILED) {
+        return false;
+    }
+    m_data = data;
+    m_size = info.st_size;
+
+    const mprim_cache_header_t& head = header();
+    if(head.magic != MPRIM_CACHE_MAGIC || head.version != MPRIM_CACHE_VERSION ||
+            head.prim_count < 0 || head.pose_count < 0 ||
+            m_size != sizeof(mprim_cache_header_t) + head.prim_count * sizeof(mprim_cache_prim_t) +
+            head.pose_count * sizeof(mprim_cache_pose_t)) {
+        close();
+        return false;
+    }
+    for(int i = 0; i < head.prim_count; i++) {
+        const mprim_cache_prim_t& prim = prims()[i];
+        if(prim.first_pose < 0 || prim.pose_count < 0 || prim.first_pose > head.pose_count - prim.pose_count) {
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void mprim_cache_file::close()
+{
+    if(m_data != NULL) {
+        munmap(m_data, m_size);
+    }
+    m_data = NULL;
+    m_size = 0;
+}
+
+const mprim_cache_header_t& mprim_cache_file::header() const
+{
+    return *(const mprim_cache_header_t*)m_data;
+}
+
+const mprim_cache_prim_t* mprim_cache_file::prims() const
+{
+    return (const mprim_cache_prim_t*)((const char*)m_data + sizeof(mprim_cache_header_t));
+}
+
+const mprim_cache_pose_t* mprim_cache_file::poses() const
+{
+    return (const mprim_cache_pose_t*)(prims() + header().prim_count);
+}
+
+void mprim_cache_file::append_to(std::vector<SBPL_xytheta_mprimitive>& prims) const
+{
+    const mprim_cache_header_t& head = header();
+    prims.reserve(prims.size() + head.prim_count);
+    for(int i = 0; i < head.prim_count; i++) {
+        const mprim_cache_prim_t& cached = this->prims()[i];
+        SBPL_xytheta_mprimitive prim = SBPL_xytheta_mprimitive();
+        prim.motprimID = cached.id;
+        prim.starttheta_c = cached.start_theta;
+        prim.additionalactioncostmult = cached.cost_mult;
+        prim.endcell.x = cached.end_x;
+        prim.endcell.y = cached.end_y;
+        prim.endcell.theta = cached.end_theta;
+        const mprim_cache_pose_t* pose = poses() + cached.first_pose;
+        prim.intermptV.reserve(cached.pose_count);
+        for(int p = 0; p < cached.pose_count; p++, pose++) {
+            prim.intermptV.push_back(sbpl_xy_theta_pt_t(pose->x, pose->y, pose->theta));
+        }
+        prims.push_back(prim);
+    }
+}
+
+mprim_cache_environment::mprim_cache_environment() :
+    m_mprim_cache_hit(false)
+{
+
+}
+
+void mprim_cache_environment::set_mprim_cache_file(const std::string& path)
+{
+    m_mprim_cache_file = path;
+}
+
+bool mprim_cache_environment::mprim_cache_hit() const
+{
+    return m_mprim_cache_hit;
+}
+
+/*
+ * Called by InitializeEnv with the opened .mprim file.
+ * Uses the cache when it matches the file, else parses the text and writes the cache.
+ */
+bool mprim_cache_environment::ReadMotionPrimitives(FILE* fMotPrims)
+{
+    m_mprim_cache_hit = false;
+    if(m_mprim_cache_file.empty()) {
+        return EnvironmentNAVXYTHETALAT::ReadMotionPrimitives(fMotPrims);
+    }
+
+    uint64_t source_size = 0;
+    uint64_t source_checksum = 0;
+    if(!checksum_file(fMotPrims, source_size, source_checksum)) {
+        rewind(fMotPrims);
+        return EnvironmentNAVXYTHETALAT::ReadMotionPrimitives(fMotPrims);
+    }
+    if(read_mprim_cache(source_size, source_checksum)) {
+        m_mprim_cache_hit = true;
+        return true;
+    }
+
+    rewind(fMotPrims);
+    size_t first = EnvNAVXYTHETALATCfg.mprimV.size();
+    if(!EnvironmentNAVXYTHETALAT::ReadMotionPrimitives(fMotPrims)) {
+        return false;
+    }
+
+    mprim_cache_header_t header = mprim_cache_header_t();
+    header.source_size = source_size;
+    header.source_checksum = source_checksum;
+    header.resolution_m = EnvNAVXYTHETALATCfg.cellsize_m;
+    header.angle_count = EnvNAVXYTHETALATCfg.NumThetaDirs;
+    std::vector<SBPL_xytheta_mprimitive> prims(EnvNAVXYTHETALATCfg.mprimV.begin() + first,
+            EnvNAVXYTHETALATCfg.mprimV.end());
+    if(!write_mprim_cache(m_mprim_cache_file, header, prims)) {
+        std::cout << "Could not write the motion primitive cache " << m_mprim_cache_file << std::endl;
+    }
+    return true;
+}
+
+bool mprim_cache_environment::read_mprim_cache(uint64_t source_size, uint64_t source_checksum)
+{
+    mprim_cache_file cache;
+    if(!cache.open(m_mprim_cache_file)) {
+        return false;
+    }
+    const mprim_cache_header_t& header = cache.header();
+    if(header.source_size != source_size || header.source_checksum != source_checksum) {
+        //The .mprim file changed since the cache was written
+        return false;
+    }
+    if(std::fabs(header.resolution_m - EnvNAVXYTHETALATCfg.cellsize_m) > 1e-5 ||
+            header.angle_count != EnvNAVXYTHETALATCfg.NumThetaDirs) {
+        //SBPL would have refused this file, let the text reader say why
+        return false;
+    }
+    cache.append_to(EnvNAVXYTHETALATCfg.mprimV);
+    return true;
+}
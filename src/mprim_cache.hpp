@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+// mprim_cache.h - Compiled motion primitive cache - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef MPRIM_CACHE_H
+#define MPRIM_CACHE_H
+
+#include <sbpl/headers.h>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// The compiled primitives of foo.mprim are kept next to it in foo.mprim.bin
+#define MPRIM_CACHE_SUFFIX ".bin"
+
+#define MPRIM_CACHE_MAGIC 0x4d505244 // "DRPM" read as a little endian uint32
+#define MPRIM_CACHE_VERSION 1
+
+/*
+ * Cache file layout, native byte order (it is only ever read on the machine
+ * that wrote it, the magic catches anything else):
+ * mprim_cache_header_t, prim_count mprim_cache_prim_t, pose_count mprim_cache_pose_t
+ */
+struct mprim_cache_header_t {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t source_size; //Bytes in the .mprim file
+    uint64_t source_checksum; //FNV-1a of the .mprim file
+    double resolution_m;
+    int32_t angle_count;
+    int32_t prim_count;
+    int32_t pose_count;
+    int32_t reserved;
+};
+
+struct mprim_cache_prim_t {
+    int32_t id;
+    int32_t start_theta;
+    int32_t cost_mult;
+    int32_t end_x;
+    int32_t end_y;
+    int32_t end_theta;
+    int32_t first_pose; //Index of the first intermediate pose
+    int32_t pose_count;
+};
+
+struct mprim_cache_pose_t {
+    double x;
+    double y;
+    double theta;
+};
+
+// 64 bit FNV-1a of a buffer. Pass the result back in as seed to hash more data.
+uint64_t fnv1a_64(const void* data, size_t size, uint64_t seed = 14695981039346656037ULL);
+
+/*
+ * Reads an open file from the start to the end and returns its size and checksum.
+ * Leaves the file at the end.
+ */
+bool checksum_file(FILE* file, uint64_t& size, uint64_t& checksum);
+
+/*
+ * Writes primitives to a cache file. Written to a temporary file, then
+ * renamed, so a crash never leaves half a cache behind.
+ */
+bool write_mprim_cache(const std::string& path, const mprim_cache_header_t& header,
+                       const std::vector<SBPL_xytheta_mprimitive>& prims);
+
+/*
+ * A cache file mapped into memory. Checks the layout on open, the caller
+ * checks that the header matches its .mprim file.
+ */
+class mprim_cache_file {
+public:
+    mprim_cache_file();
+    ~mprim_cache_file();
+
+    // Maps path, false if it is missing or is not a valid cache
+    bool open(const std::string& path);
+    void close();
+
+    const mprim_cache_header_t& header() const;
+    const mprim_cache_prim_t* prims() const;
+    const mprim_cache_pose_t* poses() const;
+
+    // Appends the primitives to prims, the way SBPL's text reader does
+    void append_to(std::vector<SBPL_xytheta_mprimitive>& prims) const;
+
+private:
+    mprim_cache_file(const mprim_cache_file&);
+    mprim_cache_file& operator=(const mprim_cache_file&);
+
+    void* m_data;
+    size_t m_size;
+};
+
+/*
+ * The SBPL lattice environment, loading motion primitives from a compiled
+ * cache instead of parsing the .mprim text with fscanf.
+ *
+ * The cache is checked against the size and checksum of the .mprim file
+ * SBPL opened. When it is missing or stale the text is parsed as usual and
+ * the cache is written for next time.
+ */
+class mprim_cache_environment : public EnvironmentNAVXYTHETALAT {
+public:
+    mprim_cache_environment();
+
+    // Cache file used by the next InitializeEnv, empty turns the cache off
+    void set_mprim_cache_file(const std::string& path);
+    // True if the last InitializeEnv got its primitives from the cache
+    bool mprim_cache_hit() const;
+
+protected:
+    virtual bool ReadMotionPrimitives(FILE* fMotPrims);
+
+    // Fills the primitives from the cache if it matches the source, false if it does not
+    bool read_mprim_cache(uint64_t source_size, uint64_t source_checksum);
+
+    std::string m_mprim_cache_file;
+    bool m_mprim_cache_hit;
+};
+
+#endif /* MPRIM_CACHE_H */
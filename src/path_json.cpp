@@ -0,0 +1,71 @@
+///////////////////////////////////////////////////////////////////////////////
+// path_json.cpp - Path serialization for /api/path - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "path_json.hpp"
+#include "util.hpp"
+
+#include <cmath>
+
+// Longest point, {"x":-1234567.123,"y":...} with room to spare
+#define PATH_JSON_POINT_SIZE 64
+
+/*
+ * Appends value with three decimals. Integer arithmetic only, no locale and no
+ * stream state, so it is the same everywhere and a lot cheaper than printf.
+ */
+static void append_fixed3(std::string& out, double value)
+{
+    long long thousandths = std::llround(value * 1000.0);
+    if(thousandths < 0) {
+        out += '-';
+        thousandths = -thousandths;
+    }
+    char digits[24];
+    int length = 0;
+    long long whole = thousandths / 1000;
+    do {
+        digits[length++] = '0' + whole % 10;
+        whole /= 10;
+    } while(whole != 0);
+    while(length > 0) {
+        out += digits[--length];
+    }
+    int fraction = thousandths % 1000;
+    out += '.';
+    out += '0' + fraction / 100;
+    out += '0' + fraction / 10 % 10;
+    out += '0' + fraction % 10;
+}
+
+void write_path_json(const std::vector<sbpl_xy_theta_pt_t>& path, std::string& out)
+{
+    out.clear();
+    out.reserve(16 + path.size() * PATH_JSON_POINT_SIZE);
+    out += "{\"path\":[";
+    for(size_t i = 0; i < path.size(); i++) {
+        out += i == 0 ? "{\"x\":" : ",{\"x\":";
+        append_fixed3(out, path[i].x);
+        out += ",\"y\":";
+        append_fixed3(out, path[i].y);
+        out += ",\"theta\":";
+        append_fixed3(out, RAD_TO_DEG(path[i].theta));
+        out += '}';
+    }
+    out += "]}";
+}
@@ -0,0 +1,40 @@
+///////////////////////////////////////////////////////////////////////////////
+// path_json.h - Path serialization for /api/path - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef PATH_JSON_H
+#define PATH_JSON_H
+
+#include <sbpl/headers.h>
+
+#include <string>
+#include <vector>
+
+// Content type of a posted path
+#define PATH_JSON_CONTENT_TYPE "application/json"
+
+/*
+ * Writes a path as the /api/path body, replacing what out held:
+ * {"path":[{"x":1.000,"y":2.500,"theta":90.000},...]}
+ * x and y are in meters like the path, theta in degrees like the grid's
+ * location and goal, each with three decimals. Written straight into out,
+ * keep out around to reuse its memory.
+ */
+void write_path_json(const std::vector<sbpl_xy_theta_pt_t>& path, std::string& out);
+
+#endif /* PATH_JSON_H */
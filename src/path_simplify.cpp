@@ -0,0 +1,154 @@
+///////////////////////////////////////////////////////////////////////////////
+// path_simplify.cpp - Sparse waypoints from lattice paths - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "path_simplify.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/*
+ * Cost of the cell under a point in meters, 255 off the grid
+ */
+static unsigned char cost_at(const path_grid_t& grid, double x, double y)
+{
+    int cell_x = CONTXY2DISC(x, grid.cellsize_m);
+    int cell_y = CONTXY2DISC(y, grid.cellsize_m);
+    if(cell_x < 0 || cell_y < 0 || cell_x >= grid.width || cell_y >= grid.height) {
+        return 255;
+    }
+    return grid.columns[cell_x][cell_y];
+}
+
+/*
+ * Distance from p to the segment a b, or to a if the segment has no length
+ */
+static double segment_distance(const sbpl_xy_theta_pt_t& p, const sbpl_xy_theta_pt_t& a, const sbpl_xy_theta_pt_t& b)
+{
+    double dx = b.x - a.x;
+    double dy = b.y - a.y;
+    double length2 = dx * dx + dy * dy;
+    double t = 0;
+    if(length2 > 0) {
+        t = std::max(0.0, std::min(1.0, ((p.x - a.x) * dx + (p.y - a.y) * dy) / length2));
+    }
+    return std::hypot(p.x - (a.x + t * dx), p.y - (a.y + t * dy));
+}
+
+/*
+ * Walks the cells the segment crosses in order (Amanatides and Woo), so no
+ * cell is skipped however steep the segment is.
+ */
+bool segment_clear(const path_grid_t& grid, double x0, double y0, double x1, double y1, unsigned char max_cost)
+{
+    double fx = x0 / grid.cellsize_m;
+    double fy = y0 / grid.cellsize_m;
+    double dx = x1 / grid.cellsize_m - fx;
+    double dy = y1 / grid.cellsize_m - fy;
+    int cell_x = (int)std::floor(fx);
+    int cell_y = (int)std::floor(fy);
+    int end_x = (int)std::floor(x1 / grid.cellsize_m);
+    int end_y = (int)std::floor(y1 / grid.cellsize_m);
+    int step_x = dx > 0 ? 1 : -1;
+    int step_y = dy > 0 ? 1 : -1;
+    const double inf = std::numeric_limits<double>::infinity();
+    //Fraction of the segment to the next cell edge, and per cell
+    double t_delta_x = dx != 0 ? std::fabs(1.0 / dx) : inf;
+    double t_delta_y = dy != 0 ? std::fabs(1.0 / dy) : inf;
+    double t_max_x = dx != 0 ? ((dx > 0 ? cell_x + 1 - fx : fx - cell_x) * t_delta_x) : inf;
+    double t_max_y = dy != 0 ? ((dy > 0 ? cell_y + 1 - fy : fy - cell_y) * t_delta_y) : inf;
+
+    int cells = std::abs(end_x - cell_x) + std::abs(end_y - cell_y) + 1;
+    for(int i = 0; i < cells; i++) {
+        if(cell_x < 0 || cell_y < 0 || cell_x >= grid.width || cell_y >= grid.height ||
+                grid.columns[cell_x][cell_y] > max_cost) {
+            return false;
+        }
+        if(t_max_x < t_max_y) {
+            t_max_x += t_delta_x;
+            cell_x += step_x;
+        } else {
+            t_max_y += t_delta_y;
+            cell_y += step_y;
+        }
+    }
+    return true;
+}
+
+/*
+ * Stretches are split with an explicit stack, paths can have tens of thousands
+ * of poses. Every pose's cost is looked up once up front.
+ */
+void simplify_path(const std::vector<sbpl_xy_theta_pt_t>& path, const path_grid_t& grid, double tolerance_m,
+                   std::vector<sbpl_xy_theta_pt_t>& waypoints)
+{
+    waypoints.clear();
+    if(path.size() <= 2) {
+        waypoints = path;
+        return;
+    }
+
+    std::vector<unsigned char> costs(path.size());
+    for(size_t i = 0; i < path.size(); i++) {
+        costs[i] = cost_at(grid, path[i].x, path[i].y);
+    }
+    std::vector<char> keep(path.size(), 0);
+    keep.front() = 1;
+    keep.back() = 1;
+
+    std::vector<std::pair<size_t, size_t> > stretches;
+    stretches.push_back(std::make_pair((size_t)0, path.size() - 1));
+    while(!stretches.empty()) {
+        size_t first = stretches.back().first;
+        size_t last = stretches.back().second;
+        stretches.pop_back();
+        if(last <= first + 1) {
+            continue;
+        }
+
+        size_t farthest = first + 1;
+        double farthest_distance = -1;
+        unsigned char max_cost = std::max(costs[first], costs[last]);
+        for(size_t i = first + 1; i < last; i++) {
+            double distance = segment_distance(path[i], path[first], path[last]);
+            if(distance > farthest_distance) {
+                farthest_distance = distance;
+                farthest = i;
+            }
+            max_cost = std::max(max_cost, costs[i]);
+        }
+        if(farthest_distance <= tolerance_m &&
+                segment_clear(grid, path[first].x, path[first].y, path[last].x, path[last].y, max_cost)) {
+            continue;
+        }
+        if(farthest_distance <= 0) {
+            //Straight but blocked, the segment clips a corner the poses go around
+            farthest = (first + last) / 2;
+        }
+        keep[farthest] = 1;
+        stretches.push_back(std::make_pair(first, farthest));
+        stretches.push_back(std::make_pair(farthest, last));
+    }
+
+    for(size_t i = 0; i < path.size(); i++) {
+        if(keep[i]) {
+            waypoints.push_back(path[i]);
+        }
+    }
+}
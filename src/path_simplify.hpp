@@ -0,0 +1,56 @@
+///////////////////////////////////////////////////////////////////////////////
+// path_simplify.h - Sparse waypoints from lattice paths - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef PATH_SIMPLIFY_H
+#define PATH_SIMPLIFY_H
+
+#include <sbpl/headers.h>
+
+#include <utility>
+#include <vector>
+
+// How far, in meters, the waypoints may stray from the planned path by default
+#define PATH_SIMPLIFY_DEFAULT_TOLERANCE_M 0.5
+
+// A read only cost grid in SBPL's layout, columns[x][y]
+struct path_grid_t {
+    const unsigned char* const* columns;
+    int width;
+    int height;
+    double cellsize_m;
+};
+
+/*
+ * Reduces a lattice path to the waypoints between which it is straight.
+ *
+ * Douglas-Peucker: a stretch of the path is replaced by the straight segment
+ * between its ends if no pose on it is more than tolerance_m from the segment,
+ * and every cell the segment crosses costs no more than the most expensive cell
+ * the stretch itself goes through. Otherwise it is split at the pose farthest
+ * from the segment and both halves are tried again. A shortcut never gets closer
+ * to an obstacle than the path did, and the first and last poses are always kept.
+ * Waypoints keep the heading of their pose. Turns in place collapse to one waypoint.
+ */
+void simplify_path(const std::vector<sbpl_xy_theta_pt_t>& path, const path_grid_t& grid, double tolerance_m,
+                   std::vector<sbpl_xy_theta_pt_t>& waypoints);
+
+// True if every cell the segment between two points in meters crosses is on the grid and costs at most max_cost
+bool segment_clear(const path_grid_t& grid, double x0, double y0, double x1, double y1, unsigned char max_cost);
+
+#endif /* PATH_SIMPLIFY_H */
@@ -18,11 +18,46 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "plan.hpp"
+#include "metrics.hpp"
 
-Planner::Planner(): planning_time(10.0),
-    initial_epsilon(3.0),
-    search_forward(false),
-    changed(false)
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+
+/*
+ * Length of a path in meters, ignoring turns in place
+ */
+static double path_length(const std::vector<sbpl_xy_theta_pt_t> &path)
+{
+    double length = 0;
+    for(size_t i = 1; i < path.size(); i++) {
+        length += std::hypot(path[i].x - path[i - 1].x, path[i].y - path[i - 1].y);
+    }
+    return length;
+}
+
+Planner::Planner(): Planner(DEFAULT_PLANNER_CONFIG)
+{
+
+}
+
+Planner::Planner(const planner_config_t &config): planner_type(config.type),
+    planning_time(10.0),
+    initial_epsilon(config.initial_epsilon),
+    search_forward(config.search_forward),
+    changed(false),
+    last_plan_good(false),
+    m_path_current(false),
+    m_cheaper_updates(0),
+    first_solution(false),
+    m_name(config.name),
+    m_preempt(false),
+    m_corridor_params({0, CORRIDOR_DEFAULT_BUFFER}),
+    m_in_corridor(false),
+    m_cellsize_m(1.0),
+    m_obs_thresh(0),
+    m_start_x(0), m_start_y(0), m_start_theta(0),
+    m_goal_x(0), m_goal_y(0), m_goal_theta(0)
 {
 
 }
@@ -34,15 +69,39 @@ Planner::~Planner()
 }
 
 /*
- * Actually do the planning
+ * Actually do the planning, for at most planning_time seconds
  * Returns 0 if path exists, else Planner::PATH_EXISTS
  */
 int Planner::plan()
 {
+    auto budget = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                      std::chrono::duration<double>(planning_time));
+    return plan_until(std::chrono::steady_clock::now() + budget);
+}
+
+/*
+ * Anytime planning against a wall clock deadline.
+ * replan() only returns once its time is up or the solution is optimal, so it
+ * is called in slices of at most PLAN_SLICE_S. AD* and ARA* keep their search
+ * between calls and every slice picks up where the last one stopped. Whenever
+ * a slice ends with a lower epsilon than before the path is published through
+ * the solution callback and latest_solution(). Stops on an optimal solution,
+ * on the first one with set_first_solution(true), on preempt() or at the deadline.
+ * replan() budgets a slice with clock(), the CPU time of the whole process, so
+ * with other threads busy a slice ends early in wall time. A slice only counts
+ * as out of states when it also used well under its CPU time.
+ * Returns Planner::PATH_EXISTS if a path was found, else 0
+ */
+int Planner::plan_until(std::chrono::steady_clock::time_point deadline)
+{
+    if(m_planner == NULL) {
+        return 0;
+    }
 
     if(changed) {
 
         if(dynamic_cast<ADPlanner*>(m_planner) != NULL) {
+            metric_timer timer(METRIC_CHANGED_EDGES);
             //Get changed states and update them.
             if(search_forward) {
                 std::vector<int> succs_of_changed;
@@ -62,14 +121,57 @@ int Planner::plan()
 
     }
 
+    auto start = std::chrono::steady_clock::now();
     std::vector<int> solution_IDs;
-    bool path_exists = (m_planner->replan(planning_time, &solution_IDs) == 1);
-
-    //Maybe print out something here about the path
+    bool path_exists = false;
+    double best_epsilon = 0;
+    uint64_t expansions = 0;
     xythetaPath.clear();
-    m_env.ConvertStateIDPathintoXYThetaPath(&solution_IDs, &xythetaPath);
+
+    while(!m_preempt) {
+        auto slice_start = std::chrono::steady_clock::now();
+        double remaining = std::chrono::duration<double>(deadline - slice_start).count();
+        if(remaining <= 0) {
+            break;
+        }
+        double slice = std::min(remaining, PLAN_SLICE_S);
+        clock_t slice_clock = clock();
+        solution_IDs.clear();
+        int cost = 0;
+        int replanned = m_planner->replan(slice, &solution_IDs, &cost);
+        expansions += m_planner->get_n_expands();
+        if(replanned != 1) {
+            //Returning well before its time is up means the search ran out of states
+            double slice_wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - slice_start).count();
+            double slice_cpu = (double)(clock() - slice_clock) / CLOCKS_PER_SEC;
+            if(slice_wall < slice / 2 && slice_cpu < slice / 2) {
+                //In the corridor that can just mean the coarse grid missed the way through
+                if(!path_exists && m_in_corridor && leave_corridor() == 0) {
+                    continue;
+                }
+                break;
+            }
+            continue;
+        }
+        double epsilon = m_planner->get_solution_eps();
+        if(!path_exists || epsilon < best_epsilon) {
+            path_exists = true;
+            best_epsilon = epsilon;
+            xythetaPath.clear();
+            m_env.ConvertStateIDPathintoXYThetaPath(&solution_IDs, &xythetaPath);
+            publish_solution(cost, epsilon, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+        if(first_solution || epsilon <= 1.0) {
+            break;
+        }
+    }
 
     last_plan_good = path_exists;
+    m_path_current = path_exists && best_epsilon <= 1.0;
+    m_cheaper_updates = 0;
+    index_path_cells();
+    metrics().stages[METRIC_REPLAN].record(std::chrono::steady_clock::now() - start);
+    metrics().record_search(path_exists, expansions, path_exists ? best_epsilon : 0.0, path_length(xythetaPath));
 
     if(path_exists) {
         return Planner::PATH_EXISTS;
@@ -79,19 +181,113 @@ int Planner::plan()
 
 }
 
+/*
+ * Hands the current path to whoever is waiting on it
+ */
+void Planner::publish_solution(int cost, double epsilon, double seconds)
+{
+    std::shared_ptr<plan_solution_t> solution = std::make_shared<plan_solution_t>();
+    solution->path = xythetaPath;
+    solution->cost = cost;
+    solution->epsilon = epsilon;
+    solution->seconds = seconds;
+    solution->grid_generation = grid_generation();
+    m_solution.store(solution);
+    if(m_solution_callback) {
+        m_solution_callback(solution);
+    }
+}
+
+/*
+ * Lets the search out of the corridor for good: the cells outside get back their
+ * cost from the snapshot, or the last update_grid_points() gave them, and the
+ * search starts over on the whole grid. Its states are kept by the environment.
+ * returns 0 on success, otherwise some error code
+ */
+int Planner::leave_corridor()
+{
+    const env_data_t &env_data = m_snapshot->data;
+    const tiled_grid &grid = *env_data.grid_2d;
+    for(int y = 0; y < env_data.height; y++) {
+        for(int x = 0; x < env_data.width; x++) {
+            unsigned char cost = grid.cost(x, y);
+            if(cost != m_obs_thresh && !m_corridor.contains(x, y)) {
+                m_env.UpdateCost(x, y, cost);
+            }
+        }
+    }
+    for(auto it = m_outside_costs.begin(); it != m_outside_costs.end(); it++) {
+        m_env.UpdateCost(it->first % env_data.width, it->first / env_data.width, it->second);
+    }
+    m_outside_costs.clear();
+    m_corridor.clear();
+    m_in_corridor = false;
+
+    //A new search, nothing of the old one is worth repairing
+    changed_cells.clear();
+    changed = false;
+    delete m_planner;
+    m_planner = NULL;
+    if(init_planner() != 0) {
+        return 1;
+    }
+    if(set_planner_states(MDPCfg.startstateid, MDPCfg.goalstateid) != 0) {
+        return 2;
+    }
+    return 0;
+}
+
+bool Planner::outside_corridor(int x, int y) const
+{
+    if(!m_in_corridor) {
+        return false;
+    }
+    int cell_x = CONTXY2DISC(x, m_cellsize_m);
+    int cell_y = CONTXY2DISC(y, m_cellsize_m);
+    const env_data_t &env_data = m_snapshot->data;
+    if(cell_x < 0 || cell_y < 0 || cell_x >= env_data.width || cell_y >= env_data.height) {
+        //Off the map, SBPL turns it down
+        return false;
+    }
+    return !m_corridor.contains(cell_x, cell_y);
+}
+
 /*
  * initialize the planner based on data give to us
+ * The snapshot is kept, so the grid it was built from stays alive with the planner.
+ * SBPL starts from an empty grid and only the tiles with obstacles are copied in.
+ * With a corridor set, everything outside the corridor is then blocked, so neither
+ * its 2D heuristic nor the lattice search expand past it. Without a coarse path
+ * the whole grid is used.
  * returns 0 on success, otherwise some error code
  */
-int Planner::initialize(env_data_t &env_data, env_constants_t &env_const)
+int Planner::initialize(env_snapshot_ptr snapshot, env_constants_t &env_const)
 {
+    if(snapshot == NULL) {
+        return 1;
+    }
     if(m_planner == NULL) {
         if(init_planner() != 0) {
             return 1;
         }
     }
+    m_snapshot = snapshot;
+    m_preempt = false;
+    const env_data_t &env_data = snapshot->data;
     changed = true;
-    bool ret = m_env.InitializeEnv(env_data.width, env_data.height, env_data.grid_2d,
+
+    m_cellsize_m = env_const.cellsize_m;
+    m_obs_thresh = env_const.obs_thresh;
+    m_outside_costs.clear();
+    m_in_corridor = m_corridor_params.scale > 0 &&
+                    m_corridor.build(*env_data.grid_2d,
+                                     CONTXY2DISC(env_data.start_x, m_cellsize_m), CONTXY2DISC(env_data.start_y, m_cellsize_m),
+                                     CONTXY2DISC(env_data.end_x, m_cellsize_m), CONTXY2DISC(env_data.end_y, m_cellsize_m),
+                                     m_obs_thresh, m_corridor_params);
+
+    //Load the compiled primitives next to the .mprim file, made on the first run
+    m_env.set_mprim_cache_file(std::string(env_const.motion_prim_file) + MPRIM_CACHE_SUFFIX);
+    bool ret = m_env.InitializeEnv(env_data.width, env_data.height, NULL,
                                    env_data.start_x, env_data.start_y, DEG_TO_RAD(env_data.start_theta % 360),
                                    env_data.end_x, env_data.end_y, DEG_TO_RAD(env_data.end_theta % 360),
                                    0.0, 0.0, 0.0, //These params are unused
@@ -102,6 +298,10 @@ int Planner::initialize(env_data_t &env_data, env_constants_t &env_const)
         //Failed to initialize env
         return 1;
     }
+    env_data.grid_2d->copy_columns(m_env.grid_columns());
+    if(m_in_corridor) {
+        m_corridor.mask_columns(m_env.grid_columns(), m_obs_thresh);
+    }
     if(!m_env.InitializeMDPCfg(&MDPCfg)) {
         return 2;
     }
@@ -111,22 +311,123 @@ int Planner::initialize(env_data_t &env_data, env_constants_t &env_const)
     if (m_planner->set_goal(MDPCfg.goalstateid) == 0) {
         return 4;
     }
+    m_path_current = false;
+    m_start_x = env_data.start_x;
+    m_start_y = env_data.start_y;
+    m_start_theta = env_data.start_theta;
+    m_goal_x = env_data.end_x;
+    m_goal_y = env_data.end_y;
+    m_goal_theta = env_data.end_theta;
+    return 0;
+}
+
+/*
+ * Moves the start of the search to a new pose without rebuilding the environment.
+ * ADPlanner keeps what it already searched, so this is much cheaper than initialize().
+ * returns 0 on success, otherwise some error code
+ */
+int Planner::set_start(int x, int y, int theta)
+{
+    if(m_planner == NULL || m_snapshot == NULL) {
+        return 1;
+    }
+    m_preempt = false;
+    if(x == m_start_x && y == m_start_y && theta == m_start_theta) {
+        return 0;
+    }
+    if(outside_corridor(x, y) && leave_corridor() != 0) {
+        return 3;
+    }
+    int start_state_id = m_env.SetStart(x, y, DEG_TO_RAD(theta % 360));
+    if(start_state_id < 0) {
+        //Off the map
+        return 2;
+    }
+    MDPCfg.startstateid = start_state_id;
+    if(set_planner_states(MDPCfg.startstateid, MDPCfg.goalstateid) != 0) {
+        return 3;
+    }
+    m_start_x = x;
+    m_start_y = y;
+    m_start_theta = theta;
+    //Moving along an optimal path leaves the rest of it optimal
+    if(m_path_current && trim_path_to(x, y, theta)) {
+        index_path_cells();
+    } else {
+        m_path_current = false;
+    }
+    return 0;
+}
+
+/*
+ * Moves the goal of the search without rebuilding the environment.
+ * returns 0 on success, otherwise some error code
+ */
+int Planner::set_goal(int x, int y, int theta)
+{
+    if(m_planner == NULL || m_snapshot == NULL) {
+        return 1;
+    }
+    m_preempt = false;
+    if(x == m_goal_x && y == m_goal_y && theta == m_goal_theta) {
+        return 0;
+    }
+    if(outside_corridor(x, y) && leave_corridor() != 0) {
+        return 3;
+    }
+    int goal_state_id = m_env.SetGoal(x, y, DEG_TO_RAD(theta % 360));
+    if(goal_state_id < 0) {
+        //Off the map
+        return 2;
+    }
+    MDPCfg.goalstateid = goal_state_id;
+    if(set_planner_states(MDPCfg.startstateid, MDPCfg.goalstateid) != 0) {
+        return 3;
+    }
+    m_goal_x = x;
+    m_goal_y = y;
+    m_goal_theta = theta;
+    m_path_current = false;
     return 0;
 }
 
+unsigned long Planner::grid_generation() const
+{
+    return m_snapshot == NULL ? 0 : m_snapshot->grid_generation;
+}
+
 /*
  * Updates the dynamic points of the graph. Used for moving obstacles
+ * points holds only the cells that changed, with their composed cost.
  */
-int Planner::update_grid_points(point_char_map &points)
+int Planner::update_grid_points(const cell_update_list &points)
 {
+    metric_timer timer(METRIC_UPDATE_COST);
     nav2dcell_t nav2dcell;
+    bool cheaper = false;
+    changed_cells.reserve(changed_cells.size() + points.size());
     for(auto it = points.begin(); it != points.end(); it++) {
-        m_env.UpdateCost(it->first.first, it->first.second, it->second);
-        nav2dcell.x = it->first.first;
-        nav2dcell.y = it->first.second;
+        if(m_path_current && std::binary_search(m_path_cells.begin(), m_path_cells.end(),
+                                                it->x + it->y * m_snapshot->data.width)) {
+            m_path_current = false;
+        }
+        if(m_in_corridor && !m_corridor.contains(it->x, it->y)) {
+            //Stays blocked, kept for when the search leaves the corridor
+            m_outside_costs[it->x + it->y * m_snapshot->data.width] = it->cost;
+            continue;
+        }
+        cheaper = cheaper || it->cost < m_env.GetMapCost(it->x, it->y);
+        m_env.UpdateCost(it->x, it->y, it->cost);
+        nav2dcell.x = it->x;
+        nav2dcell.y = it->y;
         changed_cells.push_back(nav2dcell);
     }
+    //A cell that got cheaper may open a shorter way than the kept path
+    if(cheaper && m_path_current && ++m_cheaper_updates >= PLAN_KEEP_CHEAPER_UPDATES) {
+        m_path_current = false;
+    }
     changed = true;
+    m_preempt = false;
 
     return 0;
 }
@@ -136,7 +437,11 @@ int Planner::update_grid_points(point_char_map &points)
  */
 int Planner::init_planner()
 {
-    m_planner = new ADPlanner(&m_env, search_forward);
+    if(planner_type == PLANNER_ARA) {
+        m_planner = new ARAPlanner(&m_env, search_forward);
+    } else {
+        m_planner = new ADPlanner(&m_env, search_forward);
+    }
 
     m_planner->set_initialsolution_eps(initial_epsilon);
     m_planner->set_search_mode(false); // Search beyond first solution
@@ -166,9 +471,142 @@ int Planner::set_planner_states(int start_state_id, int goal_state_id)
  */
 std::vector<sbpl_xy_theta_pt_t> Planner::get_path()
 {
+    return path();
+}
+
+const std::vector<sbpl_xy_theta_pt_t>& Planner::path() const
+{
+    static const std::vector<sbpl_xy_theta_pt_t> no_path;
+    return last_plan_good ? xythetaPath : no_path;
+}
+
+std::vector<sbpl_xy_theta_pt_t> Planner::take_path()
+{
+    std::vector<sbpl_xy_theta_pt_t> taken;
     if(last_plan_good) {
-        return xythetaPath;
-    } else {
-        return std::vector<sbpl_xy_theta_pt_t>();
+        taken.swap(xythetaPath);
+        last_plan_good = false;
+        m_path_current = false;
     }
+    return taken;
+}
+
+void Planner::set_heuristic_pool(thread_pool* pool)
+{
+    m_env.set_heuristic_pool(pool);
+}
+
+bool Planner::path_current() const
+{
+    return m_path_current;
+}
+
+/*
+ * Finds the first pose of the path in the start's cell and heading bin and
+ * drops every pose before it. The poses from there on are the path the search
+ * would find from the new start, as long as nothing under them changed.
+ */
+bool Planner::trim_path_to(int x, int y, int theta)
+{
+    int theta_dirs = m_env.GetEnvNavConfig()->NumThetaDirs;
+    int cell_x = CONTXY2DISC(x, m_cellsize_m);
+    int cell_y = CONTXY2DISC(y, m_cellsize_m);
+    int heading = ContTheta2Disc(DEG_TO_RAD(theta % 360), theta_dirs);
+    for(size_t i = 0; i < xythetaPath.size(); i++) {
+        const sbpl_xy_theta_pt_t& pose = xythetaPath[i];
+        if(CONTXY2DISC(pose.x, m_cellsize_m) == cell_x && CONTXY2DISC(pose.y, m_cellsize_m) == cell_y &&
+                ContTheta2Disc(pose.theta, theta_dirs) == heading) {
+            xythetaPath.erase(xythetaPath.begin(), xythetaPath.begin() + i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void Planner::index_path_cells()
+{
+    m_path_cells.clear();
+    if(!m_path_current) {
+        return;
+    }
+    for(const sbpl_xy_theta_pt_t& pose : xythetaPath) {
+        m_path_cells.push_back(CONTXY2DISC(pose.x, m_cellsize_m) +
+                               CONTXY2DISC(pose.y, m_cellsize_m) * m_snapshot->data.width);
+    }
+    std::sort(m_path_cells.begin(), m_path_cells.end());
+    m_path_cells.erase(std::unique(m_path_cells.begin(), m_path_cells.end()), m_path_cells.end());
+}
+
+void Planner::simplify_path(const std::vector<sbpl_xy_theta_pt_t>& path, double tolerance_m,
+                            std::vector<sbpl_xy_theta_pt_t>& waypoints)
+{
+    if(m_snapshot == NULL) {
+        waypoints = path;
+        return;
+    }
+    metric_timer timer(METRIC_SIMPLIFY);
+    path_grid_t grid = {m_env.grid_columns(), m_snapshot->data.width, m_snapshot->data.height, m_cellsize_m};
+    ::simplify_path(path, grid, tolerance_m, waypoints);
+}
+
+/*
+ * Sets the time limit of each plan() call
+ */
+void Planner::set_planning_time(double seconds)
+{
+    planning_time = seconds;
+}
+
+/*
+ * Sets the epsilon the search starts from. SBPL reads it when the search
+ * starts over, after initialize() or a new start or goal.
+ */
+void Planner::set_initial_epsilon(double epsilon)
+{
+    initial_epsilon = epsilon;
+    if(m_planner != NULL) {
+        m_planner->set_initialsolution_eps(initial_epsilon);
+    }
+}
+
+/*
+ * Worth it on large grids where start and goal are far apart compared to the
+ * corridor. Costs a max pooling pass over the grid and a coarse A* per initialize().
+ */
+void Planner::set_corridor(corridor_params_t params)
+{
+    m_corridor_params = params;
+}
+
+bool Planner::in_corridor() const
+{
+    return m_in_corridor;
+}
+
+void Planner::set_first_solution(bool first_solution)
+{
+    this->first_solution = first_solution;
+}
+
+/*
+ * The callback runs on the thread calling plan_until(), keep it short
+ */
+void Planner::set_solution_callback(solution_callback callback)
+{
+    m_solution_callback = callback;
+}
+
+plan_solution_ptr Planner::latest_solution() const
+{
+    return m_solution.load();
+}
+
+const char* Planner::name() const
+{
+    return m_name;
+}
+
+void Planner::preempt()
+{
+    m_preempt = true;
 }
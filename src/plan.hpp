@@ -21,22 +21,109 @@
 #define PLAN_H
 
 #include "communication.hpp" //For the types
+#include "corridor.hpp"
+#include "heuristic_env.hpp"
+#include "path_simplify.hpp"
 #include <sbpl/headers.h>
 #include "util.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+// Longest a single SBPL replan() call runs for, between two preemption checks. In seconds.
+#define PLAN_SLICE_S 0.05
+// Updates that made cells cheaper a kept path lives through, see path_current()
+#define PLAN_KEEP_CHEAPER_UPDATES 4
+
+// Search algorithms a Planner can run
+enum planner_type_t {
+    PLANNER_AD, //Anytime D*, repairs the search when costs change
+    PLANNER_ARA //ARA*, starts the search over when costs change
+};
+
+// Which search a Planner runs
+struct planner_config_t {
+    const char* name; //Used in logs
+    planner_type_t type;
+    bool search_forward; //Backwards keeps more of the search when the start moves
+    double initial_epsilon; //Bound of the first solution, lowered by 0.2 every improvement
+};
+
+// AD* searching backwards from epsilon 3, what Planner() uses
+const planner_config_t DEFAULT_PLANNER_CONFIG = {"ad_backward", PLANNER_AD, false, 3.0};
+
+// A path found by plan_until(), one per improvement of the solution
+struct plan_solution_t {
+    std::vector<sbpl_xy_theta_pt_t> path;
+    int cost; //Cost of the path as SBPL counts it
+    double epsilon; //Suboptimality bound of the path, 1.0 is optimal for the heuristic
+    double seconds; //Time from the start of plan_until() to this solution
+    unsigned long grid_generation; //Grid the path was planned on, see env_snapshot_t
+};
+
+typedef std::shared_ptr<const plan_solution_t> plan_solution_ptr;
+typedef std::function<void(plan_solution_ptr)> solution_callback;
+
 class Planner {
 public:
 
     static const int PATH_EXISTS = 1;
 
     Planner();
+    explicit Planner(const planner_config_t &config);
     virtual ~Planner();
 
     // TODO: Figure out the params for the following functions
-    int update_grid_points(point_char_map &points);
-    int initialize(env_data_t &env_data, env_constants_t &env_const);
+    int update_grid_points(const cell_update_list &points);
+    int initialize(env_snapshot_ptr snapshot, env_constants_t &env_const);
+    // Move the start or goal on the current environment, keeping the search. Theta in degrees.
+    int set_start(int x, int y, int theta);
+    int set_goal(int x, int y, int theta);
+    // Generation of the grid the planner was initialized with, see env_snapshot_t
+    unsigned long grid_generation() const;
     int plan();
+    // Searches until deadline, publishing every better path as it is found
+    int plan_until(std::chrono::steady_clock::time_point deadline);
     std::vector<sbpl_xy_theta_pt_t> get_path();
+    // The path get_path() copies, valid until the next plan
+    const std::vector<sbpl_xy_theta_pt_t>& path() const;
+    // Moves the path out, the planner has none after
+    std::vector<sbpl_xy_theta_pt_t> take_path();
+    // Reduces a path to waypoints, see ::simplify_path(). Shortcuts are checked
+    // against the grid as it is now, moving obstacles and corridor included.
+    void simplify_path(const std::vector<sbpl_xy_theta_pt_t>& path, double tolerance_m,
+                       std::vector<sbpl_xy_theta_pt_t>& waypoints);
+    // True if the last plan ended on an optimal path and since then the goal stayed put,
+    // the start only moved along the path and no update_grid_points() cell was under it.
+    // path() then starts at the new start, and planning again would find it again short
+    // of cells that got cheaper elsewhere. After PLAN_KEEP_CHEAPER_UPDATES updates with
+    // cheaper cells it is false, so such a shortcut is found within that many updates.
+    bool path_current() const;
+    // Sets how long plan() may search for, in seconds
+    void set_planning_time(double seconds);
+    // Sets the epsilon of the first solution, used from the next time the search starts over
+    void set_initial_epsilon(double epsilon);
+    // Makes plan_until() return on the first solution instead of improving it
+    void set_first_solution(bool first_solution);
+    // Searches inside a coarse corridor from the next initialize(), scale 0 searches the whole grid
+    void set_corridor(corridor_params_t params);
+    // Threads that build the 2D heuristic when it starts over, NULL for the planning thread alone.
+    // The pool is not owned and may be shared by planners that do not plan at the same time.
+    void set_heuristic_pool(thread_pool* pool);
+    // True while the search is held inside the corridor
+    bool in_corridor() const;
+    // Called from plan_until() with every better path
+    void set_solution_callback(solution_callback callback);
+    // Last path published by plan_until(), NULL if none yet. Safe from any thread.
+    plan_solution_ptr latest_solution() const;
+    // Search this planner runs
+    const char* name() const;
+    // Stops plan_until() at the next slice, safe from any thread. Cleared when the
+    // planner is given new data.
+    void preempt();
 
 private:
 
@@ -44,15 +131,28 @@ private:
     int init_planner();
     //Sets up the planner for use with the current set of goal
     int set_planner_states(int start_state_id, int goal_state_id);
+    //Stores the current path as the latest solution and calls the solution callback
+    void publish_solution(int cost, double epsilon, double seconds);
+    //Gives the cells outside the corridor their costs back and starts the search over
+    int leave_corridor();
+    //True if the search is held in the corridor and x, y in meters is outside it
+    bool outside_corridor(int x, int y) const;
+    //Drops the poses of the path before the start pose, false if the start is not on it
+    bool trim_path_to(int x, int y, int theta);
+    //Fills m_path_cells from xythetaPath
+    void index_path_cells();
 
 
     //---Environment---
+    //The environment the planner was initialized from
+    env_snapshot_ptr m_snapshot;
     //Environment settings
-    EnvironmentNAVXYTHETALAT m_env;
+    cached_heuristic_environment m_env;
     MDPConfig MDPCfg; // Not exactly sure what this is, but its in the example
 
     //---Planner---
     //Planner Settings
+    planner_type_t planner_type;
     double planning_time; //In seconds
     double initial_epsilon; //The initial epsilon used for planning (a multiplier on the heuristic)
 
@@ -60,16 +160,37 @@ private:
     bool changed; //Has the environment changed
 
     bool last_plan_good; //True if the last plan we tried was good.
+    bool m_path_current; //See path_current()
+    std::vector<int> m_path_cells; //Cells under xythetaPath by x + y * width, sorted, while m_path_current
+    int m_cheaper_updates; //Updates with cheaper cells since the path was planned
+    bool first_solution; //Stop at the first solution
+
+    const char* m_name;
+    solution_callback m_solution_callback;
+    snapshot_slot<plan_solution_t> m_solution;
+    std::atomic_bool m_preempt;
 
     std::vector<nav2dcell_t> changed_cells; // A vector of the cells changed this time.
 
     std::vector<sbpl_2Dpt_t> perimeterptsV; //The perimeters of the vehicle
 
+    //---Corridor---
+    corridor_params_t m_corridor_params;
+    corridor m_corridor;
+    bool m_in_corridor; //Cells outside m_corridor are blocked in m_env
+    std::unordered_map<int, unsigned char> m_outside_costs; //Updates to blocked cells, by x + y * width
+    double m_cellsize_m;
+    unsigned char m_obs_thresh;
+
     SBPLPlanner* m_planner = NULL; //By making this a pointer, we can use whatever planner we want,
     //but we need to make sure we delete it
 
     std::vector<sbpl_xy_theta_pt_t> xythetaPath;
 
+    //The start and goal the planner is set to, in the units of env_data_t
+    int m_start_x, m_start_y, m_start_theta;
+    int m_goal_x, m_goal_y, m_goal_theta;
+
 };
 
 
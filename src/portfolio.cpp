@@ -0,0 +1,319 @@
+///////////////////////////////////////////////////////////////////////////////
+// portfolio.cpp - Races several planners on the same problem - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "portfolio.hpp"
+
+#include <algorithm>
+#include <ctime>
+
+planner_portfolio::planner_portfolio(portfolio_mode_t mode, const std::vector<planner_config_t> &configs) :
+    m_mode(mode),
+    m_results(configs.size()),
+    m_pool(std::max<size_t>(configs.size(), 1)),
+    m_planning_time(10.0),
+    m_winner(-1),
+    m_start_x(0), m_start_y(0), m_start_theta(0),
+    m_goal_x(0), m_goal_y(0), m_goal_theta(0)
+{
+    for(size_t i = 0; i < configs.size(); i++) {
+        m_planners.push_back(std::unique_ptr<Planner>(new Planner(configs[i])));
+        m_planners[i]->set_first_solution(mode == PORTFOLIO_FIRST);
+        m_planners[i]->set_solution_callback([this, i](plan_solution_ptr solution) {
+            on_member_solution(i, solution);
+        });
+    }
+}
+
+planner_portfolio::~planner_portfolio()
+{
+
+}
+
+/*
+ * Opens a csv file to append to, writing the header if it is new
+ * returns false if it could not be opened
+ */
+bool planner_portfolio::open_log(const std::string &filename)
+{
+    m_log.close();
+    m_log.clear();
+    if(filename.empty()) {
+        return true;
+    }
+    m_log.open(filename.c_str(), std::ios::out | std::ios::app);
+    if(!m_log.is_open()) {
+        return false;
+    }
+    m_log.seekp(0, std::ios::end);
+    if(m_log.tellp() == 0) {
+        m_log << "time,width,height,start_x,start_y,start_theta,goal_x,goal_y,goal_theta,grid_generation,"
+              << "mode,planner,paths,first_ms,epsilon,cost,won" << std::endl;
+    }
+    return true;
+}
+
+/*
+ * Initializes every planner on the same snapshot. SBPL copies the grid into
+ * each environment, so the planners share nothing once this returns.
+ * returns 0 on success, otherwise the error code of the first planner that failed
+ */
+int planner_portfolio::initialize(env_snapshot_ptr snapshot, env_constants_t &env_const)
+{
+    if(snapshot == NULL) {
+        return 1;
+    }
+    for(auto& planner : m_planners) {
+        int ret = planner->initialize(snapshot, env_const);
+        if(ret != 0) {
+            return ret;
+        }
+    }
+    m_snapshot = snapshot;
+    m_start_x = snapshot->data.start_x;
+    m_start_y = snapshot->data.start_y;
+    m_start_theta = snapshot->data.start_theta;
+    m_goal_x = snapshot->data.end_x;
+    m_goal_y = snapshot->data.end_y;
+    m_goal_theta = snapshot->data.end_theta;
+    return 0;
+}
+
+/*
+ * Moves the start of every planner
+ * returns 0 on success, otherwise the error code of the first planner that failed
+ */
+int planner_portfolio::set_start(int x, int y, int theta)
+{
+    int ret = 0;
+    for(auto& planner : m_planners) {
+        int planner_ret = planner->set_start(x, y, theta);
+        ret = (ret == 0) ? planner_ret : ret;
+    }
+    if(ret == 0) {
+        m_start_x = x;
+        m_start_y = y;
+        m_start_theta = theta;
+    }
+    return ret;
+}
+
+/*
+ * Moves the goal of every planner
+ * returns 0 on success, otherwise the error code of the first planner that failed
+ */
+int planner_portfolio::set_goal(int x, int y, int theta)
+{
+    int ret = 0;
+    for(auto& planner : m_planners) {
+        int planner_ret = planner->set_goal(x, y, theta);
+        ret = (ret == 0) ? planner_ret : ret;
+    }
+    if(ret == 0) {
+        m_goal_x = x;
+        m_goal_y = y;
+        m_goal_theta = theta;
+    }
+    return ret;
+}
+
+unsigned long planner_portfolio::grid_generation() const
+{
+    return m_snapshot == NULL ? 0 : m_snapshot->grid_generation;
+}
+
+int planner_portfolio::update_grid_points(const cell_update_list &points)
+{
+    for(auto& planner : m_planners) {
+        planner->update_grid_points(points);
+    }
+    return 0;
+}
+
+int planner_portfolio::plan()
+{
+    auto budget = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                      std::chrono::duration<double>(m_planning_time));
+    return plan_until(std::chrono::steady_clock::now() + budget);
+}
+
+/*
+ * Runs every planner on its own thread until deadline. In PORTFOLIO_FIRST
+ * mode the first path found stops the others.
+ * Returns Planner::PATH_EXISTS if any planner found a path, else 0
+ */
+int planner_portfolio::plan_until(std::chrono::steady_clock::time_point deadline)
+{
+    m_winner = -1;
+    m_best = NULL;
+    for(auto& result : m_results) {
+        result = member_result_t {0, 0.0, 0.0, 0};
+    }
+
+    m_pool.parallel_for(m_planners.size(), [this, deadline](size_t i) {
+        m_planners[i]->plan_until(deadline);
+    });
+
+    write_log();
+    if(m_winner >= 0) {
+        return Planner::PATH_EXISTS;
+    } else {
+        return 0;
+    }
+}
+
+/*
+ * Runs on the thread of the planner that found the path
+ */
+void planner_portfolio::on_member_solution(size_t member, plan_solution_ptr solution)
+{
+    member_result_t &result = m_results[member];
+    if(result.paths == 0) {
+        result.first_s = solution->seconds;
+    }
+    result.paths++;
+    result.epsilon = solution->epsilon;
+    result.cost = solution->cost;
+
+    std::lock_guard<std::mutex> lock(m_solution_mutex);
+    bool wins = (m_best == NULL) || (m_mode == PORTFOLIO_BEST && solution->cost < m_best->cost);
+    if(!wins) {
+        return;
+    }
+    m_best = solution;
+    m_winner = member;
+    m_solution.store(solution);
+    if(m_solution_callback) {
+        m_solution_callback(solution);
+    }
+    if(m_mode == PORTFOLIO_FIRST) {
+        for(size_t i = 0; i < m_planners.size(); i++) {
+            if(i != member) {
+                m_planners[i]->preempt();
+            }
+        }
+    }
+}
+
+/*
+ * One row per planner for the plan that just finished
+ */
+void planner_portfolio::write_log()
+{
+    if(!m_log.is_open() || m_snapshot == NULL) {
+        return;
+    }
+    long long now = (long long)std::time(NULL);
+    for(size_t i = 0; i < m_planners.size(); i++) {
+        const member_result_t &result = m_results[i];
+        m_log << now << ',' << m_snapshot->data.width << ',' << m_snapshot->data.height << ','
+              << m_start_x << ',' << m_start_y << ',' << m_start_theta << ','
+              << m_goal_x << ',' << m_goal_y << ',' << m_goal_theta << ','
+              << m_snapshot->grid_generation << ','
+              << (m_mode == PORTFOLIO_FIRST ? "first" : "best") << ',' << m_planners[i]->name() << ','
+              << result.paths << ',' << (long long)(result.first_s * 1000) << ','
+              << result.epsilon << ',' << result.cost << ',' << ((int)i == m_winner ? 1 : 0) << '\n';
+    }
+    m_log.flush();
+}
+
+std::vector<sbpl_xy_theta_pt_t> planner_portfolio::get_path()
+{
+    return path();
+}
+
+const std::vector<sbpl_xy_theta_pt_t>& planner_portfolio::path() const
+{
+    static const std::vector<sbpl_xy_theta_pt_t> no_path;
+    if(path_current()) {
+        //The winner trims it as the start moves along it
+        return m_planners[m_winner]->path();
+    }
+    return m_best != NULL ? m_best->path : no_path;
+}
+
+std::vector<sbpl_xy_theta_pt_t> planner_portfolio::take_path()
+{
+    return path();
+}
+
+void planner_portfolio::simplify_path(const std::vector<sbpl_xy_theta_pt_t>& path, double tolerance_m,
+                                      std::vector<sbpl_xy_theta_pt_t>& waypoints)
+{
+    if(m_planners.empty()) {
+        waypoints = path;
+        return;
+    }
+    m_planners.front()->simplify_path(path, tolerance_m, waypoints);
+}
+
+/*
+ * Only the winner's path counts, and only if it is the last one the winner
+ * found, a later one could have lost on cost
+ */
+bool planner_portfolio::path_current() const
+{
+    if(m_winner < 0 || m_best == NULL) {
+        return false;
+    }
+    const Planner& winner = *m_planners[m_winner];
+    return winner.path_current() && winner.latest_solution() == m_best;
+}
+
+void planner_portfolio::set_planning_time(double seconds)
+{
+    m_planning_time = seconds;
+    for(auto& planner : m_planners) {
+        planner->set_planning_time(seconds);
+    }
+}
+
+void planner_portfolio::set_corridor(corridor_params_t params)
+{
+    for(auto& planner : m_planners) {
+        planner->set_corridor(params);
+    }
+}
+
+/*
+ * Calls are serialized, but come from the planner threads
+ */
+void planner_portfolio::set_solution_callback(solution_callback callback)
+{
+    m_solution_callback = callback;
+}
+
+plan_solution_ptr planner_portfolio::latest_solution() const
+{
+    return m_solution.load();
+}
+
+void planner_portfolio::preempt()
+{
+    for(auto& planner : m_planners) {
+        planner->preempt();
+    }
+}
+
+const char* planner_portfolio::winner() const
+{
+    if(m_winner < 0) {
+        return NULL;
+    }
+    return m_planners[m_winner]->name();
+}
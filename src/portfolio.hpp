@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////////////////
+// portfolio.h - Races several planners on the same problem - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef PORTFOLIO_H
+#define PORTFOLIO_H
+
+#include "plan.hpp"
+#include "thread_pool.hpp"
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// What planner_portfolio::plan_until() returns
+enum portfolio_mode_t {
+    PORTFOLIO_FIRST, //The first path any planner finds, the others are stopped
+    PORTFOLIO_BEST //The cheapest path found by the deadline
+};
+
+// AD* backwards and forwards and ARA* backwards, each from a different epsilon
+const planner_config_t DEFAULT_PORTFOLIO[] = {
+    {"ad_backward_3", PLANNER_AD, false, 3.0},
+    {"ad_forward_3", PLANNER_AD, true, 3.0},
+    {"ara_backward_5", PLANNER_ARA, false, 5.0},
+    {"ad_backward_1.5", PLANNER_AD, false, 1.5}
+};
+
+/*
+ * Runs one Planner per config at the same time, each on its own thread with
+ * its own copy of the environment, and keeps the path of the winner. Has the
+ * interface of Planner so either can drive the replanning loop.
+ *
+ * Every plan can be logged as csv, one row per planner, to see which config
+ * wins on which map.
+ *
+ * SBPL times its searches with clock(), which counts the CPU time of every
+ * thread, so with all planners busy each slice of Planner::plan_until() ends
+ * after about 1/N of its wall time. The deadline is still kept in wall time.
+ */
+class planner_portfolio {
+public:
+    planner_portfolio(portfolio_mode_t mode, const std::vector<planner_config_t> &configs);
+    virtual ~planner_portfolio();
+
+    // Appends a row per planner to a csv file after every plan, "" to stop
+    bool open_log(const std::string &filename);
+
+    int update_grid_points(const cell_update_list &points);
+    int initialize(env_snapshot_ptr snapshot, env_constants_t &env_const);
+    int set_start(int x, int y, int theta);
+    int set_goal(int x, int y, int theta);
+    unsigned long grid_generation() const;
+    int plan();
+    // Races the planners until deadline, see portfolio_mode_t
+    int plan_until(std::chrono::steady_clock::time_point deadline);
+    std::vector<sbpl_xy_theta_pt_t> get_path();
+    // The winning path, valid until the next plan
+    const std::vector<sbpl_xy_theta_pt_t>& path() const;
+    // A copy of the winning path, it is shared with latest_solution() so cannot be moved out
+    std::vector<sbpl_xy_theta_pt_t> take_path();
+    // Every planner has the same grid, the first one checks the shortcuts
+    void simplify_path(const std::vector<sbpl_xy_theta_pt_t>& path, double tolerance_m,
+                       std::vector<sbpl_xy_theta_pt_t>& waypoints);
+    // See Planner::path_current()
+    bool path_current() const;
+    void set_planning_time(double seconds);
+    // Every planner searches inside its own corridor, see Planner::set_corridor()
+    void set_corridor(corridor_params_t params);
+    // Called with every path that beats the ones published before it, from the planner threads
+    void set_solution_callback(solution_callback callback);
+    plan_solution_ptr latest_solution() const;
+    void preempt();
+    // Name of the planner whose path won the last plan, NULL if there was none
+    const char* winner() const;
+
+private:
+    planner_portfolio(const planner_portfolio&);
+    planner_portfolio& operator=(const planner_portfolio&);
+
+    // How one planner did in the last plan
+    struct member_result_t {
+        int paths;
+        double first_s;
+        double epsilon;
+        int cost;
+    };
+
+    // A planner found a path, keeps it if it wins
+    void on_member_solution(size_t member, plan_solution_ptr solution);
+    void write_log();
+
+    portfolio_mode_t m_mode;
+    std::vector<std::unique_ptr<Planner> > m_planners;
+    std::vector<member_result_t> m_results; //Entry i only written by the thread running planner i
+    thread_pool m_pool;
+    double m_planning_time;
+
+    std::mutex m_solution_mutex; //Guards the winner while the planners run
+    int m_winner;
+    plan_solution_ptr m_best;
+    solution_callback m_solution_callback;
+    snapshot_slot<plan_solution_t> m_solution;
+
+    std::ofstream m_log;
+    env_snapshot_ptr m_snapshot;
+    int m_start_x, m_start_y, m_start_theta;
+    int m_goal_x, m_goal_y, m_goal_theta;
+};
+
+#endif /* PORTFOLIO_H */
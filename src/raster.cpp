@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////////
+// raster.cpp - Cost map rasterization - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "raster.hpp"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RASTER_X86
+#include <emmintrin.h>
+
+// Defined in raster_avx2.cpp, which is the only file built with -mavx2
+void blend_max_span_avx2(unsigned char* dst, const unsigned char* src, int count);
+#endif
+
+typedef void (*blend_max_fn)(unsigned char*, const unsigned char*, int);
+
+static void blend_max_span_scalar(unsigned char* dst, const unsigned char* src, int count)
+{
+    for(int i = 0; i < count; i++) {
+        dst[i] = std::max(dst[i], src[i]);
+    }
+}
+
+#ifdef RASTER_X86
+static void blend_max_span_sse2(unsigned char* dst, const unsigned char* src, int count)
+{
+    int i = 0;
+    for(; i + 16 <= count; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_max_epu8(a, b));
+    }
+    blend_max_span_scalar(dst + i, src + i, count - i);
+}
+#endif
+
+struct blend_max_impl_t {
+    blend_max_fn fn;
+    const char* isa;
+};
+
+/*
+ * Picks the widest implementation the cpu supports.
+ */
+static blend_max_impl_t select_blend_max()
+{
+#ifdef RASTER_X86
+    __builtin_cpu_init();
+#ifdef RASTER_HAVE_AVX2
+    if(__builtin_cpu_supports("avx2")) {
+        return {blend_max_span_avx2, "avx2"};
+    }
+#endif
+    if(__builtin_cpu_supports("sse2")) {
+        return {blend_max_span_sse2, "sse2"};
+    }
+#endif
+    return {blend_max_span_scalar, "scalar"};
+}
+
+static const blend_max_impl_t& blend_max_impl()
+{
+    static const blend_max_impl_t impl = select_blend_max();
+    return impl;
+}
+
+void blend_max_span(unsigned char* dst, const unsigned char* src, int count)
+{
+    blend_max_impl().fn(dst, src, count);
+}
+
+const char* blend_max_isa()
+{
+    return blend_max_impl().isa;
+}
+
+void stamp_max(unsigned char* grid, int width, int height,
+               const inflation_stamp_t& stamp, int center_x, int center_y)
+{
+    stamp_max_rect(grid, width, stamp, center_x, center_y, 0, 0, width, height);
+}
+
+void stamp_max_rect(unsigned char* grid, int width, const inflation_stamp_t& stamp,
+                    int center_x, int center_y, int x0, int y0, int x1, int y1)
+{
+    blend_max_fn blend = blend_max_impl().fn;
+
+    int top = center_y - stamp.half_size;
+    int left = center_x - stamp.half_size;
+    int row_first = std::max(0, y0 - top);
+    int row_last = std::min(stamp.size, y1 - top);
+    for(int row = row_first; row < row_last; row++) {
+        int begin = std::max(stamp.row_begin[row], x0 - left);
+        int end = std::min(stamp.row_end[row], x1 - left);
+        if(begin >= end) {
+            continue;
+        }
+        const unsigned char* src = &stamp.cost[row * stamp.size];
+        unsigned char* dst = &grid[(top + row) * width + left];
+        blend(dst + begin, src + begin, end - begin);
+    }
+}
@@ -0,0 +1,41 @@
+///////////////////////////////////////////////////////////////////////////////
+// raster.h - Cost map rasterization - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef RASTER_H
+#define RASTER_H
+
+#include "inflation.hpp"
+
+// dst[i] = max(dst[i], src[i]) for i in [0, count).
+// Uses AVX2 or SSE2 when the cpu has them, picked the first time it is called.
+void blend_max_span(unsigned char* dst, const unsigned char* src, int count);
+
+// Name of the instruction set blend_max_span uses ("avx2", "sse2" or "scalar")
+const char* blend_max_isa();
+
+// Max blends the stamp centered at (center_x, center_y) into a row major grid.
+// Every stamp row is clipped against the grid once, then blended as one span.
+void stamp_max(unsigned char* grid, int width, int height,
+               const inflation_stamp_t& stamp, int center_x, int center_y);
+
+// Same as stamp_max, only writing the cells in [x0, x1) x [y0, y1), which must be on the grid
+void stamp_max_rect(unsigned char* grid, int width, const inflation_stamp_t& stamp,
+                    int center_x, int center_y, int x0, int y0, int x1, int y1);
+
+#endif /* RASTER_H */
@@ -0,0 +1,46 @@
+///////////////////////////////////////////////////////////////////////////////
+// raster_avx2.cpp - AVX2 span blending - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+// This file is built with -mavx2 (see the Makefile). Nothing in here may be
+// called unless raster.cpp has checked the cpu supports AVX2.
+
+#ifdef __AVX2__
+#include <immintrin.h>
+
+#include <algorithm>
+
+void blend_max_span_avx2(unsigned char* dst, const unsigned char* src, int count)
+{
+    int i = 0;
+    for(; i + 32 <= count; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_max_epu8(a, b));
+    }
+    if(i + 16 <= count) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_max_epu8(a, b));
+        i += 16;
+    }
+    for(; i < count; i++) {
+        dst[i] = std::max(dst[i], src[i]);
+    }
+}
+#endif
@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////////
+// stationary_tracker.cpp - Stationary obstacle diffing - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "stationary_tracker.hpp"
+
+#include <stdint.h>
+
+stationary_tracker::stationary_tracker()
+{
+
+}
+
+void stationary_tracker::clear()
+{
+    m_last.clear();
+    m_tracked.clear();
+    m_added.clear();
+    m_removed.clear();
+}
+
+/*
+ * Most updates send the same obstacles in the same order, which is checked
+ * first. Otherwise the obstacles are counted by footprint and the counts are
+ * compared both ways, so the order they come in does not matter.
+ */
+void stationary_tracker::update(obstacle_span_t obstacles)
+{
+    m_added.clear();
+    m_removed.clear();
+    bool same = obstacles.size() == m_last.size();
+    for(size_t i = 0; same && i < obstacles.size(); i++) {
+        same = footprint(obstacles[i]) == footprint(m_last[i]);
+    }
+    if(same) {
+        return;
+    }
+
+    m_next.clear();
+    for(const obstacle_t& obs : obstacles) {
+        footprint_map::iterator it = m_next.find(footprint(obs));
+        if(it == m_next.end()) {
+            m_next.insert(std::make_pair(footprint(obs), tracked_t {obs, 1}));
+        } else {
+            it->second.count++;
+        }
+    }
+    for(footprint_map::const_iterator it = m_next.begin(); it != m_next.end(); it++) {
+        footprint_map::const_iterator old = m_tracked.find(it->first);
+        for(int i = (old == m_tracked.end()) ? 0 : old->second.count; i < it->second.count; i++) {
+            m_added.push_back(it->second.obstacle);
+        }
+    }
+    for(footprint_map::const_iterator it = m_tracked.begin(); it != m_tracked.end(); it++) {
+        footprint_map::const_iterator now = m_next.find(it->first);
+        for(int i = (now == m_next.end()) ? 0 : now->second.count; i < it->second.count; i++) {
+            m_removed.push_back(it->second.obstacle);
+        }
+    }
+    m_tracked.swap(m_next);
+    m_last.assign(obstacles.begin(), obstacles.end());
+}
+
+bool stationary_tracker::changed() const
+{
+    return !m_added.empty() || !m_removed.empty();
+}
+
+const std::vector<obstacle_t>& stationary_tracker::added() const
+{
+    return m_added;
+}
+
+const std::vector<obstacle_t>& stationary_tracker::removed() const
+{
+    return m_removed;
+}
+
+void stationary_tracker::dirty_tiles(int width, int height, inflation_stamp_cache& cache,
+                                     inflation_params_t inf_param, std::vector<int>& tiles)
+{
+    m_changed.assign(m_added.begin(), m_added.end());
+    m_changed.insert(m_changed.end(), m_removed.begin(), m_removed.end());
+    lookup_stamps(m_changed, cache, inf_param, m_stamps);
+    m_bins.build(width, height, RASTER_TILE_SIZE, m_changed, m_stamps);
+    tiles = m_bins.busy_tiles();
+}
+
+size_t stationary_tracker::footprint_hash::operator()(const footprint_t& key) const
+{
+    //FNV-1a over the three fields
+    uint64_t hash = 14695981039346656037ULL;
+    const int fields[] = {key.x, key.y, key.radius};
+    for(int field : fields) {
+        hash = (hash ^ (uint32_t)field) * 1099511628211ULL;
+    }
+    return (size_t)hash;
+}
+
+stationary_tracker::footprint_t stationary_tracker::footprint(const obstacle_t& obs)
+{
+    footprint_t key = {obs.x, obs.y, obs.radius};
+    return key;
+}
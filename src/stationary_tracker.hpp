@@ -0,0 +1,85 @@
+///////////////////////////////////////////////////////////////////////////////
+// stationary_tracker.h - Stationary obstacle diffing - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef STATIONARY_TRACKER_H
+#define STATIONARY_TRACKER_H
+
+#include "inflation.hpp"
+#include "tile_raster.hpp"
+
+#include <stddef.h>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Finds which stationary obstacles were added or removed since the last
+ * update. The server sends no ids, so an obstacle is known by what it
+ * rasterizes to: its position and radius. Two obstacles with the same
+ * footprint are the same obstacle, counted twice, and a moved obstacle is one
+ * removed and one added.
+ */
+class stationary_tracker {
+public:
+    stationary_tracker();
+
+    // Forgets every obstacle, the next update() sees all of them as added
+    void clear();
+    // Diffs obstacles against the ones given last time, then remembers them
+    void update(obstacle_span_t obstacles);
+
+    // What the last update() found
+    bool changed() const;
+    const std::vector<obstacle_t>& added() const;
+    const std::vector<obstacle_t>& removed() const;
+
+    // Tiles of a width x height tiled_grid under the stamp of an obstacle the last update() added or removed
+    void dirty_tiles(int width, int height, inflation_stamp_cache& cache, inflation_params_t inf_param,
+                     std::vector<int>& tiles);
+
+private:
+    struct footprint_t {
+        int x;
+        int y;
+        int radius;
+        bool operator==(const footprint_t& other) const {
+            return x == other.x && y == other.y && radius == other.radius;
+        }
+    };
+    struct footprint_hash {
+        size_t operator()(const footprint_t& footprint) const;
+    };
+    struct tracked_t {
+        obstacle_t obstacle;
+        int count;
+    };
+    typedef std::unordered_map<footprint_t, tracked_t, footprint_hash> footprint_map;
+
+    static footprint_t footprint(const obstacle_t& obs);
+
+    std::vector<obstacle_t> m_last; //Obstacles of the last update, in the order they came
+    footprint_map m_tracked; //The same obstacles by footprint
+    footprint_map m_next; //Scratch for update()
+    std::vector<obstacle_t> m_added;
+    std::vector<obstacle_t> m_removed;
+    std::vector<obstacle_t> m_changed; //Scratch for dirty_tiles()
+    stamp_list m_stamps;
+    tile_bins m_bins;
+};
+
+#endif /* STATIONARY_TRACKER_H */
@@ -0,0 +1,165 @@
+///////////////////////////////////////////////////////////////////////////////
+// thread_pool.cpp - Work stealing thread pool - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+// Ranges per thread in parallel_for_range, more gives stealing something to balance with
+#define RANGES_PER_THREAD 4
+
+thread_pool::thread_pool(unsigned int threads) :
+    m_task(NULL),
+    m_remaining(0),
+    m_batch(0),
+    m_stop(false)
+{
+    if(threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for(unsigned int i = 0; i < threads; i++) {
+        m_queues.push_back(std::unique_ptr<task_queue_t>(new task_queue_t()));
+    }
+    for(unsigned int i = 1; i < threads; i++) {
+        m_workers.push_back(std::thread(&thread_pool::worker_main, this, i));
+    }
+}
+
+thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_work_cv.notify_all();
+    for(auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+unsigned int thread_pool::size() const
+{
+    return m_queues.size();
+}
+
+void thread_pool::parallel_for(size_t count, const std::function<void(size_t)>& task)
+{
+    if(count == 0) {
+        return;
+    }
+    if(m_workers.empty() || count == 1) {
+        for(size_t i = 0; i < count; i++) {
+            task(i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit_lock(m_submit_mutex);
+    m_task = &task;
+    m_remaining = count;
+    //Contiguous blocks, neighbouring tasks usually touch neighbouring memory
+    size_t threads = m_queues.size();
+    for(size_t i = 0; i < threads; i++) {
+        std::lock_guard<std::mutex> lock(m_queues[i]->mutex);
+        for(size_t t = count * i / threads; t < count * (i + 1) / threads; t++) {
+            m_queues[i]->tasks.push_back(t);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_batch++;
+    }
+    m_work_cv.notify_all();
+
+    run_tasks(0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done_cv.wait(lock, [this]() {
+        return m_remaining == 0;
+    });
+    m_task = NULL;
+}
+
+void thread_pool::parallel_for_range(int count, const std::function<void(int, int)>& work)
+{
+    if(count <= 0) {
+        return;
+    }
+    int ranges = std::min(count, (int)size() * RANGES_PER_THREAD);
+    parallel_for(ranges, [count, ranges, &work](size_t range) {
+        int begin = (int)((long long)count * range / ranges);
+        int end = (int)((long long)count * (range + 1) / ranges);
+        work(begin, end);
+    });
+}
+
+void thread_pool::worker_main(unsigned int self)
+{
+    unsigned long seen = 0;
+    while(true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work_cv.wait(lock, [this, seen]() {
+                return m_stop || m_batch != seen;
+            });
+            if(m_stop) {
+                return;
+            }
+            seen = m_batch;
+        }
+        run_tasks(self);
+    }
+}
+
+void thread_pool::run_tasks(unsigned int self)
+{
+    size_t task;
+    while(pop_task(self, task)) {
+        (*m_task)(task);
+        if(--m_remaining == 0) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_done_cv.notify_all();
+        }
+    }
+}
+
+/*
+ * Takes the next task of our own queue, or steals the last one of another queue.
+ */
+bool thread_pool::pop_task(unsigned int self, size_t& task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_queues[self]->mutex);
+        if(!m_queues[self]->tasks.empty()) {
+            task = m_queues[self]->tasks.front();
+            m_queues[self]->tasks.pop_front();
+            return true;
+        }
+    }
+    for(size_t i = 1; i < m_queues.size(); i++) {
+        task_queue_t& victim = *m_queues[(self + i) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if(!victim.tasks.empty()) {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
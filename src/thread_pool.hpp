@@ -0,0 +1,84 @@
+///////////////////////////////////////////////////////////////////////////////
+// thread_pool.h - Work stealing thread pool - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Fixed set of worker threads running parallel_for batches.
+ *
+ * Every thread, the caller included, gets a contiguous block of the batch in
+ * its own queue and works through it front to back. A thread that runs out
+ * steals from the back of another queue, so uneven tasks still keep every
+ * core busy. One batch runs at a time, parallel_for calls from several
+ * threads take turns.
+ */
+class thread_pool {
+public:
+    // threads counts the caller, 0 means one per core. 1 runs everything on the caller.
+    explicit thread_pool(unsigned int threads = 0);
+    ~thread_pool();
+
+    // Threads working on a batch, the caller included
+    unsigned int size() const;
+
+    // Runs task(i) for i in [0, count) and returns once all are done
+    void parallel_for(size_t count, const std::function<void(size_t)>& task);
+
+    // Splits [0, count) in ranges a few times more than size() and runs work(begin, end) on each
+    void parallel_for_range(int count, const std::function<void(int, int)>& work);
+
+private:
+    thread_pool(const thread_pool&);
+    thread_pool& operator=(const thread_pool&);
+
+    struct task_queue_t {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    void worker_main(unsigned int self);
+    // Runs tasks until every queue is empty
+    void run_tasks(unsigned int self);
+    bool pop_task(unsigned int self, size_t& task);
+
+    std::vector<std::unique_ptr<task_queue_t> > m_queues; //Index 0 is the caller's
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_submit_mutex; //One batch at a time
+    const std::function<void(size_t)>* m_task; //Task of the running batch
+    std::atomic<size_t> m_remaining; //Tasks of the running batch not done yet
+
+    std::mutex m_mutex;
+    std::condition_variable m_work_cv; //A batch started, or the pool is stopping
+    std::condition_variable m_done_cv; //m_remaining reached zero
+    unsigned long m_batch; //Number of batches started
+    bool m_stop;
+};
+
+#endif /* THREAD_POOL_H */
@@ -0,0 +1,176 @@
+///////////////////////////////////////////////////////////////////////////////
+// tile_raster.cpp - Tile parallel obstacle rasterization - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tile_raster.hpp"
+#include "raster.hpp"
+#include "tiled_grid.hpp"
+
+#include <algorithm>
+
+/*
+ * The part of the grid an obstacle's stamp covers, false if it is off the grid
+ */
+static bool stamp_bounds(int width, int height, const obstacle_t& obs, const inflation_stamp_t& stamp,
+                         tile_rect_t& bounds)
+{
+    bounds.x0 = std::max(obs.x - stamp.half_size, 0);
+    bounds.y0 = std::max(obs.y - stamp.half_size, 0);
+    bounds.x1 = std::min(obs.x - stamp.half_size + stamp.size, width);
+    bounds.y1 = std::min(obs.y - stamp.half_size + stamp.size, height);
+    return bounds.x0 < bounds.x1 && bounds.y0 < bounds.y1;
+}
+
+tile_bins::tile_bins() :
+    m_width(0),
+    m_height(0),
+    m_tile_size(1),
+    m_tiles_x(0)
+{
+
+}
+
+/*
+ * Two passes over the obstacles: count the obstacles of every tile, then
+ * place them. Obstacles stay in order within a tile.
+ */
+void tile_bins::build(int width, int height, int tile_size, obstacle_span_t obstacles, const stamp_list& stamps)
+{
+    m_width = std::max(width, 0);
+    m_height = std::max(height, 0);
+    m_tile_size = std::max(tile_size, 1);
+    m_tiles_x = (m_width + m_tile_size - 1) / m_tile_size;
+    int tiles_y = (m_height + m_tile_size - 1) / m_tile_size;
+    int tile_count = m_tiles_x * tiles_y;
+
+    m_offsets.assign(tile_count + 1, 0);
+    for(size_t i = 0; i < obstacles.size(); i++) {
+        tile_rect_t bounds;
+        if(!stamp_bounds(m_width, m_height, obstacles[i], *stamps[i], bounds)) {
+            continue;
+        }
+        for(int ty = bounds.y0 / m_tile_size; ty <= (bounds.y1 - 1) / m_tile_size; ty++) {
+            for(int tx = bounds.x0 / m_tile_size; tx <= (bounds.x1 - 1) / m_tile_size; tx++) {
+                m_offsets[ty * m_tiles_x + tx + 1]++;
+            }
+        }
+    }
+    m_busy.clear();
+    for(int t = 0; t < tile_count; t++) {
+        if(m_offsets[t + 1] != 0) {
+            m_busy.push_back(t);
+        }
+        m_offsets[t + 1] += m_offsets[t];
+    }
+
+    m_items.resize(m_offsets[tile_count]);
+    std::vector<int> fill(m_offsets.begin(), m_offsets.end() - 1);
+    for(size_t i = 0; i < obstacles.size(); i++) {
+        tile_rect_t bounds;
+        if(!stamp_bounds(m_width, m_height, obstacles[i], *stamps[i], bounds)) {
+            continue;
+        }
+        for(int ty = bounds.y0 / m_tile_size; ty <= (bounds.y1 - 1) / m_tile_size; ty++) {
+            for(int tx = bounds.x0 / m_tile_size; tx <= (bounds.x1 - 1) / m_tile_size; tx++) {
+                m_items[fill[ty * m_tiles_x + tx]++] = i;
+            }
+        }
+    }
+}
+
+const std::vector<int>& tile_bins::busy_tiles() const
+{
+    return m_busy;
+}
+
+tile_rect_t tile_bins::rect(int tile) const
+{
+    tile_rect_t rect;
+    rect.x0 = (tile % m_tiles_x) * m_tile_size;
+    rect.y0 = (tile / m_tiles_x) * m_tile_size;
+    rect.x1 = std::min(rect.x0 + m_tile_size, m_width);
+    rect.y1 = std::min(rect.y0 + m_tile_size, m_height);
+    return rect;
+}
+
+const int* tile_bins::begin(int tile) const
+{
+    return m_items.data() + m_offsets[tile];
+}
+
+const int* tile_bins::end(int tile) const
+{
+    return m_items.data() + m_offsets[tile + 1];
+}
+
+void stamp_tile(unsigned char* cells, const tile_bins& bins, int tile, obstacle_span_t obstacles,
+                const stamp_list& stamps)
+{
+    tile_rect_t rect = bins.rect(tile);
+    for(const int* it = bins.begin(tile); it != bins.end(tile); it++) {
+        const obstacle_t& obs = obstacles[*it];
+        stamp_max_rect(cells, RASTER_TILE_SIZE, *stamps[*it], obs.x - rect.x0, obs.y - rect.y0,
+                       0, 0, rect.x1 - rect.x0, rect.y1 - rect.y0);
+    }
+}
+
+void lookup_stamps(obstacle_span_t obstacles, inflation_stamp_cache& cache,
+                   inflation_params_t inf_param, stamp_list& stamps)
+{
+    stamps.clear();
+    stamps.reserve(obstacles.size());
+    for(const obstacle_t& obs : obstacles) {
+        stamps.push_back(cache.get(obs.radius, inf_param));
+    }
+}
+
+void stamp_obstacles_tiled(unsigned char* grid, int width, int height, obstacle_span_t obstacles,
+                           const stamp_list& stamps, thread_pool& pool)
+{
+    tile_bins bins;
+    bins.build(width, height, RASTER_TILE_SIZE, obstacles, stamps);
+    const std::vector<int>& tiles = bins.busy_tiles();
+    pool.parallel_for(tiles.size(), [&](size_t i) {
+        int tile = tiles[i];
+        tile_rect_t rect = bins.rect(tile);
+        for(const int* it = bins.begin(tile); it != bins.end(tile); it++) {
+            const obstacle_t& obs = obstacles[*it];
+            stamp_max_rect(grid, width, *stamps[*it], obs.x, obs.y, rect.x0, rect.y0, rect.x1, rect.y1);
+        }
+    });
+}
+
+/*
+ * The bins use the storage tiles, so each task owns exactly one tile. A tile that was empty and only got the zero
+ * corners of stamps goes back to the shared zero tile.
+ */
+void stamp_obstacles_tiled(tiled_grid& grid, obstacle_span_t obstacles, const stamp_list& stamps,
+                           thread_pool& pool)
+{
+    tile_bins bins;
+    bins.build(grid.width(), grid.height(), GRID_TILE_SIZE, obstacles, stamps);
+    const std::vector<int>& tiles = bins.busy_tiles();
+    pool.parallel_for(tiles.size(), [&](size_t i) {
+        int tile = tiles[i];
+        bool was_empty = !grid.allocated(tile);
+        stamp_tile(grid.write_tile(tile), bins, tile, obstacles, stamps);
+        if(was_empty) {
+            grid.compact_tile(tile);
+        }
+    });
+}
@@ -0,0 +1,93 @@
+///////////////////////////////////////////////////////////////////////////////
+// tile_raster.h - Tile parallel obstacle rasterization - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TILE_RASTER_H
+#define TILE_RASTER_H
+
+#include "inflation.hpp"
+#include "thread_pool.hpp"
+
+#include <memory>
+#include <vector>
+
+// Tile edge in cells. 128 x 128 is 16KB of grid, which stays in L2 with the stamps.
+#define RASTER_TILE_SIZE 128
+
+typedef std::vector<std::shared_ptr<const inflation_stamp_t> > stamp_list;
+
+class tiled_grid;
+
+// Cells [x0, x1) x [y0, y1)
+struct tile_rect_t {
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+};
+
+/*
+ * Obstacles binned by the tiles their stamp overlaps. Each tile is only
+ * written by the thread rasterizing it, so tiles need no locking.
+ */
+class tile_bins {
+public:
+    tile_bins();
+
+    // Bins obstacles[i], stamped with stamps[i], into tile_size tiles of a width x height grid
+    void build(int width, int height, int tile_size, obstacle_span_t obstacles, const stamp_list& stamps);
+
+    // Tiles with at least one obstacle, row major tile order
+    const std::vector<int>& busy_tiles() const;
+    tile_rect_t rect(int tile) const;
+    // Indexes of the obstacles overlapping a tile, in obstacle order
+    const int* begin(int tile) const;
+    const int* end(int tile) const;
+
+private:
+    int m_width;
+    int m_height;
+    int m_tile_size;
+    int m_tiles_x;
+    std::vector<int> m_offsets; //Tile t owns m_items[m_offsets[t], m_offsets[t + 1])
+    std::vector<int> m_items;
+    std::vector<int> m_busy;
+};
+
+// Max blends the obstacles binned to tile into cells, the tile alone as a
+// row major grid of RASTER_TILE_SIZE cells per row. bins must use RASTER_TILE_SIZE tiles.
+void stamp_tile(unsigned char* cells, const tile_bins& bins, int tile, obstacle_span_t obstacles,
+                const stamp_list& stamps);
+
+// Looks up the stamp of every obstacle, in obstacle order
+void lookup_stamps(obstacle_span_t obstacles, inflation_stamp_cache& cache,
+                   inflation_params_t inf_param, stamp_list& stamps);
+
+/*
+ * Max blends the stamp of every obstacle into a row major grid, tile by tile
+ * on the pool. The result is the same, byte for byte, as calling stamp_max()
+ * for each obstacle in order, max blending does not depend on the order.
+ */
+void stamp_obstacles_tiled(unsigned char* grid, int width, int height, obstacle_span_t obstacles,
+                           const stamp_list& stamps, thread_pool& pool);
+
+// Same as above into a tiled_grid. Only tiles a stamp puts a cost in get memory.
+void stamp_obstacles_tiled(tiled_grid& grid, obstacle_span_t obstacles, const stamp_list& stamps,
+                           thread_pool& pool);
+
+#endif /* TILE_RASTER_H */
@@ -0,0 +1,196 @@
+///////////////////////////////////////////////////////////////////////////////
+// tiled_grid.cpp - Sparse tiled cost grid - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tiled_grid.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+/*
+ * The tile every unwritten tile points at. Never written, write_tile() always
+ * swaps it for a tile of its own first.
+ */
+static const std::shared_ptr<grid_tile_t>& zero_tile()
+{
+    static const std::shared_ptr<grid_tile_t> zero = std::make_shared<grid_tile_t>();
+    return zero;
+}
+
+static bool all_zero(const unsigned char* begin, const unsigned char* end)
+{
+    for(const unsigned char* it = begin; it != end; it++) {
+        if(*it != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+tiled_grid::tiled_grid() :
+    m_width(0),
+    m_height(0),
+    m_tiles_x(0),
+    m_tiles_y(0)
+{
+
+}
+
+void tiled_grid::reset(int width, int height)
+{
+    m_width = std::max(width, 0);
+    m_height = std::max(height, 0);
+    m_tiles_x = (m_width + GRID_TILE_SIZE - 1) / GRID_TILE_SIZE;
+    m_tiles_y = (m_height + GRID_TILE_SIZE - 1) / GRID_TILE_SIZE;
+    m_tiles.assign((size_t)m_tiles_x * m_tiles_y, zero_tile());
+}
+
+/*
+ * Tile by tile, a tile is only allocated once a nonzero cell turns up in it
+ */
+void tiled_grid::assign(const unsigned char* grid, int width, int height)
+{
+    reset(width, height);
+    for(size_t t = 0; t < m_tiles.size(); t++) {
+        tile_rect_t rect = tile_rect(t);
+        unsigned char* cells = NULL;
+        for(int y = rect.y0; y < rect.y1; y++) {
+            const unsigned char* row = grid + (size_t)y * m_width;
+            if(cells == NULL) {
+                if(all_zero(row + rect.x0, row + rect.x1)) {
+                    continue;
+                }
+                cells = write_tile(t);
+            }
+            std::memcpy(cells + (y - rect.y0) * GRID_TILE_SIZE, row + rect.x0, rect.x1 - rect.x0);
+        }
+    }
+}
+
+int tiled_grid::width() const
+{
+    return m_width;
+}
+
+int tiled_grid::height() const
+{
+    return m_height;
+}
+
+int tiled_grid::tiles_x() const
+{
+    return m_tiles_x;
+}
+
+int tiled_grid::tiles_y() const
+{
+    return m_tiles_y;
+}
+
+size_t tiled_grid::tile_count() const
+{
+    return m_tiles.size();
+}
+
+tile_rect_t tiled_grid::tile_rect(int tile) const
+{
+    tile_rect_t rect;
+    rect.x0 = (tile % m_tiles_x) * GRID_TILE_SIZE;
+    rect.y0 = (tile / m_tiles_x) * GRID_TILE_SIZE;
+    rect.x1 = std::min(rect.x0 + GRID_TILE_SIZE, m_width);
+    rect.y1 = std::min(rect.y0 + GRID_TILE_SIZE, m_height);
+    return rect;
+}
+
+const unsigned char* tiled_grid::tile(int tile) const
+{
+    return m_tiles[tile]->cells;
+}
+
+bool tiled_grid::allocated(int tile) const
+{
+    return m_tiles[tile] != zero_tile();
+}
+
+/*
+ * Copy on write, for write_tile() when the tile is not this grid's alone.
+ * Copies of a grid are only made by the thread writing it, so the use count
+ * of a tile cannot go up behind write_tile()'s back; at worst a copy that was
+ * just dropped still counts, and the tile is copied once more than needed.
+ */
+void tiled_grid::own_tile(int tile)
+{
+    std::shared_ptr<grid_tile_t>& cells = m_tiles[tile];
+    if(cells == zero_tile()) {
+        cells = std::make_shared<grid_tile_t>();
+    } else {
+        cells = std::make_shared<grid_tile_t>(*cells);
+    }
+}
+
+unsigned char* tiled_grid::clear_tile(int tile)
+{
+    m_tiles[tile] = std::make_shared<grid_tile_t>();
+    return m_tiles[tile]->cells;
+}
+
+void tiled_grid::compact_tile(int tile)
+{
+    const unsigned char* cells = m_tiles[tile]->cells;
+    if(all_zero(cells, cells + GRID_TILE_CELLS)) {
+        m_tiles[tile] = zero_tile();
+    }
+}
+
+/*
+ * SBPL keeps its grid column by column, so each tile is written one column
+ * at a time, reading down the tile.
+ */
+void tiled_grid::copy_columns(unsigned char* const* columns) const
+{
+    for(size_t t = 0; t < m_tiles.size(); t++) {
+        if(!allocated(t)) {
+            continue;
+        }
+        tile_rect_t rect = tile_rect(t);
+        const unsigned char* cells = m_tiles[t]->cells;
+        for(int x = rect.x0; x < rect.x1; x++) {
+            unsigned char* column = columns[x];
+            const unsigned char* src = cells + (x - rect.x0);
+            for(int y = rect.y0; y < rect.y1; y++) {
+                column[y] = src[(y - rect.y0) * GRID_TILE_SIZE];
+            }
+        }
+    }
+}
+
+size_t tiled_grid::allocated_tiles() const
+{
+    size_t count = 0;
+    for(size_t t = 0; t < m_tiles.size(); t++) {
+        if(allocated(t)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+size_t tiled_grid::memory_bytes() const
+{
+    return m_tiles.size() * sizeof(m_tiles[0]) + allocated_tiles() * sizeof(grid_tile_t);
+}
@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////////////
+// tiled_grid.h - Sparse tiled cost grid - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TILED_GRID_H
+#define TILED_GRID_H
+
+#include "tile_raster.hpp"
+
+#include <memory>
+#include <stddef.h>
+#include <vector>
+
+// Tile edge in cells, the same as the raster tiles so obstacle bins map onto storage tiles
+#define GRID_TILE_SHIFT 7
+#define GRID_TILE_SIZE (1 << GRID_TILE_SHIFT)
+#define GRID_TILE_CELLS (GRID_TILE_SIZE * GRID_TILE_SIZE)
+
+#if GRID_TILE_SIZE != RASTER_TILE_SIZE
+#error "GRID_TILE_SIZE has to match RASTER_TILE_SIZE"
+#endif
+
+// Row major cells of one tile, cells past the edge of the grid stay zero
+struct grid_tile_t {
+    unsigned char cells[GRID_TILE_CELLS];
+};
+
+/*
+ * Cost grid kept as GRID_TILE_SIZE x GRID_TILE_SIZE tiles. Every tile starts
+ * out as one all zero tile shared by all grids and only gets memory of its own
+ * the first time it is written, so a map that is mostly empty airspace costs
+ * a pointer per tile plus the tiles obstacles landed on.
+ *
+ * Copying a grid shares its tiles, a shared tile is copied before it is
+ * written. A grid is written by one thread at a time, one tile per thread,
+ * and can be read by any number of threads once nobody writes it.
+ */
+class tiled_grid {
+public:
+    tiled_grid();
+
+    // Resizes to width x height cells, all zero
+    void reset(int width, int height);
+    // Resizes to width x height and copies a row major grid. Tiles with only zeroes stay shared.
+    void assign(const unsigned char* grid, int width, int height);
+
+    int width() const;
+    int height() const;
+    // Tiles in row major tile order, tile t is at (t % tiles_x(), t / tiles_x())
+    int tiles_x() const;
+    int tiles_y() const;
+    size_t tile_count() const;
+
+    // Cost of a cell, which must be on the grid
+    inline unsigned char cost(int x, int y) const {
+        const grid_tile_t* tile = m_tiles[(y >> GRID_TILE_SHIFT) * m_tiles_x + (x >> GRID_TILE_SHIFT)].get();
+        return tile->cells[(y & (GRID_TILE_SIZE - 1)) * GRID_TILE_SIZE + (x & (GRID_TILE_SIZE - 1))];
+    }
+    // Cells [x0, x1) x [y0, y1) of tile t that are on the grid
+    tile_rect_t tile_rect(int tile) const;
+    // Cells of tile t, GRID_TILE_SIZE per row
+    const unsigned char* tile(int tile) const;
+    // False while tile t is the shared zero tile
+    bool allocated(int tile) const;
+    // Cells of tile t, given memory of their own first if they are shared
+    inline unsigned char* write_tile(int tile) {
+        //The zero tile is never owned by one grid alone
+        if(m_tiles[tile].use_count() != 1) {
+            own_tile(tile);
+        }
+        return m_tiles[tile]->cells;
+    }
+    // A cell to write, its tile is given memory of its own first if it is shared
+    inline unsigned char& write_cell(int x, int y) {
+        unsigned char* cells = write_tile((y >> GRID_TILE_SHIFT) * m_tiles_x + (x >> GRID_TILE_SHIFT));
+        return cells[(y & (GRID_TILE_SIZE - 1)) * GRID_TILE_SIZE + (x & (GRID_TILE_SIZE - 1))];
+    }
+    // Gives tile t new zeroed memory of its own, without copying what it had
+    unsigned char* clear_tile(int tile);
+    // Goes back to the shared zero tile if every cell of tile t is zero
+    void compact_tile(int tile);
+
+    // Writes the allocated tiles into SBPL style columns, columns[x][y].
+    // The columns must start out zero, the rest of the grid is not written.
+    void copy_columns(unsigned char* const* columns) const;
+
+    // Tiles with memory of their own, some may be shared with copies of this grid
+    size_t allocated_tiles() const;
+    // Bytes held by the tile table and the allocated tiles
+    size_t memory_bytes() const;
+
+private:
+    void own_tile(int tile);
+
+    int m_width;
+    int m_height;
+    int m_tiles_x;
+    int m_tiles_y;
+    std::vector<std::shared_ptr<grid_tile_t> > m_tiles;
+};
+
+#endif /* TILED_GRID_H */
@@ -0,0 +1,499 @@
+///////////////////////////////////////////////////////////////////////////////
+// mock_server.cpp - Local stand in for the ground station - Dynamics Realtime Obstacle Pathing System
+//Copyright (C) 2015  Christopher Newport University
+//
+//This program is free software; you can redistribute it and/or
+//modify it under the terms of the GNU General Public License
+//as published by the Free Software Foundation; either version 2
+//of the License, or (at your option) any later version.
+//
+//This program is distributed in the hope that it will be useful,
+//but WITHOUT ANY WARRANTY; without even the implied warranty of
+//MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//GNU General Public License for more details.
+//
+//You should have received a copy of the GNU General Public License
+//along with this program; if not, write to the Free Software
+//Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+///////////////////////////////////////////////////////////////////////////////
+
+// Serves GET /api/grid with random obstacles, as json or as the binary grid
+// depending on the Accept header, so both encodings can be compared on one
+// machine. The moving obstacles move a step every request. POST /api/path
+// (drops -o) is answered 204 and counted.
+//
+// With step_ms the obstacles move every step_ms instead, and the server is a
+// stand in for the push modes of drops -s: a request with the ETag of the
+// current grid in If-None-Match is held until the next step (long poll), and
+// every step is pushed as a binary message to websocket clients of
+// GRID_STREAM_PATH on port + 1. Point drops at it with
+// stream_uri=ws://localhost:<port + 1>/api/grid/stream in the config.
+//
+// Usage: mock_server [port] [obstacles] [deflate] [step_ms]
+
+#include "grid_update.hpp"
+#include "grid_wire.hpp"
+
+#include <cpprest/http_listener.h>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/asio.hpp>
+#include <boost/uuid/detail/sha1.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace web::http;
+using namespace web::http::experimental::listener;
+
+#define GRID_SIZE 5000
+
+// Appended to Sec-WebSocket-Key before hashing it for Sec-WebSocket-Accept, RFC 6455
+#define WEBSOCKET_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+/*
+ * Hand written json so the server side cost does not depend on the cpprest DOM
+ */
+std::string write_grid_json(const grid_view_t& grid)
+{
+    std::ostringstream json;
+    json << "{\"is_changed\": " << (grid.is_changed ? "true" : "false")
+         << ", \"grid_width\": " << grid.width << ", \"grid_height\": " << grid.height
+         << ", \"location\": {\"x\": " << grid.location_x << ", \"y\": " << grid.location_y
+         << ", \"theta\": " << grid.location_theta << "}"
+         << ", \"goal\": {\"x\": " << grid.goal_x << ", \"y\": " << grid.goal_y
+         << ", \"theta\": " << grid.goal_theta << "}"
+         << ", \"obstacles\": {\"stationary_obstacles\": [";
+    for(size_t i = 0; i < grid.stationary_obstacles.size(); i++) {
+        const obstacle_t& obs = grid.stationary_obstacles[i];
+        json << (i ? ", " : "") << "{\"x\": " << obs.x << ", \"y\": " << obs.y
+             << ", \"radius\": " << obs.radius << "}";
+    }
+    json << "], \"moving_obstacles\": [";
+    for(size_t i = 0; i < grid.moving_obstacles.size(); i++) {
+        const obstacle_t& obs = grid.moving_obstacles[i];
+        json << (i ? ", " : "") << "{\"x\": " << obs.x << ", \"y\": " << obs.y
+             << ", \"radius\": " << obs.radius << ", \"heading\": " << obs.heading
+             << ", \"velocity\": " << obs.velocity << "}";
+    }
+    json << "]}}";
+    return json.str();
+}
+
+std::string base64(const unsigned char* data, size_t size)
+{
+    static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for(size_t i = 0; i < size; i += 3) {
+        unsigned int bits = data[i] << 16;
+        bits |= (i + 1 < size) ? data[i + 1] << 8 : 0;
+        bits |= (i + 2 < size) ? data[i + 2] : 0;
+        out += digits[(bits >> 18) & 63];
+        out += digits[(bits >> 12) & 63];
+        out += (i + 1 < size) ? digits[(bits >> 6) & 63] : '=';
+        out += (i + 2 < size) ? digits[bits & 63] : '=';
+    }
+    return out;
+}
+
+/*
+ * Just enough of a websocket server to push grids: the upgrade handshake and
+ * unmasked binary frames out. What clients send is never read, a client is
+ * dropped once a write to it fails.
+ */
+class grid_stream_server {
+public:
+    grid_stream_server();
+    ~grid_stream_server();
+
+    // Listens on port, new clients get first_message right away. Returns false if it cannot listen.
+    bool open(int port, std::function<std::vector<uint8_t>()> first_message);
+    // Sends message to every client
+    void broadcast(const std::vector<uint8_t>& message);
+    size_t client_count();
+
+private:
+    void accept_next();
+    bool handshake(boost::asio::ip::tcp::socket& socket);
+    static void write_frame(boost::asio::ip::tcp::socket& socket, const std::vector<uint8_t>& message);
+
+    boost::asio::io_service m_io;
+    boost::asio::ip::tcp::acceptor m_acceptor;
+    std::shared_ptr<boost::asio::ip::tcp::socket> m_next;
+    std::function<std::vector<uint8_t>()> m_first_message;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::vector<std::shared_ptr<boost::asio::ip::tcp::socket> > m_clients;
+};
+
+grid_stream_server::grid_stream_server() :
+    m_acceptor(m_io)
+{
+
+}
+
+grid_stream_server::~grid_stream_server()
+{
+    m_io.stop();
+    if(m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+bool grid_stream_server::open(int port, std::function<std::vector<uint8_t>()> first_message)
+{
+    boost::system::error_code error;
+    boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::tcp::v4(), port);
+    m_acceptor.open(endpoint.protocol(), error);
+    if(!error) {
+        m_acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true), error);
+        m_acceptor.bind(endpoint, error);
+    }
+    if(!error) {
+        m_acceptor.listen(boost::asio::socket_base::max_connections, error);
+    }
+    if(error) {
+        std::cout << "Could not listen on port " << port << ": " << error.message() << std::endl;
+        return false;
+    }
+    m_first_message = first_message;
+    accept_next();
+    m_thread = std::thread([this]() {
+        m_io.run();
+    });
+    return true;
+}
+
+void grid_stream_server::accept_next()
+{
+    m_next.reset(new boost::asio::ip::tcp::socket(m_io));
+    m_acceptor.async_accept(*m_next, [this](const boost::system::error_code& error) {
+        if(error) {
+            return;
+        }
+        std::shared_ptr<boost::asio::ip::tcp::socket> socket = m_next;
+        if(handshake(*socket)) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            try {
+                write_frame(*socket, m_first_message());
+                m_clients.push_back(socket);
+            } catch(const std::exception& ex) {
+                std::cout << "Stream client gone: " << ex.what() << std::endl;
+            }
+        }
+        accept_next();
+    });
+}
+
+/*
+ * Reads the upgrade request and answers it, false if it is not one for GRID_STREAM_PATH
+ */
+bool grid_stream_server::handshake(boost::asio::ip::tcp::socket& socket)
+{
+    try {
+        boost::asio::streambuf request;
+        boost::asio::read_until(socket, request, "\r\n\r\n");
+        std::istream lines(&request);
+        std::string line;
+        std::getline(lines, line);
+        bool stream_path = line.find(" " GRID_STREAM_PATH " ") != std::string::npos;
+        std::string key;
+        while(std::getline(lines, line) && line != "\r") {
+            std::string name = line.substr(0, line.find(':'));
+            if(boost::iequals(name, "Sec-WebSocket-Key")) {
+                key = line.substr(name.size() + 1);
+                key.erase(0, key.find_first_not_of(" "));
+                key.erase(key.find_last_not_of(" \r") + 1);
+            }
+        }
+        if(!stream_path || key.empty()) {
+            boost::asio::write(socket, boost::asio::buffer(std::string("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n")));
+            return false;
+        }
+
+        boost::uuids::detail::sha1 sha1;
+        std::string accept_key = key + WEBSOCKET_GUID;
+        sha1.process_bytes(accept_key.data(), accept_key.size());
+        unsigned int digest[5];
+        sha1.get_digest(digest);
+        unsigned char hash[20];
+        for(int i = 0; i < 20; i++) {
+            hash[i] = (digest[i / 4] >> (24 - 8 * (i % 4))) & 0xff;
+        }
+        std::string response = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                               "Sec-WebSocket-Accept: " + base64(hash, sizeof(hash)) + "\r\n\r\n";
+        boost::asio::write(socket, boost::asio::buffer(response));
+    } catch(const std::exception& ex) {
+        std::cout << "Bad stream handshake: " << ex.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/*
+ * One final binary frame, servers do not mask
+ */
+void grid_stream_server::write_frame(boost::asio::ip::tcp::socket& socket, const std::vector<uint8_t>& message)
+{
+    std::vector<uint8_t> header;
+    header.push_back(0x82);
+    if(message.size() < 126) {
+        header.push_back(message.size());
+    } else if(message.size() <= 0xffff) {
+        header.push_back(126);
+        header.push_back(message.size() >> 8);
+        header.push_back(message.size() & 0xff);
+    } else {
+        header.push_back(127);
+        for(int shift = 56; shift >= 0; shift -= 8) {
+            header.push_back(((uint64_t)message.size() >> shift) & 0xff);
+        }
+    }
+    std::vector<boost::asio::const_buffer> buffers;
+    buffers.push_back(boost::asio::buffer(header));
+    buffers.push_back(boost::asio::buffer(message));
+    boost::asio::write(socket, buffers);
+}
+
+void grid_stream_server::broadcast(const std::vector<uint8_t>& message)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(size_t i = 0; i < m_clients.size();) {
+        try {
+            write_frame(*m_clients[i], message);
+            i++;
+        } catch(const std::exception& ex) {
+            std::cout << "Stream client gone: " << ex.what() << std::endl;
+            m_clients.erase(m_clients.begin() + i);
+        }
+    }
+}
+
+size_t grid_stream_server::client_count()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_clients.size();
+}
+
+class mock_grid {
+public:
+    mock_grid(int count, bool deflate, bool timed);
+
+    // Answers one /api/grid request, or holds it until the next step if it has the current grid
+    void serve(http_request request);
+    // Moves the obstacles, answers the held requests and returns the grid for the stream
+    std::vector<uint8_t> tick();
+    // The current grid for a new stream client
+    std::vector<uint8_t> current_wire();
+
+private:
+    void step();
+    // The current grid as a response, with its ETag. Called with m_mutex held.
+    http_response make_response(bool binary);
+
+    struct held_request_t {
+        http_request request;
+        bool binary;
+    };
+
+    std::mutex m_mutex;
+    grid_update_t m_grid;
+    bool m_deflate;
+    bool m_timed; //steps come from tick(), not requests
+    bool m_sent; //is_changed is only true for the first response
+    unsigned long m_version; //the ETag, counts steps
+    std::vector<held_request_t> m_held;
+    std::vector<uint8_t> m_wire;
+};
+
+mock_grid::mock_grid(int count, bool deflate, bool timed) :
+    m_deflate(deflate),
+    m_timed(timed),
+    m_sent(false),
+    m_version(0)
+{
+    std::mt19937 rng(count);
+    std::uniform_int_distribution<int> coord(0, GRID_SIZE - 1);
+    std::uniform_int_distribution<int> radius(5, 80);
+    std::uniform_int_distribution<int> heading(0, 359);
+    std::uniform_int_distribution<int> velocity(1, 40);
+
+    m_grid.clear();
+    m_grid.width = GRID_SIZE;
+    m_grid.height = GRID_SIZE;
+    m_grid.location_x = 10;
+    m_grid.location_y = 10;
+    m_grid.location_theta = 0;
+    m_grid.goal_x = GRID_SIZE - 100;
+    m_grid.goal_y = GRID_SIZE - 100;
+    m_grid.goal_theta = 90;
+    for(int i = 0; i < count; i++) {
+        m_grid.stationary_obstacles.push_back({coord(rng), coord(rng), radius(rng), 0, 0});
+        m_grid.moving_obstacles.push_back({coord(rng), coord(rng), radius(rng), heading(rng), velocity(rng)});
+    }
+}
+
+/*
+ * Moves every moving obstacle one step along its heading, wrapping at the edges
+ */
+void mock_grid::step()
+{
+    for(obstacle_t& obs : m_grid.moving_obstacles) {
+        double heading = obs.heading * M_PI / 180.0;
+        obs.x = ((obs.x + (int)std::lround(obs.velocity * std::cos(heading))) % GRID_SIZE + GRID_SIZE) % GRID_SIZE;
+        obs.y = ((obs.y + (int)std::lround(obs.velocity * std::sin(heading))) % GRID_SIZE + GRID_SIZE) % GRID_SIZE;
+    }
+    m_version++;
+}
+
+http_response mock_grid::make_response(bool binary)
+{
+    http_response response(status_codes::OK);
+    m_grid.is_changed = !m_sent;
+    m_sent = true;
+    if(binary) {
+        encode_grid_wire(m_grid.view(), m_deflate, m_wire);
+        response.set_body(std::vector<unsigned char>(m_wire.begin(), m_wire.end()));
+        response.headers().set_content_type(U(GRID_WIRE_CONTENT_TYPE));
+    } else {
+        response.set_body(write_grid_json(m_grid.view()), U("application/json"));
+    }
+    response.headers().add(header_names::etag, U("\"") + utility::conversions::to_string_t(std::to_string(m_version)) + U("\""));
+    return response;
+}
+
+void mock_grid::serve(http_request request)
+{
+    std::string accept;
+    if(request.headers().has(header_names::accept)) {
+        accept = utility::conversions::to_utf8string(request.headers()[header_names::accept]);
+    }
+    bool binary = accept.find(GRID_WIRE_CONTENT_TYPE) != std::string::npos;
+    utility::string_t etag;
+    if(request.headers().has(header_names::if_none_match)) {
+        etag = request.headers()[header_names::if_none_match];
+    }
+
+    http_response response;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_timed && etag == U("\"") + utility::conversions::to_string_t(std::to_string(m_version)) + U("\"")) {
+            m_held.push_back({request, binary});
+            return;
+        }
+        response = make_response(binary);
+        if(!m_timed) {
+            step();
+        }
+    }
+    request.reply(response);
+}
+
+std::vector<uint8_t> mock_grid::tick()
+{
+    std::vector<held_request_t> held;
+    std::vector<http_response> responses;
+    std::vector<uint8_t> wire;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        step();
+        held.swap(m_held);
+        for(const held_request_t& waiting : held) {
+            responses.push_back(make_response(waiting.binary));
+        }
+        m_grid.is_changed = false;
+        encode_grid_wire(m_grid.view(), m_deflate, wire);
+    }
+    for(size_t i = 0; i < held.size(); i++) {
+        held[i].request.reply(responses[i]);
+    }
+    return wire;
+}
+
+std::vector<uint8_t> mock_grid::current_wire()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<uint8_t> wire;
+    m_grid.is_changed = true;
+    encode_grid_wire(m_grid.view(), m_deflate, wire);
+    return wire;
+}
+
+int main(int argc, char *argv[])
+{
+    int port = argc > 1 ? std::atoi(argv[1]) : 8080;
+    int count = argc > 2 ? std::atoi(argv[2]) : 1000;
+    bool deflate = argc > 3 && std::atoi(argv[3]) != 0;
+    int step_ms = argc > 4 ? std::atoi(argv[4]) : 0;
+
+    mock_grid grid(count, deflate, step_ms > 0);
+    std::string url = "http://localhost:" + std::to_string(port) + "/api/grid";
+    http_listener listener(utility::conversions::to_string_t(url));
+    listener.support(methods::GET, [&grid](http_request request) {
+        grid.serve(request);
+    });
+    std::atomic<unsigned long> paths_posted(0);
+    http_listener path_listener(utility::conversions::to_string_t("http://localhost:" + std::to_string(port) + "/api/path"));
+    path_listener.support(methods::POST, [&paths_posted](http_request request) {
+        paths_posted++;
+        request.reply(status_codes::NoContent);
+    });
+
+    try {
+        listener.open().wait();
+        path_listener.open().wait();
+    } catch(const std::exception& ex) {
+        std::cout << "Could not listen on " << url << ": " << ex.what() << std::endl;
+        return 1;
+    }
+    std::cout << "Serving " << 2 * count << " obstacles on " << url
+              << (deflate ? " (binary grids deflated)" : "") << std::endl;
+
+    //Timed steps, long polls and the grid stream
+    grid_stream_server stream;
+    std::atomic_bool stepping(step_ms > 0);
+    std::thread stepper;
+    if(stepping) {
+        std::function<std::vector<uint8_t>()> first_message = [&grid]() {
+            return grid.current_wire();
+        };
+        if(!stream.open(port + 1, first_message)) {
+            listener.close().wait();
+            path_listener.close().wait();
+            return 1;
+        }
+        std::cout << "Stepping every " << step_ms << " ms, pushing to ws://localhost:" << port + 1
+                  << GRID_STREAM_PATH << std::endl;
+        stepper = std::thread([&]() {
+            auto next_step = std::chrono::steady_clock::now();
+            while(stepping) {
+                next_step += std::chrono::milliseconds(step_ms);
+                std::this_thread::sleep_until(next_step);
+                stream.broadcast(grid.tick());
+            }
+        });
+    }
+
+    std::cout << "Press enter to stop" << std::endl;
+    std::string line;
+    std::getline(std::cin, line);
+    stepping = false;
+    if(stepper.joinable()) {
+        stepper.join();
+    }
+    listener.close().wait();
+    path_listener.close().wait();
+    std::cout << "Paths posted: " << paths_posted << std::endl;
+    return 0;
+}